@@ -8,13 +8,20 @@ layout (location = 0) out vec3 outNormal;
 
 struct ObjectData {
 	mat4 model;
+	vec4 defaultColor;
+	vec4 boundingSphere;
+	uint drawIndex;
 };
 layout(std140, set = 1, binding = 0) readonly buffer ObjectBuffer {
 	ObjectData objects[];
 } objectBuffer;
 
+layout(std430, set = 1, binding = 1) readonly buffer InstanceBuffer {
+	uint objectIndices[];
+} instanceBuffer;
+
 void main()
 {
-	gl_Position = objectBuffer.objects[gl_BaseInstance].model * vec4(vPosition, 1.0f);
+	gl_Position = objectBuffer.objects[instanceBuffer.objectIndices[gl_InstanceIndex]].model * vec4(vPosition, 1.0f);
 	outNormal = vNormal;
 }
@@ -6,6 +6,8 @@ layout (location = 2) in vec3 vColor;
 layout (location = 3) in vec2 vTexCoord;
 
 layout (location = 0) out vec2 texCoord;
+layout (location = 1) flat out uint textureIndex;
+layout (location = 2) flat out uint samplerIndex;
 
 layout(set = 0, binding = 0) uniform CameraBuffer{
 	mat4 view;
@@ -15,15 +17,26 @@ layout(set = 0, binding = 0) uniform CameraBuffer{
 
 struct ObjectData {
 	mat4 model;
+	vec4 defaultColor;
+	vec4 boundingSphere;
+	uint drawIndex;
+	uint textureIndex;
+	uint samplerIndex;
 };
 layout(std140, set = 1, binding = 0) readonly buffer ObjectBuffer {
 	ObjectData objects[];
 } objectBuffer;
 
+layout(std430, set = 1, binding = 1) readonly buffer InstanceBuffer {
+	uint objectIndices[];
+} instanceBuffer;
+
 void main()
 {
-	mat4 modelMatrix = objectBuffer.objects[gl_InstanceIndex].model;
-	mat4 transformMatrix = cameraData.viewproj * modelMatrix;
+	ObjectData object = objectBuffer.objects[instanceBuffer.objectIndices[gl_InstanceIndex]];
+	mat4 transformMatrix = cameraData.viewproj * object.model;
 	gl_Position = transformMatrix * vec4(vPosition, 1.0f);
 	texCoord = vTexCoord;
+	textureIndex = object.textureIndex;
+	samplerIndex = object.samplerIndex;
 }
\ No newline at end of file
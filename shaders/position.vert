@@ -15,13 +15,20 @@ layout(set = 0, binding = 0) uniform CameraBuffer{
 
 struct ObjectData {
 	mat4 model;
+	vec4 defaultColor;
+	vec4 boundingSphere;
+	uint drawIndex;
 };
 layout(std140, set = 1, binding = 0) readonly buffer ObjectBuffer {
 	ObjectData objects[];
 } objectBuffer;
 
+layout(std430, set = 1, binding = 1) readonly buffer InstanceBuffer {
+	uint objectIndices[];
+} instanceBuffer;
+
 void main()
 {
-	mat4 transformMatrix = (cameraData.viewproj * objectBuffer.objects[gl_InstanceIndex].model);
+	mat4 transformMatrix = (cameraData.viewproj * objectBuffer.objects[instanceBuffer.objectIndices[gl_InstanceIndex]].model);
 	gl_Position = transformMatrix * vec4(vPosition, 1.0f);
 }
\ No newline at end of file
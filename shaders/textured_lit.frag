@@ -1,10 +1,15 @@
 #version 460
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout (location = 0) in vec2 texCoord;
+layout (location = 1) flat in uint textureIndex;
+layout (location = 2) flat in uint samplerIndex;
 
 layout (location = 0) out vec4 outFragColor;
 
-layout(set = 2, binding = 0) uniform sampler2D tex1;
+// bindless, instances of a single draw may index different entries
+layout(set = 2, binding = 0) uniform texture2D textures[];
+layout(set = 2, binding = 1) uniform sampler samplers[];
 
 layout(set = 0, binding = 1) uniform  SceneData {
 	vec4 fogColor; // w is for exponent
@@ -17,7 +22,7 @@ layout(set = 0, binding = 1) uniform  SceneData {
 
 void main()
 {
-	vec4 color = texture(tex1, texCoord);
+	vec4 color = texture(sampler2D(textures[nonuniformEXT(textureIndex)], samplers[nonuniformEXT(samplerIndex)]), texCoord);
 	if(color.a < 0.01) { discard; }
 	outFragColor = color;
 }
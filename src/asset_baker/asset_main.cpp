@@ -1,10 +1,12 @@
 #include <iostream>
+#include <algorithm>
 #include <unordered_set>
 #include <fstream>
 #include <filesystem>
 namespace fs = std::filesystem;
 
 #include <lz4.h>
+#include <xxhash.h>
 #include <chrono>
 #include <json.hpp>
 
@@ -27,6 +29,9 @@ using namespace assets;
 #include "../noop_math/noop_math.h"
 using namespace noop;
 
+// filters that don't apply to a given mesh are dropped by packMesh
+const u32 bakedMeshFilters = meshFilterBit(MeshFilter::Deinterleave) | meshFilterBit(MeshFilter::ByteShuffle) | meshFilterBit(MeshFilter::IndexDelta);
+
 struct {
   const char* png = ".png";
   const char* jpg = ".jpg";
@@ -52,22 +57,15 @@ struct {
   const char* fileName = "fileName";
   const char* fileExt = "fileExt";
   const char* filePath = "filePath";
+  const char* payloadHash = "payloadHash";
 } cacheJsonStrings;
 
-struct ConverterState {
-  fs::path assetsDir;
-  fs::path bakedAssetDir;
-  fs::path outputFileDir;
-  std::vector<fs::path> bakedFilePaths;
-
-  fs::path convertToExportRelative(const fs::path& path) const;
-};
-
 struct AssetBakeCachedItem {
   struct BakedFile {
-    std::string path;
+    std::string path; // where the data actually lives, shared by every alias of a content addressed blob
     std::string ext;
-    std::string name;
+    std::string name; // alias file name, used for the generated asset name
+    u64 payloadHash; // 0 if not content addressed
   };
 
   std::string originalFileName;
@@ -75,7 +73,22 @@ struct AssetBakeCachedItem {
   std::vector<BakedFile> bakedFiles;
 };
 
+struct ConverterState {
+  fs::path assetsDir;
+  fs::path bakedAssetDir;
+  fs::path outputFileDir;
+  std::vector<AssetBakeCachedItem::BakedFile> bakedFiles;
+  std::unordered_map<u64, std::string> blobPathsByHash; // every content addressed blob written this run or found in the cache
+
+  fs::path convertToExportRelative(const fs::path& path) const;
+  fs::path blobDir() const;
+  // Content addressed assets are stored once under blobDir() no matter how many sources produce the same payload.
+  // aliasPath still decides the asset's name in the generated tables.
+  void saveBakedAsset(const fs::path& aliasPath, const assets::AssetFile& file, bool contentAddressed);
+};
+
 bool convertImage(const fs::path& inputPath, ConverterState& converterState);
+u32 generateMipChain(const u8* pixels, u32 width, u32 height, std::vector<u8>& mipChain); // returns the number of mips
 
 void packVertex(assets::Vertex_PNCV_f32& new_vert, tinyobj::real_t vx, tinyobj::real_t vy, tinyobj::real_t vz, tinyobj::real_t nx, tinyobj::real_t ny, tinyobj::real_t nz, tinyobj::real_t ux, tinyobj::real_t uy);
 void packVertex(assets::Vertex_P32N8C8V16& new_vert, tinyobj::real_t vx, tinyobj::real_t vy, tinyobj::real_t vz, tinyobj::real_t nx, tinyobj::real_t ny, tinyobj::real_t nz, tinyobj::real_t ux, tinyobj::real_t uy);
@@ -95,8 +108,20 @@ bool extractObjCombinedMesh(tinyobj::ObjReader& objReader, const fs::path& fileP
 void saveCache(const std::unordered_map<std::string, AssetBakeCachedItem>& oldCache, const std::vector<AssetBakeCachedItem>& newBakedItems);
 void loadCache(std::unordered_map<std::string, AssetBakeCachedItem>& assetBakeCache);
 
+// Entry in one of the generated baked asset tables, the baked_*.incl files included by baked_assets.h
+struct BakedTableEntry {
+  std::string name;
+  std::string path;
+};
+
+std::vector<BakedTableEntry> bakedTableEntries(const std::unordered_map<std::string, AssetBakeCachedItem>& oldCache, const ConverterState& converterState, const char* fileExt);
+void resolveBakedMaterials(const std::unordered_map<std::string, AssetBakeCachedItem>& oldCache, const ConverterState& converterState);
 void writeOutputData(const std::unordered_map<std::string, AssetBakeCachedItem>& oldCache, const ConverterState& converterState);
-void replace(std::string& str, const char oldToken, const char newToken);
+void removeUnreferencedBlobs(const std::unordered_map<std::string, AssetBakeCachedItem>& oldCache, const ConverterState& converterState);
+u64 hashBakedPayload(const assets::AssetFile& file);
+std::string canonicalBakedMetadata(const assets::AssetFile& file); // metadata without provenance, as hashed by hashBakedPayload()
+std::string bakedAssetName(std::string fileStem); // name used for the asset in the generated tables
+void replace(std::string& str, const char* oldTokens, u32 oldTokensCount, char newToken);
 void replaceBackSlashes(std::string& str);
 std::size_t fileCountInDir(fs::path dirPath);
 
@@ -140,6 +165,7 @@ void saveCache(const std::unordered_map<std::string, AssetBakeCachedItem>& oldCa
       newCacheBakedFile[cacheJsonStrings.filePath] = bakedFile.path;
       newCacheBakedFile[cacheJsonStrings.fileName] = bakedFile.name;
       newCacheBakedFile[cacheJsonStrings.fileExt] = bakedFile.ext;
+      newCacheBakedFile[cacheJsonStrings.payloadHash] = bakedFile.payloadHash;
       newCacheBakedFiles.push_back(newCacheBakedFile);
     }
     newCacheItemJson[cacheJsonStrings.bakedFiles] = newCacheBakedFiles;
@@ -157,6 +183,7 @@ void saveCache(const std::unordered_map<std::string, AssetBakeCachedItem>& oldCa
       newCacheBakedFile[cacheJsonStrings.filePath] = bakedFile.path;
       newCacheBakedFile[cacheJsonStrings.fileName] = bakedFile.name;
       newCacheBakedFile[cacheJsonStrings.fileExt] = bakedFile.ext;
+      newCacheBakedFile[cacheJsonStrings.payloadHash] = bakedFile.payloadHash;
       newCacheBakedFiles.push_back(newCacheBakedFile);
     }
     newCacheItemJson[cacheJsonStrings.bakedFiles] = newCacheBakedFiles;
@@ -191,6 +218,7 @@ void loadCache(std::unordered_map<std::string, AssetBakeCachedItem>& assetBakeCa
       bakedFile.path = bakedFileJson[cacheJsonStrings.filePath];
       bakedFile.name = bakedFileJson[cacheJsonStrings.fileName];
       bakedFile.ext = bakedFileJson[cacheJsonStrings.fileExt];
+      bakedFile.payloadHash = bakedFileJson.value(cacheJsonStrings.payloadHash, (u64)0); // caches from before deduplication lack hashes
       cachedItem.bakedFiles.push_back(bakedFile);
     }
     assetBakeCache[cachedItem.originalFileName] = cachedItem;
@@ -220,15 +248,27 @@ int main(int argc, char* argv[]) {
     return -1;
   }
 
-  // Create export folder if needed
+  // Create export folders if needed
   if(!fs::is_directory(converterState.bakedAssetDir)) {
     fs::create_directory(converterState.bakedAssetDir);
   }
+  if(!fs::is_directory(converterState.blobDir())) {
+    fs::create_directory(converterState.blobDir());
+  }
+
+  // blobs baked by previous runs can be shared with anything baked in this one
+  for(auto& [fileName, cachedItem] : oldAssetBakeCache) {
+    for(const AssetBakeCachedItem::BakedFile& bakedFile : cachedItem.bakedFiles) {
+      if(bakedFile.payloadHash != 0 && fs::exists(bakedFile.path)) {
+        converterState.blobPathsByHash[bakedFile.payloadHash] = bakedFile.path;
+      }
+    }
+  }
 
   std::cout << "loaded asset directory at " << converterState.assetsDir << std::endl;
 
   size_t fileCount = fileCountInDir(converterState.assetsDir);
-  converterState.bakedFilePaths.reserve(fileCount * 4);
+  converterState.bakedFiles.reserve(fileCount * 4);
   for(const fs::directory_entry& p: fs::directory_iterator(converterState.assetsDir)) { //fs::recursive_directory_iterator(directory)) {
 
     fs::path filePath = p.path();
@@ -242,7 +282,7 @@ int main(int argc, char* argv[]) {
 
     std::cout << "File: " << pathStr << std::endl;
 
-    u32 convertedFilesCountBefore = (u32)converterState.bakedFilePaths.size();
+    u32 convertedFilesCountBefore = (u32)converterState.bakedFiles.size();
 
     if(fileExt == supportedFileExtensions.png || fileExt == supportedFileExtensions.jpg || fileExt == supportedFileExtensions.tga) {
       convertImage(p.path(), converterState);
@@ -305,8 +345,9 @@ int main(int argc, char* argv[]) {
 
         extractGltfCombinedMesh(model, filePath, outputFolder, converterState);
         extractGltfMaterials(model, filePath, outputFolder, converterState);
-//        extractGltfMeshes(model, pathStr, outputFolder, converterState);
-//        extractGltfNodes(model, filePath, outputFolder, converterState);
+        // the prefab's nodes reference the meshes of individual primitives
+        extractGltfMeshes(model, filePath.string(), outputFolder, converterState);
+        extractGltfNodes(model, filePath, outputFolder, converterState);
       }
     } else {
       continue;
@@ -316,22 +357,21 @@ int main(int argc, char* argv[]) {
     AssetBakeCachedItem newlyBakedItem;
     newlyBakedItem.originalFileName = filePath.filename().string();
     newlyBakedItem.originalFileLastModified = lastModifiedTimeStamp(filePath);
-    const fs::path& recentlyBakedFile = converterState.bakedFilePaths.back();
-    u32 convertedFilesCount = (u32)converterState.bakedFilePaths.size();
+    u32 convertedFilesCount = (u32)converterState.bakedFiles.size();
     u32 newlyConvertedItemCount = convertedFilesCount - convertedFilesCountBefore;
     for(u32 i = 0; i < newlyConvertedItemCount; i++) {
-      const fs::path& recentlyBakedFile = converterState.bakedFilePaths[convertedFilesCount - i - 1];
-      AssetBakeCachedItem::BakedFile bakedFile;
-      bakedFile.path = recentlyBakedFile.string();
-      bakedFile.name = recentlyBakedFile.filename().string();
-      bakedFile.ext = recentlyBakedFile.extension().string();
-      newlyBakedItem.bakedFiles.push_back(bakedFile);
+      newlyBakedItem.bakedFiles.push_back(converterState.bakedFiles[convertedFilesCount - i - 1]);
     }
     newlyCachedItems.push_back(newlyBakedItem);
+
+    // the previous bake of this file is superseded
+    oldAssetBakeCache.erase(newlyBakedItem.originalFileName);
   }
 
+  resolveBakedMaterials(oldAssetBakeCache, converterState);
   writeOutputData(oldAssetBakeCache, converterState);
   saveCache(oldAssetBakeCache, newlyCachedItems);
+  removeUnreferencedBlobs(oldAssetBakeCache, converterState);
 
   return 0;
 }
@@ -355,7 +395,6 @@ bool convertImage(const fs::path& inputPath, ConverterState& converterState) {
   }
 
   TextureInfo texInfo;
-  texInfo.textureSize = texWidth * texHeight * 4;
   texInfo.textureFormat = TextureFormat::RGBA8;
   texInfo.originalFile = inputPath.string();
   texInfo.width = texWidth;
@@ -363,56 +402,11 @@ bool convertImage(const fs::path& inputPath, ConverterState& converterState) {
 
   auto compressionStart = std::chrono::high_resolution_clock::now();
 
-  // TODO: Mipmaps
-//  std::vector<char> textureBuffer_AllMipmaps;
-//
-//	struct DumbHandler : nvtt::OutputHandler {
-//		// Output data. Compressed data is output as soon as it's generated to minimize memory allocations.
-//		virtual bool writeData(const void* data, int size) {
-//			for (int i = 0; i < size; i++) {
-//				buffer.push_back(((char*)data)[i]);
-//			}
-//			return true;
-//		}
-//		virtual void beginImage(int size, int width, int height, int depth, int face, int miplevel) { };
-//
-//		// Indicate the end of the compressed image. (New in NVTT 2.1)
-//		virtual void endImage() {};
-//		std::vector<char> buffer;
-//	};
-//
-//	nvtt::Compressor compressor;
-//
-//	nvtt::CompressionOptions options;
-//	nvtt::OutputOptions outputOptions;
-//	nvtt::Surface surface;
-//
-//	DumbHandler handler;
-//	outputOptions.setOutputHandler(&handler);
-//
-//	surface.setImage(nvtt::InputFormat::InputFormat_BGRA_8UB, texWidth, texHeight, 1, pixels);
-//
-//	while (surface.canMakeNextMipmap(1))
-//	{
-//    surface.buildNextMipmap(nvtt::MipmapFilter_Box);
-//
-//    options.setFormat(nvtt::Format::Format_RGBA);
-//    options.setPixelType(nvtt::PixelType_UnsignedNorm);
-//
-//    compressor.compress(surface, 0, 0, options, outputOptions);
-//
-//    texInfo.pages.push_back({});
-//    texInfo.pages.back().width = surface.width();
-//    texInfo.pages.back().height = surface.height();
-//    texInfo.pages.back().originalSize = handler.buffer.size();
-//
-//    textureBuffer_AllMipmaps.insert(textureBuffer_AllMipmaps.end(), handler.buffer.begin(), handler.buffer.end());
-//    handler.buffer.clear();
-//	}
-//
-// texInfo.textureSize = textureBuffer_AllMipmaps.size();
-
-  assets::AssetFile newImage = assets::packTexture(&texInfo, pixels);
+  std::vector<u8> mipChain;
+  texInfo.mipCount = generateMipChain(pixels, texWidth, texHeight, mipChain);
+  texInfo.textureSize = mipChain.size();
+
+  assets::AssetFile newImage = assets::packTexture(&texInfo, mipChain.data());
 
   auto compressionEnd = std::chrono::high_resolution_clock::now();
 
@@ -426,12 +420,70 @@ bool convertImage(const fs::path& inputPath, ConverterState& converterState) {
   fs::path exportPath = converterState.bakedAssetDir / relative;
   exportPath.replace_extension(bakedExtensions.texture);
 
-  saveAssetFile(exportPath.string().c_str(), newImage);
-  converterState.bakedFilePaths.push_back(exportPath);
+  converterState.saveBakedAsset(exportPath, newImage, true);
 
   return true;
 }
 
+// Each mip is a 2x2 box filter of the one above it. Color is averaged in linear space as the texels are sRGB encoded.
+u32 generateMipChain(const u8* pixels, u32 width, u32 height, std::vector<u8>& mipChain) {
+  f32 srgbToLinear[256];
+  for(u32 i = 0; i < 256; i++) {
+    f32 c = i / 255.0f;
+    srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+  }
+  auto linearToSrgb = [](f32 c) -> u8 {
+    f32 srgb = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+    return (u8)(MIN(MAX(srgb, 0.0f), 1.0f) * 255.0f + 0.5f);
+  };
+
+  u32 mipCount = textureFullMipCount(width, height);
+  u64 chainSize = 0;
+  for(u32 mip = 0; mip < mipCount; mip++) {
+    chainSize += (u64)MAX(width >> mip, 1u) * MAX(height >> mip, 1u) * 4;
+  }
+  mipChain.resize(chainSize);
+  memcpy(mipChain.data(), pixels, (u64)width * height * 4);
+
+  const u8* src = mipChain.data();
+  u32 srcWidth = width;
+  u32 srcHeight = height;
+  for(u32 mip = 1; mip < mipCount; mip++) {
+    u8* dst = (u8*)src + (u64)srcWidth * srcHeight * 4;
+    u32 dstWidth = MAX(srcWidth >> 1, 1u);
+    u32 dstHeight = MAX(srcHeight >> 1, 1u);
+    for(u32 y = 0; y < dstHeight; y++) {
+      // a source dimension of 1 has nothing to pair with
+      u32 srcY0 = MIN(y * 2, srcHeight - 1);
+      u32 srcY1 = MIN(y * 2 + 1, srcHeight - 1);
+      for(u32 x = 0; x < dstWidth; x++) {
+        u32 srcX0 = MIN(x * 2, srcWidth - 1);
+        u32 srcX1 = MIN(x * 2 + 1, srcWidth - 1);
+        const u8* quad[4] = {
+          src + ((u64)srcY0 * srcWidth + srcX0) * 4,
+          src + ((u64)srcY0 * srcWidth + srcX1) * 4,
+          src + ((u64)srcY1 * srcWidth + srcX0) * 4,
+          src + ((u64)srcY1 * srcWidth + srcX1) * 4,
+        };
+        u8* dstTexel = dst + ((u64)y * dstWidth + x) * 4;
+        for(u32 channel = 0; channel < 3; channel++) {
+          f32 linear = 0.0f;
+          for(const u8* texel : quad) { linear += srgbToLinear[texel[channel]]; }
+          dstTexel[channel] = linearToSrgb(linear * 0.25f);
+        }
+        u32 alpha = 0;
+        for(const u8* texel : quad) { alpha += texel[3]; }
+        dstTexel[3] = (u8)((alpha + 2) / 4);
+      }
+    }
+    src = dst;
+    srcWidth = dstWidth;
+    srcHeight = dstHeight;
+  }
+
+  return mipCount;
+}
+
 void packVertex(assets::Vertex_PNCV_f32& new_vert, tinyobj::real_t vx, tinyobj::real_t vy, tinyobj::real_t vz, tinyobj::real_t nx, tinyobj::real_t ny, tinyobj::real_t nz, tinyobj::real_t ux, tinyobj::real_t uy) {
   new_vert.position[0] = vx;
   new_vert.position[1] = vy;
@@ -829,6 +881,7 @@ bool extractGltfCombinedMesh(tinygltf::Model& gltfModel, const fs::path& filePat
   meshInfo.indexSize = sizeof(u32);
   meshInfo.originalFile = filePath.string();
   meshInfo.bounds = assets::calculateBounds(vertices.data(), vertices.size());
+  meshInfo.filterMask = bakedMeshFilters;
 
   assets::AssetFile newFile = assets::packMesh(meshInfo, (char*)vertices.data(), (char*)indices.data());
 
@@ -836,8 +889,7 @@ bool extractGltfCombinedMesh(tinygltf::Model& gltfModel, const fs::path& filePat
   fs::path meshPath = outputFolder / newFileName;
 
   //save to disk
-  saveAssetFile(meshPath.string().c_str(), newFile);
-  converterState.bakedFilePaths.push_back(meshPath);
+  converterState.saveBakedAsset(meshPath, newFile, true);
 
   return true;
 }
@@ -868,19 +920,19 @@ bool extractGltfMeshes(tinygltf::Model& gltfModel, const std::string& filePath,
       MeshInfo meshInfo;
       meshInfo.vertexFormat = VertexFormatEnum;
       meshInfo.vertexBufferSize = vertices.size() * sizeof(VertexFormat);
-      //meshInfo.indexBufferSize = indices.size() * sizeof(u32);
-      //meshInfo.indexSize = sizeof(u32);
+      meshInfo.indexBufferSize = indices.size() * sizeof(u32);
+      meshInfo.indexSize = sizeof(u32);
       meshInfo.originalFile = filePath;
 
       meshInfo.bounds = assets::calculateBounds(vertices.data(), vertices.size());
+      meshInfo.filterMask = bakedMeshFilters;
 
       assets::AssetFile newFile = assets::packMesh(meshInfo, (char*)vertices.data(), (char*)indices.data());
 
       fs::path meshPath = outputFolder / (meshName + bakedExtensions.mesh);
 
       //save to disk
-      saveAssetFile(meshPath.string().c_str(), newFile);
-      converterState.bakedFilePaths.push_back(meshPath);
+      converterState.saveBakedAsset(meshPath, newFile, true);
     }
   }
   return true;
@@ -888,6 +940,13 @@ bool extractGltfMeshes(tinygltf::Model& gltfModel, const std::string& filePath,
 
 void extractGltfMaterials(tinygltf::Model& model, const fs::path& input, const fs::path& outputFolder, ConverterState& converterState) {
 
+  // textures are referenced by baked asset name here and resolved to indices once every texture is known, see resolveBakedMaterials()
+  auto textureName = [&](int textureIndex) -> std::string {
+    tinygltf::Texture texture = model.textures[textureIndex];
+    tinygltf::Image image = model.images[texture.source];
+    return bakedAssetName(fs::path(image.uri).stem().string());
+  };
+
   int materialIndex = 0;
   for(tinygltf::Material& gltfMat: model.materials) {
     std::string matName = calculateGltfMaterialName(model, materialIndex++);
@@ -896,107 +955,86 @@ void extractGltfMaterials(tinygltf::Model& model, const fs::path& input, const f
 
     assets::MaterialInfo newMaterial;
     newMaterial.baseEffect = "defaultPBR";
+    newMaterial.record = assets::defaultMaterialRecord();
 
     if(pbr.baseColorTexture.index >= 0) {
-      tinygltf::Texture baseColor = model.textures[pbr.baseColorTexture.index];
-      tinygltf::Image baseImage = model.images[baseColor.source];
-
-      fs::path baseColorPath = outputFolder.parent_path() / baseImage.uri;
-
-      baseColorPath.replace_extension(bakedExtensions.texture);
-
-      baseColorPath = converterState.convertToExportRelative(baseColorPath);
-
-      newMaterial.textures["baseColor"] = baseColorPath.string();
+      newMaterial.textureNames[(u32)MaterialTextureSlot::BaseColor] = textureName(pbr.baseColorTexture.index);
     }
     if(pbr.metallicRoughnessTexture.index >= 0) {
-      tinygltf::Texture image = model.textures[pbr.metallicRoughnessTexture.index];
-      tinygltf::Image baseImage = model.images[image.source];
-
-      fs::path baseColorPath = outputFolder.parent_path() / baseImage.uri;
-
-      baseColorPath.replace_extension(bakedExtensions.texture);
-
-      baseColorPath = converterState.convertToExportRelative(baseColorPath);
-
-      newMaterial.textures["metallicRoughness"] = baseColorPath.string();
+      newMaterial.textureNames[(u32)MaterialTextureSlot::MetallicRoughness] = textureName(pbr.metallicRoughnessTexture.index);
     }
-
     if(gltfMat.normalTexture.index >= 0) {
-      tinygltf::Texture image = model.textures[gltfMat.normalTexture.index];
-      tinygltf::Image baseImage = model.images[image.source];
-
-      fs::path baseColorPath = outputFolder.parent_path() / baseImage.uri;
-
-      baseColorPath.replace_extension(bakedExtensions.texture);
-
-      baseColorPath = converterState.convertToExportRelative(baseColorPath);
-
-      newMaterial.textures["normals"] = baseColorPath.string();
+      newMaterial.textureNames[(u32)MaterialTextureSlot::Normals] = textureName(gltfMat.normalTexture.index);
     }
-
     if(gltfMat.occlusionTexture.index >= 0) {
-      tinygltf::Texture image = model.textures[gltfMat.occlusionTexture.index];
-      tinygltf::Image baseImage = model.images[image.source];
-
-      fs::path baseColorPath = outputFolder.parent_path() / baseImage.uri;
-
-      baseColorPath.replace_extension(bakedExtensions.texture);
-
-      baseColorPath = converterState.convertToExportRelative(baseColorPath);
-
-      newMaterial.textures["occlusion"] = baseColorPath.string();
+      newMaterial.textureNames[(u32)MaterialTextureSlot::Occlusion] = textureName(gltfMat.occlusionTexture.index);
     }
-
     if(gltfMat.emissiveTexture.index >= 0) {
-      tinygltf::Texture image = model.textures[gltfMat.emissiveTexture.index];
-      tinygltf::Image baseImage = model.images[image.source];
-
-      fs::path baseColorPath = outputFolder.parent_path() / baseImage.uri;
-
-      baseColorPath.replace_extension(bakedExtensions.texture);
-
-      baseColorPath = converterState.convertToExportRelative(baseColorPath);
+      newMaterial.textureNames[(u32)MaterialTextureSlot::Emissive] = textureName(gltfMat.emissiveTexture.index);
+    }
 
-      newMaterial.textures["emissive"] = baseColorPath.string();
+    assets::MaterialRecord& record = newMaterial.record;
+    for(u32 i = 0; i < ArrayCount(record.baseColorFactor) && i < pbr.baseColorFactor.size(); i++) {
+      record.baseColorFactor[i] = (f32)pbr.baseColorFactor[i];
+    }
+    for(u32 i = 0; i < ArrayCount(record.emissiveFactor) && i < gltfMat.emissiveFactor.size(); i++) {
+      record.emissiveFactor[i] = (f32)gltfMat.emissiveFactor[i];
     }
+    record.metallicFactor = (f32)pbr.metallicFactor;
+    record.roughnessFactor = (f32)pbr.roughnessFactor;
+    record.normalScale = (f32)gltfMat.normalTexture.scale;
+    record.occlusionStrength = (f32)gltfMat.occlusionTexture.strength;
+    record.alphaCutoff = (f32)gltfMat.alphaCutoff;
 
     fs::path materialPath = outputFolder / (matName + bakedExtensions.material);
 
     if(gltfMat.alphaMode.compare("BLEND") == 0) {
-      newMaterial.transparency = TransparencyMode::Transparent;
+      record.transparency = TransparencyMode::Transparent;
+    } else if(gltfMat.alphaMode.compare("MASK") == 0) {
+      record.transparency = TransparencyMode::Masked;
     } else {
-      newMaterial.transparency = TransparencyMode::Opaque;
+      record.transparency = TransparencyMode::Opaque;
     }
 
     assets::AssetFile newFile = assets::packMaterial(&newMaterial);
 
     //save to disk
-    saveAssetFile(materialPath.string().c_str(), newFile);
-    converterState.bakedFilePaths.push_back(materialPath);
+    converterState.saveBakedAsset(materialPath, newFile, false);
   }
 }
 
 void extractGltfNodes(tinygltf::Model& model, const fs::path& input, const fs::path& outputFolder, ConverterState& converterState) {
   assets::PrefabInfo prefab;
 
-  std::vector<u64> meshNodes;
   u32 gltfNodeCount = (u32)model.nodes.size();
+  prefab.nodeParents.resize(gltfNodeCount, PREFAB_ROOT_NODE);
+  prefab.nodeMatrices.resize(gltfNodeCount);
+  prefab.nodeMeshes.resize(gltfNodeCount, PREFAB_NO_MESH);
+  prefab.nodeNames.resize(gltfNodeCount);
+
+  auto addNodeMesh = [&](int meshIndex, int primitiveIndex) -> s32 {
+    const tinygltf::Primitive& primitive = model.meshes[meshIndex].primitives[primitiveIndex];
+    assets::PrefabInfo::NodeMesh nodeMesh;
+    nodeMesh.meshName = bakedAssetName(calculateGltfMeshName(model, meshIndex, primitiveIndex));
+    if(primitive.material >= 0) {
+      nodeMesh.materialName = bakedAssetName(calculateGltfMaterialName(model, primitive.material));
+    }
+    prefab.meshes.push_back(nodeMesh);
+    return (s32)prefab.meshes.size() - 1;
+  };
+
+  std::vector<u32> multiPrimitiveNodes;
   for(u32 i = 0; i < gltfNodeCount; i++) {
     auto& node = model.nodes[i];
     prefab.nodeNames[i] = node.name;
 
     mat4 nodeMatrix;
 
-    mat4 flipY = mat4{ 1.0 };
-    flipY.val2d[1][1] = -1;
-
     //node has a nodeMatrix
     if(!node.matrix.empty()) {
       for(u32 n = 0; n < 16; n++) {
         nodeMatrix.val[n] = (f32)node.matrix[n];
       }
-      //nodeMatrix = nodeMatrix * flipY;
     } else { //separate transforms
       mat4 translation{1.f};
       if(!node.translation.empty()) {
@@ -1021,35 +1059,15 @@ void extractGltfNodes(tinygltf::Model& model, const fs::path& input, const fs::p
                                      (f32)node.scale[2]});
       }
 
-      mat4 transformMatrix = (translation * rotation * scale);// * flipY;
-      memcpy(nodeMatrix.val, &transformMatrix, sizeof(mat4));
+      nodeMatrix = translation * rotation * scale;
     }
-
-    prefab.nodeMatrices[i] = (u32)prefab.matrices.size();
-    prefab.matrices.push_back(nodeMatrix);
+    prefab.nodeMatrices[i] = nodeMatrix;
 
     if(node.mesh >= 0) {
-      auto mesh = model.meshes[node.mesh];
-
-      if(mesh.primitives.size() > 1) {
-        meshNodes.push_back(i);
+      if(model.meshes[node.mesh].primitives.size() > 1) {
+        multiPrimitiveNodes.push_back(i);
       } else {
-        auto primitive = mesh.primitives[0];
-        std::string meshName = calculateGltfMeshName(model, node.mesh, 0);
-
-        fs::path meshPath = outputFolder / (meshName + bakedExtensions.mesh);
-
-        int material = primitive.material;
-
-        std::string matName = calculateGltfMaterialName(model, material);
-
-        fs::path materialPath = outputFolder / (matName + bakedExtensions.material);
-
-        assets::PrefabInfo::NodeMesh nodeMesh;
-        nodeMesh.meshPath = converterState.convertToExportRelative(meshPath).string();
-        nodeMesh.materialPath = converterState.convertToExportRelative(materialPath).string();
-
-        prefab.nodeMeshes[i] = nodeMesh;
+        prefab.nodeMeshes[i] = addNodeMesh(node.mesh, 0);
       }
     }
   }
@@ -1058,73 +1076,37 @@ void extractGltfNodes(tinygltf::Model& model, const fs::path& input, const fs::p
   //gltf stores children, but we want parent
   for(u32 i = 0; i < gltfNodeCount; i++) {
     for(auto c: model.nodes[i].children) {
-      prefab.nodeParents[c] = i;
+      prefab.nodeParents[c] = (s32)i;
     }
   }
 
   //for every gltf node that is a root node (no parents), apply the coordinate fixup
-
   mat4 flip = mat4{1.0};
   flip.val2d[1][1] = -1;
-
-
-  mat4 rotation = mat4{1.0};
-  //flip[1][1] = -1;
-  rotation = rotate_mat4(radians(-180.f), vec3{1, 0, 0});
-
-
-  //flip[2][2] = -1;
+  mat4 rotation = rotate_mat4(radians(-180.f), vec3{1, 0, 0});
   for(u32 i = 0; i < gltfNodeCount; i++) {
-    auto it = prefab.nodeParents.find(i);
-    if(it == prefab.nodeParents.end()) {
-      auto matrix = prefab.matrices[prefab.nodeMatrices[i]];
-      //no parent, root node
-      mat4 mat;
-      memcpy(&mat, &matrix, sizeof(mat4));
-
-      mat = rotation * (flip * mat);
-      memcpy(&matrix, &mat, sizeof(mat4));
-
-      prefab.matrices[prefab.nodeMatrices[i]] = matrix;
+    if(prefab.nodeParents[i] == PREFAB_ROOT_NODE) {
+      prefab.nodeMatrices[i] = rotation * (flip * prefab.nodeMatrices[i]);
     }
   }
 
-  size_t nodeIndex = model.nodes.size();
-  //iterate nodes with mesh, convert each submesh into a node
-  u32 meshNodesCount = (u32)meshNodes.size();
-  for(u32 i = 0; i < meshNodesCount; i++) {
-    tinygltf::Node& node = model.nodes[i];
-
-    if(node.mesh < 0) break;
-
-    tinygltf::Mesh mesh = model.meshes[node.mesh];
-
-    for(int primindex = 0; primindex < mesh.primitives.size(); primindex++) {
-      tinygltf::Primitive primitive = mesh.primitives[primindex];
-
-      char buffer[50];
-
-      itoa(primindex, buffer, 10);
-
-      prefab.nodeNames[nodeIndex] = prefab.nodeNames[i] + "_PRIM_" + &buffer[0];
-
-      int material = primitive.material;
-      auto mat = model.materials[material];
-      std::string matName = calculateGltfMaterialName(model, material);
-      std::string meshName = calculateGltfMeshName(model, node.mesh, primindex);
-
-      fs::path materialPath = outputFolder / (matName + bakedExtensions.material);
-      fs::path meshPath = outputFolder / (meshName + bakedExtensions.mesh);
-
-      assets::PrefabInfo::NodeMesh nodeMesh;
-      nodeMesh.meshPath = converterState.convertToExportRelative(meshPath).string();
-      nodeMesh.materialPath = converterState.convertToExportRelative(materialPath).string();
-
-      prefab.nodeMeshes[nodeIndex] = nodeMesh;
-      nodeIndex++;
+  // every primitive of a multi-primitive mesh becomes a child node carrying just that primitive
+  mat4 identity{1.f};
+  for(u32 nodeIndex: multiPrimitiveNodes) {
+    tinygltf::Node& node = model.nodes[nodeIndex];
+    u32 primitiveCount = (u32)model.meshes[node.mesh].primitives.size();
+    for(u32 primIndex = 0; primIndex < primitiveCount; primIndex++) {
+      prefab.nodeParents.push_back((s32)nodeIndex);
+      prefab.nodeMatrices.push_back(identity);
+      prefab.nodeMeshes.push_back(addNodeMesh(node.mesh, primIndex));
+      prefab.nodeNames.push_back(prefab.nodeNames[nodeIndex] + "_PRIM_" + std::to_string(primIndex));
     }
   }
 
+  if(!assets::sortPrefabNodes(&prefab)) {
+    std::cout << "Failed to sort nodes of prefab " << input << std::endl;
+    return;
+  }
 
   assets::AssetFile newFile = assets::packPrefab(prefab);
 
@@ -1133,8 +1115,7 @@ void extractGltfNodes(tinygltf::Model& model, const fs::path& input, const fs::p
   sceneFilePath.replace_extension(bakedExtensions.prefab);
 
   //save to disk
-  saveAssetFile(sceneFilePath.string().c_str(), newFile);
-  converterState.bakedFilePaths.push_back(sceneFilePath);
+  converterState.saveBakedAsset(sceneFilePath, newFile, false);
 }
 
 bool extractObjCombinedMesh(tinyobj::ObjReader& objReader, const fs::path& filePath, const fs::path& outputFolder, ConverterState& converterState) {
@@ -1268,6 +1249,7 @@ bool extractObjCombinedMesh(tinyobj::ObjReader& objReader, const fs::path& fileP
   meshInfo.indexSize = sizeof(u32);
   meshInfo.originalFile = filePath.string();
   meshInfo.bounds = assets::calculateBounds(vertices.data(), vertices.size());
+  meshInfo.filterMask = bakedMeshFilters;
 
   assets::AssetFile newFile = assets::packMesh(meshInfo, (char*)vertices.data(), (char*)indices.data());
 
@@ -1275,8 +1257,7 @@ bool extractObjCombinedMesh(tinyobj::ObjReader& objReader, const fs::path& fileP
   fs::path meshPath = outputFolder / newFileName;
 
   //save to disk
-  saveAssetFile(meshPath.string().c_str(), newFile);
-  converterState.bakedFilePaths.push_back(meshPath);
+  converterState.saveBakedAsset(meshPath, newFile, true);
 
   return true;
 }
@@ -1285,6 +1266,85 @@ fs::path ConverterState::convertToExportRelative(const fs::path& path) const {
   return path.lexically_proximate(bakedAssetDir);
 }
 
+fs::path ConverterState::blobDir() const {
+  return bakedAssetDir / "blobs";
+}
+
+void ConverterState::saveBakedAsset(const fs::path& aliasPath, const assets::AssetFile& file, bool contentAddressed) {
+  AssetBakeCachedItem::BakedFile bakedFile;
+  bakedFile.name = aliasPath.filename().string();
+  bakedFile.ext = aliasPath.extension().string();
+  bakedFile.payloadHash = 0;
+
+  if(!contentAddressed) {
+    saveAssetFile(aliasPath.string().c_str(), file);
+    bakedFile.path = aliasPath.string();
+    bakedFiles.push_back(bakedFile);
+    return;
+  }
+
+  u64 payloadHash = hashBakedPayload(file);
+  auto existingBlob = blobPathsByHash.find(payloadHash);
+  if(existingBlob != blobPathsByHash.end()) {
+    // guard against the (astronomically unlikely) hash collision before sharing, comparing everything that was hashed
+    assets::AssetFile existingFile;
+    if(loadAssetFile(existingBlob->second.c_str(), &existingFile) &&
+       memcmp(existingFile.type, file.type, FILE_TYPE_SIZE_IN_BYTES) == 0 &&
+       existingFile.version == file.version &&
+       canonicalBakedMetadata(existingFile) == canonicalBakedMetadata(file) &&
+       existingFile.binaryBlob == file.binaryBlob) {
+      printf("Baked asset \"%s\" is a duplicate of \"%s\"\n", bakedFile.name.c_str(), existingBlob->second.c_str());
+      bakedFile.path = existingBlob->second;
+      bakedFile.payloadHash = payloadHash;
+      bakedFiles.push_back(bakedFile);
+      return;
+    }
+    printf("Payload hash collision for baked asset \"%s\", storing it separately\n", bakedFile.name.c_str());
+    saveAssetFile(aliasPath.string().c_str(), file);
+    bakedFile.path = aliasPath.string();
+    bakedFiles.push_back(bakedFile);
+    return;
+  }
+
+  char hashStr[17];
+  snprintf(hashStr, ArrayCount(hashStr), "%016llx", (unsigned long long)payloadHash);
+  fs::path blobPath = blobDir() / (std::string(hashStr) + bakedFile.ext);
+  saveAssetFile(blobPath.string().c_str(), file);
+
+  blobPathsByHash[payloadHash] = blobPath.string();
+  bakedFile.path = blobPath.string();
+  bakedFile.payloadHash = payloadHash;
+  bakedFiles.push_back(bakedFile);
+}
+
+std::string bakedAssetName(std::string fileStem) {
+  const char tokensToReplace[] = {'.', '-'};
+  replace(fileStem, tokensToReplace, ArrayCount(tokensToReplace), '_');
+  return fileStem;
+}
+
+std::string canonicalBakedMetadata(const assets::AssetFile& file) {
+  // The original file is provenance only and would otherwise keep identical payloads from different sources apart
+  nlohmann::json metadata = nlohmann::json::parse(file.json);
+  metadata.erase("original_file");
+  return metadata.dump();
+}
+
+u64 hashBakedPayload(const assets::AssetFile& file) {
+  std::string canonicalMetadata = canonicalBakedMetadata(file);
+
+  XXH64_state_t* hashState = XXH64_createState();
+  XXH64_reset(hashState, 0);
+  XXH64_update(hashState, file.type, FILE_TYPE_SIZE_IN_BYTES);
+  XXH64_update(hashState, &file.version, sizeof(file.version));
+  XXH64_update(hashState, canonicalMetadata.data(), canonicalMetadata.size());
+  XXH64_update(hashState, file.binaryBlob.data(), file.binaryBlob.size());
+  u64 payloadHash = XXH64_digest(hashState);
+  XXH64_freeState(hashState);
+
+  return payloadHash == 0 ? 1 : payloadHash; // 0 is reserved for assets that aren't content addressed
+}
+
 std::size_t fileCountInDir(fs::path dirPath) {
   std::size_t fileCount = 0u;
   for(auto const& file: std::filesystem::directory_iterator(dirPath)) {
@@ -1314,52 +1374,103 @@ void replaceBackSlashes(std::string& str) {
   }
 }
 
+std::vector<BakedTableEntry> bakedTableEntries(const std::unordered_map<std::string, AssetBakeCachedItem>& oldCache, const ConverterState& converterState, const char* fileExt) {
+  std::vector<BakedTableEntry> entries;
+
+  auto addEntry = [&](const AssetBakeCachedItem::BakedFile& bakedFile) {
+    if(bakedFile.ext != fileExt) { return; }
+    BakedTableEntry entry;
+    entry.name = bakedAssetName(std::string(bakedFile.name.begin(), bakedFile.name.end() - bakedFile.ext.size()));
+    entry.path = bakedFile.path;
+    replaceBackSlashes(entry.path);
+    entries.push_back(entry);
+  };
+
+  for(const AssetBakeCachedItem::BakedFile& bakedFile: converterState.bakedFiles) {
+    addEntry(bakedFile);
+  }
+  for(auto& [originalFileName, cachedItem] : oldCache) {
+    for(const AssetBakeCachedItem::BakedFile& bakedFile: cachedItem.bakedFiles) {
+      addEntry(bakedFile);
+    }
+  }
+
+  // sorted so an asset's index stays put no matter the order files were baked in
+  std::sort(entries.begin(), entries.end(), [](const BakedTableEntry& a, const BakedTableEntry& b) {
+    return a.name < b.name;
+  });
+  return entries;
+}
+
+void resolveBakedMaterials(const std::unordered_map<std::string, AssetBakeCachedItem>& oldCache, const ConverterState& converterState) {
+  std::vector<std::string> sortedTextureNames;
+  for(const BakedTableEntry& textureEntry : bakedTableEntries(oldCache, converterState, bakedExtensions.texture)) {
+    sortedTextureNames.push_back(textureEntry.name);
+  }
+
+  // cached materials are revisited too, adding or removing any texture shifts the indices after it
+  for(const BakedTableEntry& materialEntry : bakedTableEntries(oldCache, converterState, bakedExtensions.material)) {
+    assets::AssetFile materialFile;
+    if(!loadAssetFile(materialEntry.path.c_str(), &materialFile)) {
+      printf("Failed to load baked material \"%s\"\n", materialEntry.path.c_str());
+      continue;
+    }
+
+    assets::MaterialInfo materialInfo = assets::readMaterialInfo(&materialFile);
+    if(materialFile.binaryBlob.size() != sizeof(assets::MaterialRecord)) {
+      continue; // predates material records and has no texture names to resolve
+    }
+
+    assets::MaterialRecord previousRecord = materialInfo.record;
+    assets::resolveMaterialTextures(&materialInfo, sortedTextureNames);
+    if(memcmp(&previousRecord, &materialInfo.record, sizeof(assets::MaterialRecord)) == 0) {
+      continue;
+    }
+
+    assets::AssetFile resolvedFile = assets::packMaterial(&materialInfo);
+    saveAssetFile(materialEntry.path.c_str(), resolvedFile);
+  }
+}
+
 void writeOutputData(const std::unordered_map<std::string, AssetBakeCachedItem>& oldCache, const ConverterState& converterState) {
   if(!fs::is_directory(converterState.outputFileDir)) {
     fs::create_directory(converterState.outputFileDir);
   }
 
-  std::ofstream outTexturesFile, outMeshFile, outMaterialFile, outPrefabFile;
-  outTexturesFile.open((converterState.outputFileDir / "baked_textures.incl").string(), std::ios::out);
-  outMeshFile.open((converterState.outputFileDir / "baked_meshes.incl").string(), std::ios::out);
-  outMaterialFile.open((converterState.outputFileDir / "baked_materials.incl").string(), std::ios::out);
-  outPrefabFile.open((converterState.outputFileDir / "baked_prefabs.incl").string(), std::ios::out);
-
-  auto write = [&](std::string bakedPath, std::string originalFileName, const char* fileExt) {
-    const char tokensToReplace[] = {'.', '-'};
-    replace(originalFileName, tokensToReplace, ArrayCount(tokensToReplace), '_');
-    replaceBackSlashes(bakedPath);
-    if(strcmp(fileExt, bakedExtensions.texture) == 0) {
-      outTexturesFile << "BakedTexture(" << originalFileName << ",\"" << bakedPath << "\")\n";
-    } else if(strcmp(fileExt, bakedExtensions.material) == 0) {
-      outMaterialFile << "BakedMaterial(" << originalFileName << ",\"" << bakedPath << "\")\n";
-    } else if(strcmp(fileExt, bakedExtensions.mesh) == 0) {
-      outMeshFile << "BakedMesh(" << originalFileName << ",\"" << bakedPath << "\")\n";
-    } else if(strcmp(fileExt, bakedExtensions.prefab) == 0) {
-      outPrefabFile << "BakedPrefab(" << originalFileName << ",\"" << bakedPath << "\")\n";
+  auto writeTable = [&](const char* tableFileName, const char* entryMacro, const char* fileExt) {
+    std::ofstream outFile;
+    outFile.open((converterState.outputFileDir / tableFileName).string(), std::ios::out);
+    for(const BakedTableEntry& entry : bakedTableEntries(oldCache, converterState, fileExt)) {
+      outFile << entryMacro << "(" << entry.name << ",\"" << entry.path << "\")\n";
     }
+    outFile.close();
   };
 
-  for(const fs::path& path: converterState.bakedFilePaths) {
-    std::string extensionStr = path.extension().string();
-    std::string fileName = path.filename().replace_extension("").string();
-    std::string filePath = path.string();
-    write(filePath, fileName, extensionStr.c_str());
-  }
+  writeTable("baked_textures.incl", "BakedTexture", bakedExtensions.texture);
+  writeTable("baked_meshes.incl", "BakedMesh", bakedExtensions.mesh);
+  writeTable("baked_materials.incl", "BakedMaterial", bakedExtensions.material);
+  writeTable("baked_prefabs.incl", "BakedPrefab", bakedExtensions.prefab);
+}
 
-  for(auto [originalFileName, cachedItem] : oldCache) {
-    u32 cachedBakedFileCount = (u32)cachedItem.bakedFiles.size();
-    for(u32 i = 0; i < cachedBakedFileCount; i++) {
-      const AssetBakeCachedItem::BakedFile& bakedFile = cachedItem.bakedFiles[i];
-      std::string extensionStr = bakedFile.ext;
-      std::string fileName = std::string(bakedFile.name.begin(), bakedFile.name.end() - bakedFile.ext.size());
-      std::string filePath = bakedFile.path;
-      write(filePath, fileName, extensionStr.c_str());
+void removeUnreferencedBlobs(const std::unordered_map<std::string, AssetBakeCachedItem>& oldCache, const ConverterState& converterState) {
+  std::unordered_set<std::string> referencedBlobs;
+  for(const AssetBakeCachedItem::BakedFile& bakedFile: converterState.bakedFiles) {
+    referencedBlobs.insert(fs::path(bakedFile.path).filename().string());
+  }
+  for(auto& [originalFileName, cachedItem] : oldCache) {
+    for(const AssetBakeCachedItem::BakedFile& bakedFile: cachedItem.bakedFiles) {
+      referencedBlobs.insert(fs::path(bakedFile.path).filename().string());
     }
   }
 
-  outTexturesFile.close();
-  outMeshFile.close();
-  outMaterialFile.close();
-  outPrefabFile.close();
-}
\ No newline at end of file
+  std::vector<fs::path> unreferencedBlobs;
+  for(const fs::directory_entry& blob: fs::directory_iterator(converterState.blobDir())) {
+    if(referencedBlobs.find(blob.path().filename().string()) == referencedBlobs.end()) {
+      unreferencedBlobs.push_back(blob.path());
+    }
+  }
+  for(const fs::path& blobPath: unreferencedBlobs) {
+    printf("Removing unreferenced blob \"%s\"\n", blobPath.string().c_str());
+    fs::remove(blobPath);
+  }
+}
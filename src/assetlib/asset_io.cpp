@@ -0,0 +1,565 @@
+#include "asset_io.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define ASSET_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#define ASSET_IO_MAX_READ_SIZE (1u << 30) // largest single read handed to the OS
+
+namespace assets {
+  struct ReadRequest {
+    std::string path;
+    ReadAheadHint hint;
+    FileReadCallback callback;
+    std::vector<char> bytes;
+    bool success;
+    // io_uring only
+    s32 fd;
+    u64 bytesRead;
+  };
+
+#ifdef ASSET_IO_URING
+  struct IoUring {
+    s32 ringFd;
+    u32 queueDepth;
+    u32 inFlightCount;
+    std::condition_variable slotAvailable;
+    std::mutex submitMutex;
+    std::thread reaper;
+
+    void* sqRing;
+    u64 sqRingSize;
+    void* cqRing;
+    u64 cqRingSize;
+    io_uring_sqe* sqes;
+    u64 sqesSize;
+
+    std::atomic<u32>* sqHead;
+    std::atomic<u32>* sqTail;
+    u32 sqMask;
+    u32* sqArray;
+    std::atomic<u32>* cqHead;
+    std::atomic<u32>* cqTail;
+    u32 cqMask;
+    io_uring_cqe* cqes;
+  };
+#endif
+
+  struct AsyncIOContext {
+    AsyncIOBackend backend;
+
+    // workers complete callbacks for both backends and perform the reads for the thread pool backend
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex jobMutex;
+    std::condition_variable jobAvailable;
+    bool quit;
+
+    std::mutex outstandingMutex;
+    std::condition_variable outstandingDone;
+    u64 outstandingCount;
+
+#ifdef ASSET_IO_URING
+    IoUring uring;
+#endif
+  };
+}
+
+const internal_access char* mapAsyncIOBackendToString[] = {
+        "ThreadPool",
+        "IoUring",
+};
+
+internal_access void workerLoop(assets::AsyncIOContext* context) {
+  while(true) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(context->jobMutex);
+      context->jobAvailable.wait(lock, [context] { return context->quit || !context->jobs.empty(); });
+      if(context->jobs.empty()) { return; } // quit only once the queue is drained
+      job = std::move(context->jobs.front());
+      context->jobs.pop_front();
+    }
+    job();
+  }
+}
+
+internal_access void pushJob(assets::AsyncIOContext* context, std::function<void()>&& job) {
+  {
+    std::lock_guard<std::mutex> lock(context->jobMutex);
+    context->jobs.push_back(std::move(job));
+  }
+  context->jobAvailable.notify_one();
+}
+
+internal_access void beginRequest(assets::AsyncIOContext* context) {
+  std::lock_guard<std::mutex> lock(context->outstandingMutex);
+  context->outstandingCount++;
+}
+
+// Runs the user's callback and releases the request, always called from a worker thread
+internal_access void finishRequest(assets::AsyncIOContext* context, assets::ReadRequest* request) {
+  assets::AsyncReadResult result;
+  result.path = request->path.c_str();
+  result.success = request->success;
+  result.bytes = std::move(request->bytes);
+  if(!result.success) {
+    printf("Async read failed for file: %s\n", result.path);
+    result.bytes.clear();
+  }
+  request->callback(result);
+  delete request;
+
+  bool idle;
+  {
+    std::lock_guard<std::mutex> lock(context->outstandingMutex);
+    context->outstandingCount--;
+    idle = context->outstandingCount == 0;
+  }
+  if(idle) { context->outstandingDone.notify_all(); }
+}
+
+#if defined(_WIN32)
+internal_access bool readWholeFile(const char* path, assets::ReadAheadHint hint, std::vector<char>& outBytes) {
+  DWORD flags = FILE_ATTRIBUTE_NORMAL;
+  if(hint == assets::ReadAheadHint::Sequential) { flags |= FILE_FLAG_SEQUENTIAL_SCAN; }
+
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+  if(file == INVALID_HANDLE_VALUE) { return false; }
+
+  LARGE_INTEGER fileSize;
+  if(!GetFileSizeEx(file, &fileSize)) {
+    CloseHandle(file);
+    return false;
+  }
+  outBytes.resize(fileSize.QuadPart);
+
+  // OVERLAPPED offsets on a synchronous handle behave like pread
+  u64 bytesRead = 0;
+  while(bytesRead < outBytes.size()) {
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = (DWORD)(bytesRead & 0xFFFFFFFF);
+    overlapped.OffsetHigh = (DWORD)(bytesRead >> 32);
+    DWORD readSize = (DWORD)MIN(outBytes.size() - bytesRead, ASSET_IO_MAX_READ_SIZE);
+    DWORD chunkBytesRead = 0;
+    if(!ReadFile(file, outBytes.data() + bytesRead, readSize, &chunkBytesRead, &overlapped) || chunkBytesRead == 0) { break; }
+    bytesRead += chunkBytesRead;
+  }
+
+  CloseHandle(file);
+  return bytesRead == outBytes.size();
+}
+
+internal_access void prefetchFile(const char* /*path*/) {
+  // Windows has no per-file read ahead request, FILE_FLAG_SEQUENTIAL_SCAN on the actual read is the closest equivalent
+}
+#else
+internal_access void adviseReadAhead(s32 fd, u64 fileSize, assets::ReadAheadHint hint) {
+  switch(hint) {
+    case assets::ReadAheadHint::Sequential:
+      posix_fadvise(fd, 0, fileSize, POSIX_FADV_SEQUENTIAL);
+      break;
+    case assets::ReadAheadHint::WillNeed:
+      posix_fadvise(fd, 0, fileSize, POSIX_FADV_WILLNEED);
+      break;
+    default:
+      break;
+  }
+}
+
+// opens the file and sizes the buffer that will hold it
+internal_access bool openForRead(const char* path, assets::ReadAheadHint hint, s32* outFd, std::vector<char>& outBytes) {
+  s32 fd = open(path, O_RDONLY | O_CLOEXEC);
+  if(fd < 0) { return false; }
+
+  struct stat fileStat;
+  if(fstat(fd, &fileStat) != 0) {
+    close(fd);
+    return false;
+  }
+
+  adviseReadAhead(fd, fileStat.st_size, hint);
+  outBytes.resize(fileStat.st_size);
+  *outFd = fd;
+  return true;
+}
+
+internal_access bool readWholeFile(const char* path, assets::ReadAheadHint hint, std::vector<char>& outBytes) {
+  s32 fd;
+  if(!openForRead(path, hint, &fd, outBytes)) { return false; }
+
+  u64 bytesRead = 0;
+  while(bytesRead < outBytes.size()) {
+    u64 readSize = MIN(outBytes.size() - bytesRead, ASSET_IO_MAX_READ_SIZE);
+    ssize_t chunkBytesRead = pread(fd, outBytes.data() + bytesRead, readSize, bytesRead);
+    if(chunkBytesRead < 0 && errno == EINTR) { continue; }
+    if(chunkBytesRead <= 0) { break; }
+    bytesRead += chunkBytesRead;
+  }
+
+  close(fd);
+  return bytesRead == outBytes.size();
+}
+
+internal_access void prefetchFile(const char* path) {
+  s32 fd = open(path, O_RDONLY | O_CLOEXEC);
+  if(fd < 0) { return; }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED); // length of 0 extends to the end of the file
+  close(fd);
+}
+#endif
+
+#ifdef ASSET_IO_URING
+#define IO_URING_QUIT_USER_DATA 0 // user_data of the no-op that wakes the reaper on shutdown
+
+internal_access s32 ioUringSetup(u32 entries, io_uring_params* params) {
+  return (s32)syscall(__NR_io_uring_setup, entries, params);
+}
+
+internal_access s32 ioUringEnter(s32 ringFd, u32 toSubmit, u32 minComplete, u32 flags) {
+  return (s32)syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+internal_access s32 ioUringRegister(s32 ringFd, u32 opcode, void* arg, u32 argCount) {
+  return (s32)syscall(__NR_io_uring_register, ringFd, opcode, arg, argCount);
+}
+
+// Queues a single SQE and hands it to the kernel, caller must hold submitMutex
+internal_access void pushSqe(assets::IoUring& uring, u8 opcode, s32 fd, void* dst, u32 readSize, u64 offset, u64 userData) {
+  u32 tail = uring.sqTail->load(std::memory_order_relaxed);
+  u32 index = tail & uring.sqMask;
+  io_uring_sqe* sqe = &uring.sqes[index];
+  memset(sqe, 0, sizeof(io_uring_sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = (u64)dst;
+  sqe->len = readSize;
+  sqe->off = offset;
+  sqe->user_data = userData;
+  uring.sqArray[index] = index;
+  uring.sqTail->store(tail + 1, std::memory_order_release);
+
+  while(ioUringEnter(uring.ringFd, 1, 0, 0) < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY)) {}
+}
+
+// Reads the remainder of the request, caller must hold submitMutex
+internal_access void queueUringRead(assets::IoUring& uring, assets::ReadRequest* request) {
+  u64 remaining = request->bytes.size() - request->bytesRead;
+  u32 readSize = (u32)MIN(remaining, ASSET_IO_MAX_READ_SIZE);
+  pushSqe(uring, IORING_OP_READ, request->fd, request->bytes.data() + request->bytesRead, readSize, request->bytesRead, (u64)request);
+}
+
+internal_access void reaperLoop(assets::AsyncIOContext* context) {
+  assets::IoUring& uring = context->uring;
+  while(true) {
+    s32 enterResult = ioUringEnter(uring.ringFd, 0, 1, IORING_ENTER_GETEVENTS);
+    if(enterResult < 0 && errno != EINTR) {
+      printf("io_uring_enter failed while waiting on completions: %d\n", errno);
+    }
+
+    u32 head = uring.cqHead->load(std::memory_order_relaxed);
+    u32 tail = uring.cqTail->load(std::memory_order_acquire);
+    // Requests are handed off through the kernel, which gives no happens-before edge the compiler or sanitizers can see.
+    // The submitter holds submitMutex while queueing, so acquiring it here orders its writes before ours.
+    { std::lock_guard<std::mutex> lock(uring.submitMutex); }
+    bool quit = false;
+    u32 completedCount = 0;
+    for(; head != tail; head++) {
+      io_uring_cqe cqe = uring.cqes[head & uring.cqMask];
+      if(cqe.user_data == IO_URING_QUIT_USER_DATA) {
+        quit = true;
+        continue;
+      }
+
+      assets::ReadRequest* request = (assets::ReadRequest*)cqe.user_data;
+      if(cqe.res == -EINTR || cqe.res == -EAGAIN) {
+        std::lock_guard<std::mutex> lock(uring.submitMutex);
+        queueUringRead(uring, request); // retry without giving up the slot
+        continue;
+      }
+
+      if(cqe.res > 0) { request->bytesRead += cqe.res; }
+      bool done = cqe.res <= 0 || request->bytesRead == request->bytes.size();
+      if(!done) { // short read, ask for the rest
+        std::lock_guard<std::mutex> lock(uring.submitMutex);
+        queueUringRead(uring, request);
+        continue;
+      }
+
+      close(request->fd);
+      request->success = request->bytesRead == request->bytes.size();
+      completedCount++;
+      pushJob(context, [context, request] { finishRequest(context, request); });
+    }
+    uring.cqHead->store(head, std::memory_order_release);
+
+    if(completedCount > 0) {
+      {
+        std::lock_guard<std::mutex> lock(uring.submitMutex);
+        uring.inFlightCount -= completedCount;
+      }
+      uring.slotAvailable.notify_all();
+    }
+
+    if(quit) { return; }
+  }
+}
+
+internal_access void destroyIoUring(assets::IoUring& uring) {
+  if(uring.sqes != nullptr) { munmap(uring.sqes, uring.sqesSize); }
+  if(uring.cqRing != nullptr && uring.cqRing != uring.sqRing) { munmap(uring.cqRing, uring.cqRingSize); }
+  if(uring.sqRing != nullptr) { munmap(uring.sqRing, uring.sqRingSize); }
+  if(uring.ringFd >= 0) { close(uring.ringFd); }
+  uring.sqes = nullptr;
+  uring.cqRing = nullptr;
+  uring.sqRing = nullptr;
+  uring.ringFd = -1;
+}
+
+// Returns false if io_uring is unavailable (old kernel, seccomp, etc.) so the caller can fall back to the thread pool
+internal_access bool initIoUring(assets::AsyncIOContext* context, u32 queueDepth) {
+  assets::IoUring& uring = context->uring;
+  uring.ringFd = -1;
+  uring.sqRing = nullptr;
+  uring.cqRing = nullptr;
+  uring.sqes = nullptr;
+  uring.inFlightCount = 0;
+
+  io_uring_params params = {};
+  uring.ringFd = ioUringSetup(queueDepth, &params);
+  if(uring.ringFd < 0) { return false; }
+
+  // IORING_OP_READ arrived in 5.6, the same kernel that introduced probing
+  const u32 probeOpCount = 256;
+  u64 probeSize = sizeof(io_uring_probe) + (probeOpCount * sizeof(io_uring_probe_op));
+  std::vector<u8> probeBytes(probeSize, 0);
+  io_uring_probe* probe = (io_uring_probe*)probeBytes.data();
+  if(ioUringRegister(uring.ringFd, IORING_REGISTER_PROBE, probe, probeOpCount) < 0 ||
+     probe->last_op < IORING_OP_READ ||
+     !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)) {
+    destroyIoUring(uring);
+    return false;
+  }
+
+  uring.sqRingSize = params.sq_off.array + (params.sq_entries * sizeof(u32));
+  uring.cqRingSize = params.cq_off.cqes + (params.cq_entries * sizeof(io_uring_cqe));
+  bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if(singleMmap) {
+    uring.sqRingSize = MAX(uring.sqRingSize, uring.cqRingSize);
+    uring.cqRingSize = uring.sqRingSize;
+  }
+
+  void* sqRing = mmap(nullptr, uring.sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring.ringFd, IORING_OFF_SQ_RING);
+  if(sqRing == MAP_FAILED) {
+    destroyIoUring(uring);
+    return false;
+  }
+  uring.sqRing = sqRing;
+
+  if(singleMmap) {
+    uring.cqRing = uring.sqRing;
+  } else {
+    void* cqRing = mmap(nullptr, uring.cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring.ringFd, IORING_OFF_CQ_RING);
+    if(cqRing == MAP_FAILED) {
+      destroyIoUring(uring);
+      return false;
+    }
+    uring.cqRing = cqRing;
+  }
+
+  uring.sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr, uring.sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring.ringFd, IORING_OFF_SQES);
+  if(sqes == MAP_FAILED) {
+    destroyIoUring(uring);
+    return false;
+  }
+  uring.sqes = (io_uring_sqe*)sqes;
+
+  char* sqRingBytes = (char*)uring.sqRing;
+  uring.sqHead = (std::atomic<u32>*)(sqRingBytes + params.sq_off.head);
+  uring.sqTail = (std::atomic<u32>*)(sqRingBytes + params.sq_off.tail);
+  uring.sqMask = *(u32*)(sqRingBytes + params.sq_off.ring_mask);
+  uring.sqArray = (u32*)(sqRingBytes + params.sq_off.array);
+
+  char* cqRingBytes = (char*)uring.cqRing;
+  uring.cqHead = (std::atomic<u32>*)(cqRingBytes + params.cq_off.head);
+  uring.cqTail = (std::atomic<u32>*)(cqRingBytes + params.cq_off.tail);
+  uring.cqMask = *(u32*)(cqRingBytes + params.cq_off.ring_mask);
+  uring.cqes = (io_uring_cqe*)(cqRingBytes + params.cq_off.cqes);
+
+  // Every in flight read may need a resubmission slot, so never hand the kernel more than the SQ can hold
+  uring.queueDepth = params.sq_entries - 1; // one entry is reserved for the shutdown no-op
+  uring.reaper = std::thread(reaperLoop, context);
+  return true;
+}
+
+internal_access void submitUringRead(assets::AsyncIOContext* context, assets::ReadRequest* request) {
+  assets::IoUring& uring = context->uring;
+
+  if(!openForRead(request->path.c_str(), request->hint, &request->fd, request->bytes)) {
+    request->success = false;
+    pushJob(context, [context, request] { finishRequest(context, request); });
+    return;
+  }
+
+  request->bytesRead = 0;
+  if(request->bytes.empty()) {
+    close(request->fd);
+    request->success = true;
+    pushJob(context, [context, request] { finishRequest(context, request); });
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(uring.submitMutex);
+  uring.slotAvailable.wait(lock, [&uring] { return uring.inFlightCount < uring.queueDepth; });
+  uring.inFlightCount++;
+  queueUringRead(uring, request);
+}
+
+internal_access void shutdownIoUring(assets::IoUring& uring) {
+  {
+    std::lock_guard<std::mutex> lock(uring.submitMutex);
+    pushSqe(uring, IORING_OP_NOP, -1, nullptr, 0, 0, IO_URING_QUIT_USER_DATA);
+  }
+  uring.reaper.join();
+  destroyIoUring(uring);
+}
+#endif
+
+bool assets::AsyncAssetReader::init(u32 workerCount, u32 queueDepth, bool allowIoUring) {
+  if(context != nullptr) { return true; }
+
+  context = new AsyncIOContext();
+  context->backend = AsyncIOBackend::ThreadPool;
+  context->quit = false;
+  context->outstandingCount = 0;
+
+#ifdef ASSET_IO_URING
+  if(allowIoUring && initIoUring(context, MAX(queueDepth, 2))) {
+    context->backend = AsyncIOBackend::IoUring;
+  }
+#endif
+
+  if(workerCount == 0) {
+    u32 hardwareThreadCount = MAX(std::thread::hardware_concurrency(), 1u);
+    // reads block the thread pool backend's workers, so it benefits from more threads than cores
+    workerCount = context->backend == AsyncIOBackend::ThreadPool ? MAX(hardwareThreadCount, 4) : MAX(hardwareThreadCount - 1, 1);
+  }
+
+  context->workers.reserve(workerCount);
+  for(u32 i = 0; i < workerCount; i++) {
+    context->workers.emplace_back(workerLoop, context);
+  }
+
+  return true;
+}
+
+void assets::AsyncAssetReader::shutdown() {
+  if(context == nullptr) { return; }
+
+  waitIdle();
+
+#ifdef ASSET_IO_URING
+  if(context->backend == AsyncIOBackend::IoUring) {
+    shutdownIoUring(context->uring);
+  }
+#endif
+
+  {
+    std::lock_guard<std::mutex> lock(context->jobMutex);
+    context->quit = true;
+  }
+  context->jobAvailable.notify_all();
+  for(std::thread& worker: context->workers) {
+    worker.join();
+  }
+
+  delete context;
+  context = nullptr;
+}
+
+void assets::AsyncAssetReader::readFile(const char* path, FileReadCallback&& callback, ReadAheadHint hint) {
+  Assert(context != nullptr);
+
+  ReadRequest* request = new ReadRequest();
+  request->path = path;
+  request->hint = hint;
+  request->callback = std::move(callback);
+  request->success = false;
+  beginRequest(context);
+
+#ifdef ASSET_IO_URING
+  if(context->backend == AsyncIOBackend::IoUring) {
+    submitUringRead(context, request);
+    return;
+  }
+#endif
+
+  AsyncIOContext* ctx = context;
+  pushJob(ctx, [ctx, request] {
+    request->success = readWholeFile(request->path.c_str(), request->hint, request->bytes);
+    finishRequest(ctx, request);
+  });
+}
+
+void assets::AsyncAssetReader::readAssetFile(const char* path, AssetReadCallback&& callback, ReadAheadHint hint) {
+  readFile(path, [callback = std::move(callback)](AsyncReadResult& result) {
+    AssetFile assetFile{};
+    bool success = result.success && parseAssetFile(result.bytes.data(), result.bytes.size(), &assetFile);
+    if(result.success && !success) {
+      printf("Async read of asset file returned malformed data: %s\n", result.path);
+    }
+    result.bytes = std::vector<char>(); // release the raw file before the callback allocates for decompression
+    callback(success, assetFile);
+  }, hint);
+}
+
+std::future<std::vector<char>> assets::AsyncAssetReader::readFile(const char* path, ReadAheadHint hint) {
+  std::shared_ptr<std::promise<std::vector<char>>> promise = std::make_shared<std::promise<std::vector<char>>>();
+  std::future<std::vector<char>> future = promise->get_future();
+  readFile(path, [promise](AsyncReadResult& result) {
+    promise->set_value(std::move(result.bytes));
+  }, hint);
+  return future;
+}
+
+void assets::AsyncAssetReader::prefetch(const char* path) {
+  prefetchFile(path);
+}
+
+void assets::AsyncAssetReader::waitIdle() {
+  if(context == nullptr) { return; }
+  std::unique_lock<std::mutex> lock(context->outstandingMutex);
+  context->outstandingDone.wait(lock, [this] { return context->outstandingCount == 0; });
+}
+
+assets::AsyncIOBackend assets::AsyncAssetReader::backend() const {
+  return context != nullptr ? context->backend : AsyncIOBackend::ThreadPool;
+}
+
+const char* assets::AsyncAssetReader::backendName() const {
+  return mapAsyncIOBackendToString[(u32)backend()];
+}
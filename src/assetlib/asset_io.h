@@ -0,0 +1,78 @@
+#pragma once
+
+// Asynchronous file reads for assets and other runtime data (ex: shaders)
+// Many reads can be in flight at once. Completion is delivered through callbacks that run on an I/O worker thread,
+// which makes them a good place to decompress, or through futures.
+// Linux uses io_uring when the kernel supports it. Everything else falls back to a pool of threads issuing positional reads.
+
+#include <functional>
+#include <future>
+#include <memory>
+
+#include "asset_loader.h"
+
+namespace assets {
+  enum class ReadAheadHint : u32 {
+    None = 0, // no hint is given to the OS
+    Sequential, // file will be read front to back, OS may read ahead more aggressively
+    WillNeed, // file will be needed soon, OS may start paging it in right away
+  };
+
+  enum class AsyncIOBackend : u32 {
+    ThreadPool = 0,
+    IoUring,
+  };
+
+  struct AsyncReadResult {
+    const char* path;
+    bool success;
+    std::vector<char> bytes; // entire contents of the file, callbacks may move out of it
+  };
+
+  typedef std::function<void(AsyncReadResult& result)> FileReadCallback;
+  typedef std::function<void(bool success, AssetFile& assetFile)> AssetReadCallback;
+
+  struct AsyncIOContext;
+
+  class AsyncAssetReader {
+  public:
+    // workerCount of 0 chooses based on hardware concurrency
+    // queueDepth is the maximum number of reads the io_uring backend keeps in flight with the kernel
+    bool init(u32 workerCount = 0, u32 queueDepth = 64, bool allowIoUring = true);
+    // waits for all outstanding reads before releasing resources
+    void shutdown();
+
+    // Callbacks run on an I/O worker thread and may run concurrently with one another
+    void readFile(const char* path, FileReadCallback&& callback, ReadAheadHint hint = ReadAheadHint::Sequential);
+    void readAssetFile(const char* path, AssetReadCallback&& callback, ReadAheadHint hint = ReadAheadHint::Sequential);
+
+    // Future resolves to an empty buffer if the file could not be read
+    std::future<std::vector<char>> readFile(const char* path, ReadAheadHint hint = ReadAheadHint::Sequential);
+
+    // process runs on an I/O worker thread and its return value fulfills the future
+    template<typename T>
+    std::future<T> readAssetFile(const char* path, std::function<T(bool success, AssetFile& assetFile)>&& process, ReadAheadHint hint = ReadAheadHint::Sequential);
+
+    // Hints to the OS that the file will be read soon without reading it
+    void prefetch(const char* path);
+
+    // blocks until every read submitted so far has had its callback complete
+    void waitIdle();
+
+    AsyncIOBackend backend() const;
+    const char* backendName() const;
+
+  private:
+    AsyncIOContext* context = nullptr;
+  };
+
+  template<typename T>
+  std::future<T> AsyncAssetReader::readAssetFile(const char* path, std::function<T(bool success, AssetFile& assetFile)>&& process, ReadAheadHint hint) {
+    std::shared_ptr<std::promise<T>> promise = std::make_shared<std::promise<T>>();
+    std::future<T> future = promise->get_future();
+    readAssetFile(path, [promise, process = std::move(process)](bool success, AssetFile& assetFile) {
+      promise->set_value(process(success, assetFile));
+    }, hint);
+    return future;
+  }
+}
@@ -1,6 +1,7 @@
 #include "asset_loader.h"
 
 #include <fstream>
+#include <cstring>
 
 const internal_access char* mapCompressionModeToString[] = {
         "None",
@@ -76,6 +77,45 @@ bool assets::loadAssetFile(const char* path, AssetFile* outputFile) {
   return true;
 }
 
+bool assets::parseAssetFile(const char* fileBytes, u64 fileSize, AssetFile* outputFile) {
+  const u64 headerSize = FILE_TYPE_SIZE_IN_BYTES + (3 * sizeof(u32));
+  if(fileSize < headerSize) return false;
+
+  const char* fileIter = fileBytes;
+
+  // file type
+  memcpy(outputFile->type, fileIter, FILE_TYPE_SIZE_IN_BYTES);
+  fileIter += FILE_TYPE_SIZE_IN_BYTES;
+
+  // version
+  memcpy(&outputFile->version, fileIter, sizeof(u32));
+  fileIter += sizeof(u32);
+  if(outputFile->version != ASSET_LIB_VERSION) {
+    printf("Attempting to load asset with version #%d. Asset Loader version is currently #%d.", outputFile->version, ASSET_LIB_VERSION);
+  }
+
+  // json length
+  u32 jsonLength;
+  memcpy(&jsonLength, fileIter, sizeof(u32));
+  fileIter += sizeof(u32);
+
+  // blob length
+  u32 blobLength;
+  memcpy(&blobLength, fileIter, sizeof(u32));
+  fileIter += sizeof(u32);
+
+  if(headerSize + jsonLength + blobLength > fileSize) return false;
+
+  // json
+  outputFile->json.assign(fileIter, jsonLength);
+  fileIter += jsonLength;
+
+  // blob
+  outputFile->binaryBlob.assign(fileIter, fileIter + blobLength);
+
+  return true;
+}
+
 const char* assets::compressionModeToString(CompressionMode compressionMode) {
   return mapCompressionModeToString[compressionModeToEnumVal(compressionMode)];
 }
@@ -32,6 +32,8 @@ namespace assets {
 
   bool saveAssetFile(const char* path, const AssetFile& file);
   bool loadAssetFile(const char* path, AssetFile* outputFile);
+  // parses an asset file that has already been read into memory, see asset_io.h
+  bool parseAssetFile(const char* fileBytes, u64 fileSize, AssetFile* outputFile);
 
   const char* compressionModeToString(CompressionMode compressionMode);
   u32 compressionModeToEnumVal(CompressionMode compressionMode);
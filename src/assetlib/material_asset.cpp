@@ -1,5 +1,7 @@
 #include <material_asset.h>
 
+#include <algorithm>
+
 const internal_access char* mapTransparencyModeToString[] = {
         "Unknown",
 #define TransparencyMode(name) #name,
@@ -7,12 +9,17 @@ const internal_access char* mapTransparencyModeToString[] = {
 #undef TransparencyMode
 };
 
+const internal_access char* mapMaterialTextureSlotToString[] = {
+#define MaterialTextureSlot(name) #name,
+#include "material_texture_slot.incl"
+#undef MaterialTextureSlot
+};
+
 const internal_access char* MATERIAL_FOURCC = "MATX";
 
 const struct {
   const char* baseEffect = "base_effect";
-  const char* textures = "textures";
-  const char* customProperties = "custom_properties";
+  const char* textureNames = "texture_names";
   const char* transparencyMode = "transparency_mode";
   const char* transparencyModeEnumVal = "transparency_mode_enum_val";
 } jsonKeys;
@@ -20,56 +27,116 @@ const struct {
 const char* transparencyModeToString(assets::TransparencyMode transMode);
 u32 transparencyModeToEnumVal(assets::TransparencyMode transMode);
 
+assets::MaterialRecord assets::defaultMaterialRecord() {
+  MaterialRecord record;
+  for(u32& textureIndex : record.textureIndices) {
+    textureIndex = MATERIAL_NO_TEXTURE;
+  }
+  for(f32& channel : record.baseColorFactor) {
+    channel = 1.0f;
+  }
+  for(f32& channel : record.emissiveFactor) {
+    channel = 0.0f;
+  }
+  record.metallicFactor = 1.0f;
+  record.roughnessFactor = 1.0f;
+  record.normalScale = 1.0f;
+  record.occlusionStrength = 1.0f;
+  record.alphaCutoff = 0.5f;
+  record.transparency = TransparencyMode::Opaque;
+  return record;
+}
+
 assets::MaterialInfo assets::readMaterialInfo(AssetFile* file)
 {
 	assets::MaterialInfo info;
+	info.record = defaultMaterialRecord();
 
 	nlohmann::json materialJson = nlohmann::json::parse(file->json);
 	info.baseEffect = materialJson[jsonKeys.baseEffect];
 
-	for (auto& [key, value] : materialJson[jsonKeys.textures].items()) {
-		info.textures[key] = value;
+	auto textureNamesIter = materialJson.find(jsonKeys.textureNames);
+	if(textureNamesIter != materialJson.end()) {
+		for(u32 i = 0; i < (u32)MaterialTextureSlot::Count; i++) {
+			info.textureNames[i] = textureNamesIter->value(mapMaterialTextureSlotToString[i], "");
+		}
 	}
 
-	for (auto& [key, value] : materialJson[jsonKeys.customProperties].items()) {
-		info.customProperties[key] = value;
+	if(!readMaterialRecord(*file, &info.record)) {
+		auto it = materialJson.find(jsonKeys.transparencyModeEnumVal);
+		if (it != materialJson.end()) {
+			u32 transparencyModeEnumVal = *it;
+			info.record.transparency = TransparencyMode(transparencyModeEnumVal);
+		}
 	}
 
-	auto it = materialJson.find(jsonKeys.transparencyModeEnumVal);
-	if (it != materialJson.end()) {
-    u32 transparencyModeEnumVal = *it;
-    info.transparency = TransparencyMode(transparencyModeEnumVal);
-	} else { // default to Opaque
-    info.transparency = TransparencyMode::Opaque;
-  }
-
 	return info;
 }
 
+bool assets::readMaterialRecord(const AssetFile& file, MaterialRecord* record) {
+	if(file.binaryBlob.size() != sizeof(MaterialRecord)) {
+		printf("Material predates material records and needs to be re-baked\n");
+		return false;
+	}
+	memcpy(record, file.binaryBlob.data(), sizeof(MaterialRecord));
+	return true;
+}
+
 assets::AssetFile assets::packMaterial(MaterialInfo* info)
 {
+	nlohmann::json textureNamesJson = nlohmann::json::object();
+	for(u32 i = 0; i < (u32)MaterialTextureSlot::Count; i++) {
+		if(!info->textureNames[i].empty()) {
+			textureNamesJson[mapMaterialTextureSlotToString[i]] = info->textureNames[i];
+		}
+	}
+
 	nlohmann::json materialJson;
   materialJson[jsonKeys.baseEffect] = info->baseEffect;
-  materialJson[jsonKeys.textures] = info->textures;
-  materialJson[jsonKeys.customProperties] = info->customProperties;
-  materialJson[jsonKeys.transparencyMode] = transparencyModeToString(info->transparency);
-  materialJson[jsonKeys.transparencyModeEnumVal] = transparencyModeToEnumVal(info->transparency);
+  materialJson[jsonKeys.textureNames] = textureNamesJson;
+  materialJson[jsonKeys.transparencyMode] = transparencyModeToString(info->record.transparency);
+  materialJson[jsonKeys.transparencyModeEnumVal] = transparencyModeToEnumVal(info->record.transparency);
 
 	//core file header
 	AssetFile file;
   strncpy(file.type, MATERIAL_FOURCC, 4);
 	file.version = ASSET_LIB_VERSION;
 
+	file.binaryBlob.resize(sizeof(MaterialRecord));
+	memcpy(file.binaryBlob.data(), &info->record, sizeof(MaterialRecord));
+
 	std::string stringified = materialJson.dump();
 	file.json = stringified;
 
 	return file;
 }
 
+bool assets::resolveMaterialTextures(MaterialInfo* info, const std::vector<std::string>& sortedTextureNames) {
+  bool allResolved = true;
+  for(u32 i = 0; i < (u32)MaterialTextureSlot::Count; i++) {
+    const std::string& textureName = info->textureNames[i];
+    info->record.textureIndices[i] = MATERIAL_NO_TEXTURE;
+    if(textureName.empty()) { continue; }
+
+    auto it = std::lower_bound(sortedTextureNames.begin(), sortedTextureNames.end(), textureName);
+    if(it == sortedTextureNames.end() || *it != textureName) {
+      printf("Material references texture \"%s\" which has not been baked\n", textureName.c_str());
+      allResolved = false;
+      continue;
+    }
+    info->record.textureIndices[i] = (u32)(it - sortedTextureNames.begin());
+  }
+  return allResolved;
+}
+
+const char* assets::materialTextureSlotToString(MaterialTextureSlot slot) {
+  return mapMaterialTextureSlotToString[(u32)slot];
+}
+
 const char* transparencyModeToString(assets::TransparencyMode transMode) {
   return mapTransparencyModeToString[transparencyModeToEnumVal(transMode)];
 }
 
 inline u32 transparencyModeToEnumVal(assets::TransparencyMode transMode) {
   return static_cast<u32>(transMode);
-}
\ No newline at end of file
+}
@@ -2,6 +2,8 @@
 
 #include <asset_loader.h>
 
+#define MATERIAL_NO_TEXTURE 0xFFFFFFFF
+
 namespace assets {
 	enum class TransparencyMode : u32 {
     Unknown = 0,
@@ -10,13 +12,44 @@ namespace assets {
 #undef TransparencyMode
 	};
 
+	enum class MaterialTextureSlot : u32 {
+#define MaterialTextureSlot(name) name,
+#include "material_texture_slot.incl"
+#undef MaterialTextureSlot
+    Count
+	};
+
+	// Stored as the binary blob so the runtime never parses material JSON
+	// Texture indices refer to the baked texture table, which the baker writes sorted by name (see baked_assets.h)
+	struct MaterialRecord {
+		u32 textureIndices[(u32)MaterialTextureSlot::Count]; // MATERIAL_NO_TEXTURE for unused slots
+		f32 baseColorFactor[4];
+		f32 emissiveFactor[3];
+		f32 metallicFactor;
+		f32 roughnessFactor;
+		f32 normalScale;
+		f32 occlusionStrength;
+		f32 alphaCutoff;
+		TransparencyMode transparency;
+	};
+
 	struct MaterialInfo {
 		std::string baseEffect; // info about shader to use (ex: "defaultPBR")
-		std::unordered_map<std::string /* name */, std::string /* path */> textures;
-		std::unordered_map<std::string, std::string> customProperties;
-		TransparencyMode transparency;
+		// baked texture names, empty for unused slots. Kept so indices can be re-resolved whenever the texture table changes
+		std::string textureNames[(u32)MaterialTextureSlot::Count];
+		MaterialRecord record;
 	};
 
+	MaterialRecord defaultMaterialRecord();
+
 	MaterialInfo readMaterialInfo(AssetFile* file);
+	// Reads only the binary record, returns false for materials baked before records existed
+	bool readMaterialRecord(const AssetFile& file, MaterialRecord* record);
 	AssetFile packMaterial(MaterialInfo* info);
-}
\ No newline at end of file
+
+	// Looks up textureNames in the sorted baked texture names and stores the resulting indices in the record
+	// Returns false if any name could not be found, those slots are left as MATERIAL_NO_TEXTURE
+	bool resolveMaterialTextures(MaterialInfo* info, const std::vector<std::string>& sortedTextureNames);
+
+	const char* materialTextureSlotToString(MaterialTextureSlot slot);
+}
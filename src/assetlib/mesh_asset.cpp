@@ -7,6 +7,12 @@ const internal_access char* mapVertexFormatToString[] = {
 #undef VertexFormat
 };
 
+const internal_access char* mapMeshFilterToString[] = {
+#define MeshFilter(name) #name,
+#include "mesh_filter.incl"
+#undef MeshFilter
+};
+
 const internal_access char* MESH_FOURCC = "MESH";
 
 const struct {
@@ -19,8 +25,207 @@ const struct {
   const char* bounds = "bound";
   const char* compressionMode = "compression_mode";
   const char* compressionModeEnumVal = "compression_mode_enum_val";
+  const char* streamChunkSize = "stream_chunk_size";
+  const char* filterMask = "filter_mask";
+  const char* filters = "filters";
 } jsonKeys;
 
+// Streamed blob layout, one entry per chunk of unpacked data:
+//   s32 compressedSize | compressed bytes
+// Chunks are at most MESH_STREAM_CHUNK_SIZE, see meshChunkSize() for how the unpacked data is divided.
+// Both sides compress and decompress through a pair of alternating buffers, so a chunk only ever references the one before it.
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define MESH_FILTERS_SSE2 1
+#else
+#define MESH_FILTERS_SSE2 0
+#endif
+
+internal_access u64 meshChunkSize(const assets::MeshInfo& info, u64 offset) {
+  const u64 unpackedSize = info.vertexBufferSize + info.indexBufferSize;
+  const u64 chunkSize = info.streamChunkSize;
+  if(!info.chunksFollowRegions) {
+    return MIN(chunkSize, unpackedSize - offset);
+  }
+  if(offset < info.vertexBufferSize) {
+    u64 vertexSize = MAX(assets::vertexFormatSize(info.vertexFormat), 1u);
+    u64 vertexChunkSize = MAX(chunkSize / vertexSize, 1ull) * vertexSize;
+    return MIN(vertexChunkSize, info.vertexBufferSize - offset);
+  }
+  u64 indexSize = MAX(info.indexSize, (u8)1);
+  u64 indexChunkSize = (chunkSize / indexSize) * indexSize;
+  return MIN(indexChunkSize, unpackedSize - offset);
+}
+
+internal_access bool meshFilterEnabled(const assets::MeshInfo& info, assets::MeshFilter filter) {
+  return (info.filterMask & assets::meshFilterBit(filter)) != 0;
+}
+
+// words are vertexWords wide vertices in, one stream per word of the vertex out
+internal_access void deinterleaveWords(const u32* src, u32* dst, u64 vertexCount, u32 vertexWords) {
+  for(u64 vertex = 0; vertex < vertexCount; vertex++) {
+    for(u32 word = 0; word < vertexWords; word++) {
+      dst[word * vertexCount + vertex] = src[vertex * vertexWords + word];
+    }
+  }
+}
+
+internal_access void interleaveWords(const u32* src, u32* dst, u64 vertexCount, u32 vertexWords) {
+  u64 vertex = 0;
+#if MESH_FILTERS_SSE2
+  // 4 vertices per iteration, every 4 streams are transposed into 4 consecutive words of each vertex
+  u32 transposedWords = vertexWords & ~3u;
+  for(; vertex + 4 <= vertexCount; vertex += 4) {
+    u32* out = dst + vertex * vertexWords;
+    for(u32 word = 0; word < transposedWords; word += 4) {
+      __m128i stream0 = _mm_loadu_si128((const __m128i*)(src + (word + 0) * vertexCount + vertex));
+      __m128i stream1 = _mm_loadu_si128((const __m128i*)(src + (word + 1) * vertexCount + vertex));
+      __m128i stream2 = _mm_loadu_si128((const __m128i*)(src + (word + 2) * vertexCount + vertex));
+      __m128i stream3 = _mm_loadu_si128((const __m128i*)(src + (word + 3) * vertexCount + vertex));
+      __m128i lowPairs01 = _mm_unpacklo_epi32(stream0, stream1);
+      __m128i highPairs01 = _mm_unpackhi_epi32(stream0, stream1);
+      __m128i lowPairs23 = _mm_unpacklo_epi32(stream2, stream3);
+      __m128i highPairs23 = _mm_unpackhi_epi32(stream2, stream3);
+      _mm_storeu_si128((__m128i*)(out + 0 * vertexWords + word), _mm_unpacklo_epi64(lowPairs01, lowPairs23));
+      _mm_storeu_si128((__m128i*)(out + 1 * vertexWords + word), _mm_unpackhi_epi64(lowPairs01, lowPairs23));
+      _mm_storeu_si128((__m128i*)(out + 2 * vertexWords + word), _mm_unpacklo_epi64(highPairs01, highPairs23));
+      _mm_storeu_si128((__m128i*)(out + 3 * vertexWords + word), _mm_unpackhi_epi64(highPairs01, highPairs23));
+    }
+    for(u32 word = transposedWords; word < vertexWords; word++) {
+      for(u32 i = 0; i < 4; i++) {
+        out[i * vertexWords + word] = src[word * vertexCount + vertex + i];
+      }
+    }
+  }
+#endif
+  for(; vertex < vertexCount; vertex++) {
+    for(u32 word = 0; word < vertexWords; word++) {
+      dst[vertex * vertexWords + word] = src[word * vertexCount + vertex];
+    }
+  }
+}
+
+internal_access void shuffleBytes(const u8* src, u8* dst, u64 wordCount) {
+  for(u64 word = 0; word < wordCount; word++) {
+    for(u32 byte = 0; byte < 4; byte++) {
+      dst[byte * wordCount + word] = src[word * 4 + byte];
+    }
+  }
+}
+
+internal_access void unshuffleBytes(const u8* src, u8* dst, u64 wordCount) {
+  const u8* planes[4] = {src, src + wordCount, src + 2 * wordCount, src + 3 * wordCount};
+  u64 word = 0;
+#if MESH_FILTERS_SSE2
+  // 16 words per iteration, interleaving bytes of the four planes into pairs and then the pairs into words
+  for(; word + 16 <= wordCount; word += 16) {
+    __m128i plane0 = _mm_loadu_si128((const __m128i*)(planes[0] + word));
+    __m128i plane1 = _mm_loadu_si128((const __m128i*)(planes[1] + word));
+    __m128i plane2 = _mm_loadu_si128((const __m128i*)(planes[2] + word));
+    __m128i plane3 = _mm_loadu_si128((const __m128i*)(planes[3] + word));
+    __m128i lowPairs01 = _mm_unpacklo_epi8(plane0, plane1);
+    __m128i highPairs01 = _mm_unpackhi_epi8(plane0, plane1);
+    __m128i lowPairs23 = _mm_unpacklo_epi8(plane2, plane3);
+    __m128i highPairs23 = _mm_unpackhi_epi8(plane2, plane3);
+    __m128i* out = (__m128i*)(dst + word * 4);
+    _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(lowPairs01, lowPairs23));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lowPairs01, lowPairs23));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(highPairs01, highPairs23));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(highPairs01, highPairs23));
+  }
+#endif
+  for(; word < wordCount; word++) {
+    for(u32 byte = 0; byte < 4; byte++) {
+      dst[word * 4 + byte] = planes[byte][word];
+    }
+  }
+}
+
+// each chunk starts from 0 so chunks can be decoded independently of one another
+internal_access void deltaEncodeIndices(const u32* src, u32* dst, u64 indexCount) {
+  u32 previous = 0;
+  for(u64 i = 0; i < indexCount; i++) {
+    s32 delta = (s32)(src[i] - previous);
+    dst[i] = ((u32)delta << 1) ^ (u32)(delta >> 31);
+    previous = src[i];
+  }
+}
+
+internal_access void deltaDecodeIndices(const u32* src, u32* dst, u64 indexCount) {
+  u32 previous = 0;
+  u64 i = 0;
+#if MESH_FILTERS_SSE2
+  // zig-zag decode then a 4 wide prefix sum carried between iterations
+  const __m128i one = _mm_set1_epi32(1);
+  __m128i carry = _mm_setzero_si128();
+  for(; i + 4 <= indexCount; i += 4) {
+    __m128i zigzag = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i delta = _mm_xor_si128(_mm_srli_epi32(zigzag, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(zigzag, one)));
+    delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 4));
+    delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 8));
+    __m128i indices = _mm_add_epi32(delta, carry);
+    _mm_storeu_si128((__m128i*)(dst + i), indices);
+    carry = _mm_shuffle_epi32(indices, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+  previous = (u32)_mm_cvtsi128_si32(carry);
+#endif
+  for(; i < indexCount; i++) {
+    u32 zigzag = src[i];
+    previous += (zigzag >> 1) ^ (0u - (zigzag & 1));
+    dst[i] = previous;
+  }
+}
+
+// out and scratch must each hold chunkSize bytes, returns whichever buffer holds the filtered chunk
+// Byte shuffling is skipped for chunks that aren't whole words, which only happens with 16 bit indices
+internal_access const char* filterMeshChunk(const assets::MeshInfo& info, bool vertexChunk, const char* chunk, u64 chunkSize, char* out, char* scratch) {
+  const char* filtered = chunk;
+  auto nextOutput = [&]() -> char* { return filtered == out ? scratch : out; };
+
+  if(vertexChunk && meshFilterEnabled(info, assets::MeshFilter::Deinterleave)) {
+    u32 vertexWords = assets::vertexFormatSize(info.vertexFormat) / 4;
+    char* dst = nextOutput();
+    deinterleaveWords((const u32*)filtered, (u32*)dst, chunkSize / (vertexWords * 4), vertexWords);
+    filtered = dst;
+  }
+  if(!vertexChunk && meshFilterEnabled(info, assets::MeshFilter::IndexDelta)) {
+    char* dst = nextOutput();
+    deltaEncodeIndices((const u32*)filtered, (u32*)dst, chunkSize / sizeof(u32));
+    filtered = dst;
+  }
+  if(meshFilterEnabled(info, assets::MeshFilter::ByteShuffle) && chunkSize % 4 == 0) {
+    char* dst = nextOutput();
+    shuffleBytes((const u8*)filtered, (u8*)dst, chunkSize / 4);
+    filtered = dst;
+  }
+  return filtered;
+}
+
+// inverse of filterMeshChunk, filters are undone in the opposite order
+internal_access const char* unfilterMeshChunk(const assets::MeshInfo& info, bool vertexChunk, const char* chunk, u64 chunkSize, char* out, char* scratch) {
+  const char* unfiltered = chunk;
+  auto nextOutput = [&]() -> char* { return unfiltered == out ? scratch : out; };
+
+  if(meshFilterEnabled(info, assets::MeshFilter::ByteShuffle) && chunkSize % 4 == 0) {
+    char* dst = nextOutput();
+    unshuffleBytes((const u8*)unfiltered, (u8*)dst, chunkSize / 4);
+    unfiltered = dst;
+  }
+  if(!vertexChunk && meshFilterEnabled(info, assets::MeshFilter::IndexDelta)) {
+    char* dst = nextOutput();
+    deltaDecodeIndices((const u32*)unfiltered, (u32*)dst, chunkSize / sizeof(u32));
+    unfiltered = dst;
+  }
+  if(vertexChunk && meshFilterEnabled(info, assets::MeshFilter::Deinterleave)) {
+    u32 vertexWords = assets::vertexFormatSize(info.vertexFormat) / 4;
+    char* dst = nextOutput();
+    interleaveWords((const u32*)unfiltered, (u32*)dst, chunkSize / (vertexWords * 4), vertexWords);
+    unfiltered = dst;
+  }
+  return unfiltered;
+}
+
 const char* vertexFormatToString(assets::VertexFormat format);
 u32 vertexFormatToEnumVal(assets::VertexFormat format);
 
@@ -37,6 +242,10 @@ void assets::readMeshInfo(const AssetFile& assetFile, MeshInfo* meshInfo)
 	std::string compressionString = meshJson[jsonKeys.compressionMode];
   u32 compressionModeEnumVal = meshJson[jsonKeys.compressionModeEnumVal];
 	meshInfo->compressionMode = CompressionMode(compressionModeEnumVal);
+	meshInfo->streamChunkSize = meshJson.value(jsonKeys.streamChunkSize, 0u);
+	// the filter mask was introduced together with region aligned chunks
+	meshInfo->chunksFollowRegions = meshJson.contains(jsonKeys.filterMask);
+	meshInfo->filterMask = meshJson.value(jsonKeys.filterMask, 0u);
 
 	std::vector<f32> boundsData;
 	boundsData.reserve(7);
@@ -59,17 +268,78 @@ void assets::readMeshInfo(const AssetFile& assetFile, MeshInfo* meshInfo)
 
 void assets::unpackMesh(const MeshInfo& info, const char* srcBuffer, size_t sourceSize, char* dstVertexBuffer, char* dstIndexBuffer)
 {
-	std::vector<char> decompressedBuffer;
-  const u64 decompressedBufferSize = info.vertexBufferSize + info.indexBufferSize;
-	decompressedBuffer.resize(decompressedBufferSize);
+	unpackMeshStreaming(info, srcBuffer, sourceSize, [&](u64 offset, const char* data, u64 size) {
+		// a window may straddle the end of the vertex buffer
+		if(offset < info.vertexBufferSize) {
+			u64 vertexBytes = MIN(size, info.vertexBufferSize - offset);
+			memcpy(dstVertexBuffer + offset, data, vertexBytes);
+			offset += vertexBytes;
+			data += vertexBytes;
+			size -= vertexBytes;
+		}
+		memcpy(dstIndexBuffer + (offset - info.vertexBufferSize), data, size);
+		return true;
+	});
+}
 
-	LZ4_decompress_safe(srcBuffer, decompressedBuffer.data(), (s32)sourceSize, (s32)decompressedBufferSize);
+bool assets::unpackMeshStreaming(const MeshInfo& info, const char* srcBuffer, size_t sourceSize, const MeshUnpackSink& sink)
+{
+	const u64 unpackedSize = info.vertexBufferSize + info.indexBufferSize;
+
+	if(info.streamChunkSize == 0) {
+		// the single block format can only be decoded in full
+		std::vector<char> decompressedBuffer(unpackedSize);
+		if(LZ4_decompress_safe(srcBuffer, decompressedBuffer.data(), (s32)sourceSize, (s32)unpackedSize) != (s32)unpackedSize) {
+			printf("Mesh failed to decompress\n");
+			return false;
+		}
+		return sink(0, decompressedBuffer.data(), unpackedSize);
+	}
 
-	//copy vertex buffer
-	memcpy(dstVertexBuffer, decompressedBuffer.data(), info.vertexBufferSize);
+	// Each block may reference the block decoded before it, so blocks alternate between two halves of the window
+	// Filters are undone outside of the window as the decoder needs the filtered bytes of the previous block
+	const u32 chunkSize = info.streamChunkSize;
+	std::vector<char> window(2 * (u64)chunkSize);
+	std::vector<char> unfilterBuffers(info.filterMask != 0 ? 2 * (u64)chunkSize : 0);
+	LZ4_streamDecode_t streamDecode;
+	LZ4_setStreamDecode(&streamDecode, nullptr, 0);
+
+	const char* srcIter = srcBuffer;
+	const char* srcEnd = srcBuffer + sourceSize;
+	u64 offset = 0;
+	for(u32 chunkIndex = 0; offset < unpackedSize; chunkIndex++) {
+		s32 compressedSize;
+		if(srcEnd - srcIter < (s64)sizeof(compressedSize)) {
+			printf("Mesh stream ended early\n");
+			return false;
+		}
+		memcpy(&compressedSize, srcIter, sizeof(compressedSize));
+		srcIter += sizeof(compressedSize);
+		if(compressedSize <= 0 || srcEnd - srcIter < compressedSize) {
+			printf("Mesh stream chunk %d is out of bounds\n", chunkIndex);
+			return false;
+		}
+
+		s32 expectedSize = (s32)meshChunkSize(info, offset);
+		char* windowHalf = window.data() + (u64)(chunkIndex % 2) * chunkSize;
+		if(LZ4_decompress_safe_continue(&streamDecode, srcIter, windowHalf, compressedSize, expectedSize) != expectedSize) {
+			printf("Mesh stream chunk %d failed to decompress\n", chunkIndex);
+			return false;
+		}
+		srcIter += compressedSize;
+
+		const char* chunk = windowHalf;
+		if(info.filterMask != 0) {
+			bool vertexChunk = offset < info.vertexBufferSize;
+			chunk = unfilterMeshChunk(info, vertexChunk, windowHalf, expectedSize, unfilterBuffers.data(), unfilterBuffers.data() + chunkSize);
+		}
+		if(!sink(offset, chunk, expectedSize)) {
+			return false;
+		}
+		offset += expectedSize;
+	}
 
-	//copy index buffer
-	memcpy(dstIndexBuffer, decompressedBuffer.data() + info.vertexBufferSize, info.indexBufferSize);
+	return true;
 }
 
 assets::AssetFile assets::packMesh(const MeshInfo& meshInfo, char* vertexData, char* indexData)
@@ -101,25 +371,54 @@ assets::AssetFile assets::packMesh(const MeshInfo& meshInfo, char* vertexData, c
 
   meshJson[jsonKeys.bounds] = boundsData;
 
-	size_t fullSize = meshInfo.vertexBufferSize + meshInfo.indexBufferSize;
-
-	std::vector<char> mergedBuffer;
-	mergedBuffer.resize(fullSize);
-
-	//copy vertex buffer
-	memcpy(mergedBuffer.data(), vertexData, meshInfo.vertexBufferSize);
+	MeshInfo streamInfo = meshInfo;
+	streamInfo.streamChunkSize = MESH_STREAM_CHUNK_SIZE;
+	streamInfo.chunksFollowRegions = true;
+	if(streamInfo.indexSize != sizeof(u32)) {
+		streamInfo.filterMask &= ~meshFilterBit(MeshFilter::IndexDelta);
+	}
+	if(vertexFormatSize(streamInfo.vertexFormat) % 4 != 0) {
+		streamInfo.filterMask &= ~meshFilterBit(MeshFilter::Deinterleave);
+	}
 
-	//copy index buffer
-	memcpy(mergedBuffer.data() + meshInfo.vertexBufferSize, indexData, meshInfo.indexBufferSize);
+	const u64 fullSize = meshInfo.vertexBufferSize + meshInfo.indexBufferSize;
+
+	//compress as a chain of blocks, each may reference the block before it so both stay in place in alternating halves
+	LZ4_stream_t* lz4Stream = LZ4_createStream();
+	std::vector<char> window(2 * (u64)MESH_STREAM_CHUNK_SIZE);
+	std::vector<char> filterScratch(MESH_STREAM_CHUNK_SIZE);
+	std::vector<char> compressedChunk(LZ4_compressBound(MESH_STREAM_CHUNK_SIZE));
+	u64 offset = 0;
+	for(u32 chunkIndex = 0; offset < fullSize; chunkIndex++) {
+		u64 chunkSize = meshChunkSize(streamInfo, offset);
+		bool vertexChunk = offset < meshInfo.vertexBufferSize;
+		const char* chunk = vertexChunk ? vertexData + offset : indexData + (offset - meshInfo.vertexBufferSize);
+
+		char* windowHalf = window.data() + (u64)(chunkIndex % 2) * MESH_STREAM_CHUNK_SIZE;
+		const char* filtered = filterMeshChunk(streamInfo, vertexChunk, chunk, chunkSize, windowHalf, filterScratch.data());
+		if(filtered != windowHalf) {
+			memcpy(windowHalf, filtered, chunkSize);
+		}
+
+		s32 compressedSize = LZ4_compress_fast_continue(lz4Stream, windowHalf, compressedChunk.data(), (s32)chunkSize, (s32)compressedChunk.size(), 1);
+		file.binaryBlob.insert(file.binaryBlob.end(), (char*)&compressedSize, (char*)&compressedSize + sizeof(compressedSize));
+		file.binaryBlob.insert(file.binaryBlob.end(), compressedChunk.data(), compressedChunk.data() + compressedSize);
+		offset += chunkSize;
+	}
+	LZ4_freeStream(lz4Stream);
 
-	//compress buffer and copy it into the file struct
-	size_t worstCaseCompressionSize = LZ4_compressBound(static_cast<int>(fullSize));
-	file.binaryBlob.resize(worstCaseCompressionSize);
-	int actualCompressionSize = LZ4_compress_default(mergedBuffer.data(), file.binaryBlob.data(), static_cast<int>(mergedBuffer.size()), static_cast<int>(worstCaseCompressionSize));
-	file.binaryBlob.resize(actualCompressionSize);
+	std::vector<std::string> filterNames;
+	for(u32 filter = 0; filter < ArrayCount(mapMeshFilterToString); filter++) {
+		if(streamInfo.filterMask & (1u << filter)) {
+			filterNames.push_back(mapMeshFilterToString[filter]);
+		}
+	}
 
   meshJson[jsonKeys.compressionMode] = compressionModeToString(CompressionMode::LZ4);
   meshJson[jsonKeys.compressionModeEnumVal] = compressionModeToEnumVal(CompressionMode::LZ4);
+  meshJson[jsonKeys.streamChunkSize] = MESH_STREAM_CHUNK_SIZE;
+  meshJson[jsonKeys.filterMask] = streamInfo.filterMask;
+  meshJson[jsonKeys.filters] = filterNames;
 
 	file.json = meshJson.dump();
 
@@ -168,6 +467,14 @@ assets::MeshBounds assets::calculateBounds(Vertex_PNCV_f32* vertices, size_t ver
 	return bounds;
 }
 
+u32 assets::vertexFormatSize(VertexFormat format) {
+  switch(format) {
+    case VertexFormat::PNCV_F32: return sizeof(Vertex_PNCV_f32);
+    case VertexFormat::P32N8C8V16: return sizeof(Vertex_P32N8C8V16);
+    default: return 0;
+  }
+}
+
 const char* vertexFormatToString(assets::VertexFormat format) {
   return mapVertexFormatToString[vertexFormatToEnumVal(format)];
 }
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <functional>
+
 #include "asset_loader.h"
 
+// Meshes are compressed as a chain of linked LZ4 blocks so they can be decoded through a fixed size window
+// Must be at least 64KB, how far back an LZ4 block may reference, so the previous chunk alone holds a block's history
+#define MESH_STREAM_CHUNK_SIZE (64 * 1024)
+
 namespace assets {
   struct Vertex_PNCV_f32 {
     f32 position[3];
@@ -24,6 +30,13 @@ namespace assets {
 #undef VertexFormat
   };
 
+  // Reversible transforms applied to each chunk before compression so LZ4 finds longer matches
+  enum class MeshFilter : u32 {
+#define MeshFilter(name) name,
+#include "mesh_filter.incl"
+#undef MeshFilter
+  };
+
   struct MeshBounds {
     f32 origin[3];
     f32 radius;
@@ -37,11 +50,24 @@ namespace assets {
     MeshBounds bounds;
     VertexFormat vertexFormat;
     CompressionMode compressionMode;
+    u32 streamChunkSize; // 0 for meshes baked before streaming, those are a single LZ4 block
+    u32 filterMask; // meshFilterBit() of each enabled MeshFilter
+    bool chunksFollowRegions; // chunks hold whole vertices or whole indices and never straddle the two, false for meshes baked before filters
     std::string originalFile;
   };
 
+  // Receives consecutive windows of the unpacked mesh, which is the vertex buffer followed by the index buffer
+  // offset is the position of data within it. data is only valid during the call. Returning false stops unpacking.
+  typedef std::function<bool(u64 offset, const char* data, u64 size)> MeshUnpackSink;
+
+  inline u32 meshFilterBit(MeshFilter filter) { return 1u << (u32)filter; }
+  u32 vertexFormatSize(VertexFormat format);
+
   void readMeshInfo(const AssetFile& assetFile, MeshInfo* meshInfo);
   void unpackMesh(const MeshInfo& info, const char* srcBuffer, size_t sourceSize, char* dstVertexBuffer, char* dstIndexBuffer);
+  // Memory used beyond the source is bounded by 2 * MESH_STREAM_CHUNK_SIZE (4 * with filters) regardless of the mesh size
+  bool unpackMeshStreaming(const MeshInfo& info, const char* srcBuffer, size_t sourceSize, const MeshUnpackSink& sink);
+  // filterMask is supplied by the caller, filters that don't apply to the mesh are dropped
   AssetFile packMesh(const MeshInfo& meshInfo, char* vertexData, char* indexData);
   MeshBounds calculateBounds(Vertex_PNCV_f32* vertices, size_t vertexCount);
 }
\ No newline at end of file
@@ -3,82 +3,177 @@
 const internal_access char* PREFAB_FOURCC = "PRFB";
 
 const struct {
-  const char* nodeMatrices = "nodeMatrices";
+  const char* nodeCount = "nodeCount";
   const char* nodeNames = "nodeNames";
-  const char* nodeParents = "nodeParents";
-  const char* nodeMeshes = "nodeMeshes";
-  const char* meshPath = "meshPath";
-  const char* materialPath = "materialPath";
-  const char* compressed_size = "compressed_size";
+  const char* meshes = "meshes";
+  const char* meshName = "meshName";
+  const char* materialName = "materialName";
 } jsonKeys;
 
+// blob layout: nodeMatrices[nodeCount] | nodeParents[nodeCount] | nodeMeshes[nodeCount]
+internal_access u64 prefabBlobSize(u32 nodeCount) {
+  return (u64)nodeCount * (sizeof(noop::mat4) + sizeof(s32) + sizeof(s32));
+}
+
 assets::PrefabInfo assets::readPrefabInfo(AssetFile* file)
 {
 	PrefabInfo info;
 	nlohmann::json prefabMetadata = nlohmann::json::parse(file->json);
 
-  std::unordered_map<u64, s32> nodeMatrices = prefabMetadata[jsonKeys.nodeMatrices];
-	for (auto& [key, value] : prefabMetadata[jsonKeys.nodeMatrices].items())
-	{
-		info.nodeMatrices[value[0]] = value[1];
+	if(!prefabMetadata.contains(jsonKeys.nodeCount)) {
+		printf("Prefab predates the flat prefab format and needs to be re-baked\n");
+		return info;
 	}
 
-	for (auto& [key, value]  : prefabMetadata[jsonKeys.nodeNames].items())
-	{
-		info.nodeNames[value[0]] = value[1];
+	u32 nodeCount = prefabMetadata[jsonKeys.nodeCount];
+	if(file->binaryBlob.size() < prefabBlobSize(nodeCount)) {
+		printf("Prefab blob is smaller than expected for %d nodes\n", nodeCount);
+		return info;
 	}
 
-	for (auto& [key, value] : prefabMetadata[jsonKeys.nodeParents].items())
-	{
-		info.nodeParents[value[0]] = value[1];
+	info.nodeNames = prefabMetadata[jsonKeys.nodeNames].get<std::vector<std::string>>();
+	for (auto& meshJson : prefabMetadata[jsonKeys.meshes]) {
+		assets::PrefabInfo::NodeMesh nodeMesh;
+		nodeMesh.meshName = meshJson[jsonKeys.meshName];
+		nodeMesh.materialName = meshJson[jsonKeys.materialName];
+		info.meshes.push_back(nodeMesh);
 	}
 
-	std::unordered_map<uint64_t, nlohmann::json> meshNodes = prefabMetadata[jsonKeys.nodeMeshes];
-	for (auto& [meshIndex, meshJson] : meshNodes) {
-		assets::PrefabInfo::NodeMesh node;
-
-		node.meshPath = meshJson[jsonKeys.meshPath];
-		node.materialPath = meshJson[jsonKeys.materialPath];
-
-		info.nodeMeshes[meshIndex] = node;
+	info.nodeMatrices.resize(nodeCount);
+	info.nodeParents.resize(nodeCount);
+	info.nodeMeshes.resize(nodeCount);
+
+	const char* blobIter = file->binaryBlob.data();
+	memcpy(info.nodeMatrices.data(), blobIter, nodeCount * sizeof(noop::mat4));
+	blobIter += nodeCount * sizeof(noop::mat4);
+	memcpy(info.nodeParents.data(), blobIter, nodeCount * sizeof(s32));
+	blobIter += nodeCount * sizeof(s32);
+	memcpy(info.nodeMeshes.data(), blobIter, nodeCount * sizeof(s32));
+
+	// everything indexed by these comes straight from the blob, a bad index is rejected here rather than read past later
+	u32 meshCount = (u32)info.meshes.size();
+	for(u32 i = 0; i < nodeCount; i++) {
+		s32 parent = info.nodeParents[i];
+		if(parent != PREFAB_ROOT_NODE && (parent < 0 || (u32)parent >= i)) {
+			printf("Prefab node %d has invalid parent %d, parents must precede their children\n", i, parent);
+			return PrefabInfo{};
+		}
+		s32 meshIndex = info.nodeMeshes[i];
+		if(meshIndex != PREFAB_NO_MESH && (meshIndex < 0 || (u32)meshIndex >= meshCount)) {
+			printf("Prefab node %d has invalid mesh index %d, the prefab has %d meshes\n", i, meshIndex, meshCount);
+			return PrefabInfo{};
+		}
 	}
 
-	size_t matrixCount = file->binaryBlob.size() / (sizeof(f32) * 16);
-	info.matrices.resize(matrixCount);
-
-	memcpy(info.matrices.data(),file->binaryBlob.data(), file->binaryBlob.size());
-
 	return info;
 }
 
 assets::AssetFile assets::packPrefab(const PrefabInfo& info)
 {
+	u32 nodeCount = info.nodeCount();
+	Assert(info.nodeMatrices.size() == nodeCount && info.nodeMeshes.size() == nodeCount && info.nodeNames.size() == nodeCount);
+
 	nlohmann::json prefabJson;
-  prefabJson[jsonKeys.nodeMatrices] = info.nodeMatrices;
-  prefabJson[jsonKeys.nodeNames] = info.nodeNames;
-  prefabJson[jsonKeys.nodeParents] = info.nodeParents;
+	prefabJson[jsonKeys.nodeCount] = nodeCount;
+	prefabJson[jsonKeys.nodeNames] = info.nodeNames;
 
-	std::unordered_map<uint64_t, nlohmann::json> meshIndex;
-	for (auto& [key, value] : info.nodeMeshes)
+	nlohmann::json meshesJson = nlohmann::json::array();
+	for (const PrefabInfo::NodeMesh& nodeMesh : info.meshes)
 	{
-		nlohmann::json meshNode;
-    meshNode[jsonKeys.meshPath] = value.meshPath;
-    meshNode[jsonKeys.materialPath] = value.materialPath;
-    meshIndex[key] = meshNode;
+		nlohmann::json meshJson;
+		meshJson[jsonKeys.meshName] = nodeMesh.meshName;
+		meshJson[jsonKeys.materialName] = nodeMesh.materialName;
+		meshesJson.push_back(meshJson);
 	}
-
-  prefabJson[jsonKeys.nodeMeshes] = meshIndex;
+	prefabJson[jsonKeys.meshes] = meshesJson;
 
 	//core file header
 	AssetFile file;
-  strncpy(file.type, PREFAB_FOURCC, 4);
-	file.version = 1;
+	strncpy(file.type, PREFAB_FOURCC, 4);
+	file.version = ASSET_LIB_VERSION;
 
-	file.binaryBlob.resize(info.matrices.size() * sizeof(float) * 16);
-	memcpy(file.binaryBlob.data(), info.matrices.data(), info.matrices.size() * sizeof(float) * 16);
+	file.binaryBlob.resize(prefabBlobSize(nodeCount));
+	char* blobIter = file.binaryBlob.data();
+	memcpy(blobIter, info.nodeMatrices.data(), nodeCount * sizeof(noop::mat4));
+	blobIter += nodeCount * sizeof(noop::mat4);
+	memcpy(blobIter, info.nodeParents.data(), nodeCount * sizeof(s32));
+	blobIter += nodeCount * sizeof(s32);
+	memcpy(blobIter, info.nodeMeshes.data(), nodeCount * sizeof(s32));
 
 	std::string stringified = prefabJson.dump();
 	file.json = stringified;
 
 	return file;
 }
+
+bool assets::sortPrefabNodes(PrefabInfo* info) {
+	u32 nodeCount = info->nodeCount();
+
+	std::vector<std::vector<u32>> children(nodeCount);
+	std::vector<u32> roots;
+	for(u32 i = 0; i < nodeCount; i++) {
+		s32 parent = info->nodeParents[i];
+		if(parent == PREFAB_ROOT_NODE) {
+			roots.push_back(i);
+		} else if(parent < 0 || (u32)parent >= nodeCount) {
+			printf("Prefab node %d has invalid parent %d\n", i, parent);
+			return false;
+		} else {
+			children[parent].push_back(i);
+		}
+	}
+
+	// depth first pre-order keeps each subtree contiguous and preserves sibling order
+	std::vector<u32> sortedToOriginal;
+	sortedToOriginal.reserve(nodeCount);
+	std::vector<u32> stack;
+	for(u32 root : roots) {
+		stack.push_back(root);
+		while(!stack.empty()) {
+			u32 node = stack.back();
+			stack.pop_back();
+			sortedToOriginal.push_back(node);
+			for(auto childIter = children[node].rbegin(); childIter != children[node].rend(); childIter++) {
+				stack.push_back(*childIter);
+			}
+		}
+	}
+
+	// nodes in a cycle are never reached from a root
+	if(sortedToOriginal.size() != nodeCount) {
+		printf("Prefab hierarchy contains a cycle\n");
+		return false;
+	}
+
+	std::vector<s32> originalToSorted(nodeCount);
+	for(u32 i = 0; i < nodeCount; i++) {
+		originalToSorted[sortedToOriginal[i]] = (s32)i;
+	}
+
+	PrefabInfo sorted;
+	sorted.meshes = std::move(info->meshes);
+	sorted.nodeParents.resize(nodeCount);
+	sorted.nodeMatrices.resize(nodeCount);
+	sorted.nodeMeshes.resize(nodeCount);
+	sorted.nodeNames.resize(nodeCount);
+	for(u32 i = 0; i < nodeCount; i++) {
+		u32 original = sortedToOriginal[i];
+		s32 parent = info->nodeParents[original];
+		sorted.nodeParents[i] = parent == PREFAB_ROOT_NODE ? PREFAB_ROOT_NODE : originalToSorted[parent];
+		sorted.nodeMatrices[i] = info->nodeMatrices[original];
+		sorted.nodeMeshes[i] = info->nodeMeshes[original];
+		sorted.nodeNames[i] = std::move(info->nodeNames[original]);
+	}
+
+	*info = std::move(sorted);
+	return true;
+}
+
+void assets::computeWorldMatrices(const s32* nodeParents, const noop::mat4* nodeMatrices, u32 nodeCount, const noop::mat4& rootTransform, noop::mat4* worldMatrices) {
+	for(u32 i = 0; i < nodeCount; i++) {
+		s32 parent = nodeParents[i];
+		Assert(parent < (s32)i);
+		const noop::mat4& parentWorld = parent == PREFAB_ROOT_NODE ? rootTransform : worldMatrices[parent];
+		worldMatrices[i] = parentWorld * nodeMatrices[i];
+	}
+}
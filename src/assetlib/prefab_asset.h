@@ -4,24 +4,36 @@
 
 #include "../noop_math/noop_math.h"
 
+#define PREFAB_ROOT_NODE -1
+#define PREFAB_NO_MESH -1
+
 // Prefabs are just "prefabricated"
+// Nodes are stored as flat arrays sorted so that every parent comes before its children,
+// which allows world matrices to be computed in a single forward pass.
 namespace assets {
 
 	struct PrefabInfo {
-		//points to matrix array in the blob
-		std::unordered_map<u64, s32> nodeMatrices;
-		std::unordered_map<u64, std::string> nodeNames;
-		std::unordered_map<u64, u64> nodeParents;
+		std::vector<s32> nodeParents; // PREFAB_ROOT_NODE or the index of an earlier node
+		std::vector<noop::mat4> nodeMatrices; // relative to parent
+		std::vector<s32> nodeMeshes; // PREFAB_NO_MESH or an index into meshes
+		std::vector<std::string> nodeNames;
 
+		// names match those in the generated baked asset tables
 		struct NodeMesh {
-			std::string materialPath;
-			std::string meshPath;
+			std::string materialName;
+			std::string meshName;
 		};
-		std::unordered_map<u64, NodeMesh> nodeMeshes;
+		std::vector<NodeMesh> meshes;
 
-		std::vector<noop::mat4> matrices;
+		u32 nodeCount() const { return (u32)nodeParents.size(); }
 	};
 
+	// Returns an empty prefab if a node's parent doesn't precede it or its mesh index is out of range
 	PrefabInfo readPrefabInfo(AssetFile* file);
 	AssetFile packPrefab(const PrefabInfo& info);
-}
\ No newline at end of file
+
+	// Reorders nodes so that parents precede children, returns false if the hierarchy contains a cycle
+	bool sortPrefabNodes(PrefabInfo* info);
+	// worldMatrices must have room for nodeCount matrices, nodes must already be sorted
+	void computeWorldMatrices(const s32* nodeParents, const noop::mat4* nodeMatrices, u32 nodeCount, const noop::mat4& rootTransform, noop::mat4* worldMatrices);
+}
@@ -18,12 +18,39 @@ const struct {
   const char* originalFile = "original_file";
   const char* width = "width";
   const char* height = "height";
+  const char* mipCount = "mip_count";
+  const char* tileSize = "tile_size";
   const char* compressedSize = "compressed_size";
 } jsonKeys;
 
 const char* textureFormatToString(assets::TextureFormat format);
 u32 textureFormatToEnumVal(assets::TextureFormat format);
 
+// Tiled blob layout:
+//   u64 tileOffsets[tileCount + 1] (relative to the start of the blob, the last entry is the end of the final tile)
+//   tiles, mip by mip and row major within each mip
+// A tile whose stored size equals its raw size was not worth compressing and is stored as is.
+
+internal_access u32 bytesPerPixel(assets::TextureFormat format) {
+  switch(format) {
+    case assets::TextureFormat::RGBA8:
+    default:
+      return 4;
+  }
+}
+
+internal_access u32 tilesAcross(u32 texels, u32 tileSize) {
+  return (texels + tileSize - 1) / tileSize;
+}
+
+internal_access u32 firstTileOfMip(const assets::TextureInfo& texInfo, u32 mipLevel) {
+  u32 tileIndex = 0;
+  for(u32 mip = 0; mip < mipLevel; mip++) {
+    tileIndex += tilesAcross(assets::textureMipWidth(texInfo, mip), texInfo.tileSize) * tilesAcross(assets::textureMipHeight(texInfo, mip), texInfo.tileSize);
+  }
+  return tileIndex;
+}
+
 void assets::readTextureInfo(const AssetFile& file, TextureInfo* texInfo) {
 
   nlohmann::json textureJson = nlohmann::json::parse(file.json);
@@ -40,64 +67,145 @@ void assets::readTextureInfo(const AssetFile& file, TextureInfo* texInfo) {
   texInfo->originalFile = textureJson[jsonKeys.originalFile];
   texInfo->width = textureJson[jsonKeys.width];
   texInfo->height = textureJson[jsonKeys.height];
+  texInfo->compressedSize = textureJson[jsonKeys.compressedSize];
+  // textures baked before tiling hold a single untiled mip
+  texInfo->mipCount = textureJson.value(jsonKeys.mipCount, 1u);
+  texInfo->tileSize = textureJson.value(jsonKeys.tileSize, 0u);
+}
+
+u32 assets::textureMipWidth(const TextureInfo& texInfo, u32 mipLevel) {
+  return MAX(texInfo.width >> mipLevel, 1u);
+}
 
-  // TODO: mipmaps
-//  for (auto& [key, value] : textureJson["pages"].items())
-//  {
-//    TexturePageInfo page;
-//
-//    page.compressedSize = value["compressed_size"];
-//    page.originalSize = value["original_size"];
-//    page.width = value["width"];
-//    page.height = value["height"];
-//
-//    texInfo->pages.push_back(page);
-//  }
+u32 assets::textureMipHeight(const TextureInfo& texInfo, u32 mipLevel) {
+  return MAX(texInfo.height >> mipLevel, 1u);
+}
+
+u64 assets::textureMipSize(const TextureInfo& texInfo, u32 mipLevel) {
+  return (u64)textureMipWidth(texInfo, mipLevel) * textureMipHeight(texInfo, mipLevel) * bytesPerPixel(texInfo.textureFormat);
+}
+
+u64 assets::textureMipOffset(const TextureInfo& texInfo, u32 mipLevel) {
+  u64 offset = 0;
+  for(u32 mip = 0; mip < mipLevel; mip++) {
+    offset += textureMipSize(texInfo, mip);
+  }
+  return offset;
+}
+
+u32 assets::textureFullMipCount(u32 width, u32 height) {
+  u32 mipCount = 1;
+  u32 largestDimension = MAX(width, height);
+  while(largestDimension > 1) {
+    largestDimension >>= 1;
+    mipCount++;
+  }
+  return mipCount;
 }
 
 void assets::unpackTexture(const TextureInfo& texInfo, const char* sourceBuffer, size_t sourceSize, char* destination) {
-  switch(texInfo.compressionMode) {
-    case CompressionMode::None:
-      memcpy(destination, sourceBuffer, sourceSize);
-      break;
-    case CompressionMode::LZ4:
-      LZ4_decompress_safe(sourceBuffer, destination, (s32)sourceSize, (s32)texInfo.textureSize);
-      // TODO: mipmaps
-//      char* sourceIter = sourceBuffer;
-//      char* destIter = destination;
-//      for (const TexturePageInfo& page : texInfo->pages)
-//      {
-//        LZ4_decompress_safe(sourceIter, destIter, page.compressedSize, page.originalSize);
-//        sourceIter += page.compressedSize;
-//        destIter += page.originalSize;
-//      }
-      break;
+  if(texInfo.tileSize == 0) {
+    switch(texInfo.compressionMode) {
+      case CompressionMode::None:
+        memcpy(destination, sourceBuffer, sourceSize);
+        break;
+      case CompressionMode::LZ4:
+        LZ4_decompress_safe(sourceBuffer, destination, (s32)sourceSize, (s32)texInfo.textureSize);
+        break;
+    }
+    return;
   }
+
+  for(u32 mip = 0; mip < texInfo.mipCount; mip++) {
+    unpackTextureMip(texInfo, mip, sourceBuffer, sourceSize, destination + textureMipOffset(texInfo, mip));
+  }
+}
+
+bool assets::unpackTextureMip(const TextureInfo& texInfo, u32 mipLevel, const char* sourceBuffer, size_t sourceSize, char* destination) {
+  TextureRegion mipRegion = {0, 0, textureMipWidth(texInfo, mipLevel), textureMipHeight(texInfo, mipLevel)};
+  return unpackTextureRegion(texInfo, mipLevel, mipRegion, sourceBuffer, sourceSize, destination);
 }
 
-// TODO: mipmaps
-//void assets::unpackTexturePage(TextureInfo* info, int pageIndex, char* sourceBuffer, char* destination)
-//{
-//  char* source = sourceBuffer;
-//  for (int i = 0; i < pageIndex; i++) {
-//    source += info->pages[i].compressedSize;
-//  }
-//
-//  switch(info->compressionMode) {
-//    case CompressionMode::None:
-//      memcpy(destination, source, info->pages[pageIndex].originalSize);
-//      break;
-//    case CompressionMode::LZ4:
-//      // if size doesn't fully match, its compressed
-//      if(info->pages[pageIndex].compressedSize != info->pages[pageIndex].originalSize) {
-//        LZ4_decompress_safe(source, destination, info->pages[pageIndex].compressedSize, info->pages[pageIndex].originalSize);
-//      } else {
-//        //size matched, uncompressed page
-//        memcpy(destination, source, info->pages[pageIndex].originalSize);
-//      }
-//      break;
-//  }
-//}
+bool assets::unpackTextureRegion(const TextureInfo& texInfo, u32 mipLevel, const TextureRegion& region, const char* sourceBuffer, size_t sourceSize, char* destination) {
+  if(mipLevel >= texInfo.mipCount) {
+    printf("Texture only has %d mips, mip %d was requested\n", texInfo.mipCount, mipLevel);
+    return false;
+  }
+
+  u32 mipWidth = textureMipWidth(texInfo, mipLevel);
+  u32 mipHeight = textureMipHeight(texInfo, mipLevel);
+  if(region.width == 0 || region.height == 0 || region.x + region.width > mipWidth || region.y + region.height > mipHeight) {
+    printf("Texture region lies outside of mip %d\n", mipLevel);
+    return false;
+  }
+
+  u32 pixelSize = bytesPerPixel(texInfo.textureFormat);
+
+  if(texInfo.tileSize == 0) { // untiled textures have to be decoded in full
+    std::vector<char> pixels(texInfo.textureSize);
+    unpackTexture(texInfo, sourceBuffer, sourceSize, pixels.data());
+    for(u32 row = 0; row < region.height; row++) {
+      memcpy(destination + (u64)row * region.width * pixelSize, pixels.data() + ((u64)(region.y + row) * mipWidth + region.x) * pixelSize, (u64)region.width * pixelSize);
+    }
+    return true;
+  }
+
+  const u32 tileSize = texInfo.tileSize;
+  u32 tileCount = firstTileOfMip(texInfo, texInfo.mipCount);
+  if((tileCount + 1) * sizeof(u64) > sourceSize) {
+    printf("Texture blob is too small to hold its tile table\n");
+    return false;
+  }
+  const u64* tileOffsets = (const u64*)sourceBuffer;
+  u32 mipTilesX = tilesAcross(mipWidth, tileSize);
+  u32 mipFirstTile = firstTileOfMip(texInfo, mipLevel);
+
+  std::vector<char> tilePixels((u64)tileSize * tileSize * pixelSize);
+
+  u32 firstTileX = region.x / tileSize;
+  u32 lastTileX = (region.x + region.width - 1) / tileSize;
+  u32 firstTileY = region.y / tileSize;
+  u32 lastTileY = (region.y + region.height - 1) / tileSize;
+  for(u32 tileY = firstTileY; tileY <= lastTileY; tileY++) {
+    for(u32 tileX = firstTileX; tileX <= lastTileX; tileX++) {
+      u32 tileIndex = mipFirstTile + tileY * mipTilesX + tileX;
+      u32 tileOriginX = tileX * tileSize;
+      u32 tileOriginY = tileY * tileSize;
+      u32 tileWidth = MIN(tileSize, mipWidth - tileOriginX);
+      u32 tileHeight = MIN(tileSize, mipHeight - tileOriginY);
+      u64 tileRawSize = (u64)tileWidth * tileHeight * pixelSize;
+
+      u64 tileStart = tileOffsets[tileIndex];
+      u64 tileEnd = tileOffsets[tileIndex + 1];
+      if(tileEnd < tileStart || tileEnd > sourceSize) {
+        printf("Texture tile %d is out of bounds\n", tileIndex);
+        return false;
+      }
+      u64 tileStoredSize = tileEnd - tileStart;
+
+      if(tileStoredSize == tileRawSize) {
+        memcpy(tilePixels.data(), sourceBuffer + tileStart, tileRawSize);
+      } else if(LZ4_decompress_safe(sourceBuffer + tileStart, tilePixels.data(), (s32)tileStoredSize, (s32)tileRawSize) != (s32)tileRawSize) {
+        printf("Texture tile %d failed to decompress\n", tileIndex);
+        return false;
+      }
+
+      // overlap of the tile and the region, in mip texels
+      u32 copyMinX = MAX(region.x, tileOriginX);
+      u32 copyMaxX = MIN(region.x + region.width, tileOriginX + tileWidth);
+      u32 copyMinY = MAX(region.y, tileOriginY);
+      u32 copyMaxY = MIN(region.y + region.height, tileOriginY + tileHeight);
+      u64 copyRowSize = (u64)(copyMaxX - copyMinX) * pixelSize;
+      for(u32 y = copyMinY; y < copyMaxY; y++) {
+        const char* tileRow = tilePixels.data() + ((u64)(y - tileOriginY) * tileWidth + (copyMinX - tileOriginX)) * pixelSize;
+        char* destinationRow = destination + ((u64)(y - region.y) * region.width + (copyMinX - region.x)) * pixelSize;
+        memcpy(destinationRow, tileRow, copyRowSize);
+      }
+    }
+  }
+
+  return true;
+}
 
 assets::AssetFile assets::packTexture(TextureInfo* info, void* pixelData) {
 
@@ -106,34 +214,56 @@ assets::AssetFile assets::packTexture(TextureInfo* info, void* pixelData) {
   strncpy(file.type, TEXTURE_FOURCC, 4);
   file.version = ASSET_LIB_VERSION;
 
-  char* pixels = (char*)pixelData;
-  std::vector<char> decompressionBuffer;
+  if(info->mipCount == 0) { info->mipCount = 1; }
+  info->tileSize = TEXTURE_TILE_SIZE;
+  info->compressionMode = CompressionMode::LZ4;
 
-//  for (TexturePageInfo& pageInfo : info->pages)
-//  {
+  const char* pixels = (const char*)pixelData;
+  const u32 tileSize = info->tileSize;
+  u32 pixelSize = bytesPerPixel(info->textureFormat);
+  u32 tileCount = firstTileOfMip(*info, info->mipCount);
 
-  //compress buffer into blob
-  s32 worstCaseCompressionSize = LZ4_compressBound((s32)info->textureSize);
-  decompressionBuffer.resize(worstCaseCompressionSize);
-  u64 actualCompressionSize = LZ4_compress_default(pixels, decompressionBuffer.data(), (s32)info->textureSize, worstCaseCompressionSize);
+  // offset table is written at the front once every tile size is known
+  u64 tileTableSize = (tileCount + 1) * sizeof(u64);
+  std::vector<u64> tileOffsets(tileCount + 1);
+  file.binaryBlob.resize(tileTableSize);
 
-  f64 compressionRate = f64(actualCompressionSize) / f64(info->textureSize);
+  std::vector<char> tilePixels((u64)tileSize * tileSize * pixelSize);
+  std::vector<char> compressedTile(LZ4_compressBound((s32)tilePixels.size()));
 
-  //if the compression is more than 80% of the original size, it's not worth to use it
-  if (compressionRate > 0.8f)
-  {
-    actualCompressionSize = info->textureSize;
-    decompressionBuffer.resize(actualCompressionSize);
-    memcpy(decompressionBuffer.data(), pixels, actualCompressionSize);
-  } else {
-    decompressionBuffer.resize(actualCompressionSize);
-  }
+  u32 tileIndex = 0;
+  for(u32 mip = 0; mip < info->mipCount; mip++) {
+    const char* mipPixels = pixels + textureMipOffset(*info, mip);
+    u32 mipWidth = textureMipWidth(*info, mip);
+    u32 mipHeight = textureMipHeight(*info, mip);
 
-  file.binaryBlob.insert(file.binaryBlob.end(), decompressionBuffer.begin(), decompressionBuffer.end());
+    for(u32 tileOriginY = 0; tileOriginY < mipHeight; tileOriginY += tileSize) {
+      for(u32 tileOriginX = 0; tileOriginX < mipWidth; tileOriginX += tileSize) {
+        u32 tileWidth = MIN(tileSize, mipWidth - tileOriginX);
+        u32 tileHeight = MIN(tileSize, mipHeight - tileOriginY);
+        u64 tileRowSize = (u64)tileWidth * pixelSize;
+        s32 tileRawSize = (s32)(tileRowSize * tileHeight);
 
-//    //advance pixel pointer to next page
-//    pixels += pageInfo.originalSize;
-//  }
+        for(u32 row = 0; row < tileHeight; row++) {
+          memcpy(tilePixels.data() + row * tileRowSize, mipPixels + ((u64)(tileOriginY + row) * mipWidth + tileOriginX) * pixelSize, tileRowSize);
+        }
+
+        s32 compressedSize = LZ4_compress_default(tilePixels.data(), compressedTile.data(), tileRawSize, (s32)compressedTile.size());
+
+        tileOffsets[tileIndex++] = file.binaryBlob.size();
+        //if the compression is more than 80% of the original size, it's not worth to use it
+        if(compressedSize <= 0 || f64(compressedSize) / f64(tileRawSize) > 0.8) {
+          file.binaryBlob.insert(file.binaryBlob.end(), tilePixels.data(), tilePixels.data() + tileRawSize);
+        } else {
+          file.binaryBlob.insert(file.binaryBlob.end(), compressedTile.data(), compressedTile.data() + compressedSize);
+        }
+      }
+    }
+  }
+  tileOffsets[tileCount] = file.binaryBlob.size();
+  memcpy(file.binaryBlob.data(), tileOffsets.data(), tileTableSize);
+
+  info->compressedSize = file.binaryBlob.size();
 
   nlohmann::json textureJson;
   textureJson[jsonKeys.textureFormat] = textureFormatToString(TextureFormat::RGBA8);
@@ -144,20 +274,9 @@ assets::AssetFile assets::packTexture(TextureInfo* info, void* pixelData) {
   textureJson[jsonKeys.compressionModeEnumVal] = compressionModeToEnumVal(CompressionMode::LZ4);
   textureJson[jsonKeys.width] = info->width;
   textureJson[jsonKeys.height] = info->height;
-  textureJson[jsonKeys.compressedSize] = actualCompressionSize;
-
-  // TODO: mipmaps
-//  std::vector<nlohmann::json> pageJson;
-//  pageJson.reserve(info->pages.size());
-//  for (TexturePageInfo& p : info->pages) {
-//    nlohmann::json page;
-//    page["compressed_size"] = p.compressedSize;
-//    page["original_size"] = p.originalSize;
-//    page["width"] = p.width;
-//    page["height"] = p.height;
-//    pageJson.push_back(page);
-//  }
-//  textureJson["pages"] = pageJson;
+  textureJson[jsonKeys.mipCount] = info->mipCount;
+  textureJson[jsonKeys.tileSize] = info->tileSize;
+  textureJson[jsonKeys.compressedSize] = info->compressedSize;
 
   // json map to string
   std::string texMetadataJsonString = textureJson.dump();
@@ -172,4 +291,4 @@ const char* textureFormatToString(assets::TextureFormat format) {
 
 inline u32 textureFormatToEnumVal(assets::TextureFormat format) {
   return static_cast<u32>(format);
-}
\ No newline at end of file
+}
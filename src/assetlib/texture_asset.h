@@ -2,6 +2,8 @@
 
 #include "asset_loader.h"
 
+#define TEXTURE_TILE_SIZE 128 // width and height in texels of each independently compressed tile
+
 namespace assets {
   enum class TextureFormat : u32
   {
@@ -11,31 +13,42 @@ namespace assets {
 #undef TextureFormat
   };
 
-  // TODO: use pages for mipmapping
-//  struct TexturePageInfo {
-//    u32 width;
-//    u32 height;
-//    u32 compressedSize;
-//    s32 originalSize;
-//  };
-
   struct TextureInfo {
     // Note: supplied by caller
-    u64 textureSize;
+    u64 textureSize; // all mips combined
     TextureFormat textureFormat;
     u32 width;
     u32 height;
+    u32 mipCount; // pixel data holds each mip tightly packed and back to back, largest first
     std::string originalFile;
     // Note: Filled in when packed
+    u32 tileSize; // 0 for textures baked before tiling, those hold a single mip compressed as one block
     CompressionMode compressionMode;
     u64 compressedSize;
-    //std::vector<TexturePageInfo> pages; // TODO: Mipmapping
+  };
+
+  struct TextureRegion {
+    u32 x;
+    u32 y;
+    u32 width;
+    u32 height;
   };
 
   //parses the texture metadata from an asset file
   void readTextureInfo(const AssetFile& file, TextureInfo* texInfo);
 
+  u32 textureMipWidth(const TextureInfo& texInfo, u32 mipLevel);
+  u32 textureMipHeight(const TextureInfo& texInfo, u32 mipLevel);
+  u64 textureMipSize(const TextureInfo& texInfo, u32 mipLevel);
+  u64 textureMipOffset(const TextureInfo& texInfo, u32 mipLevel); // offset of the mip within the unpacked texture
+  u32 textureFullMipCount(u32 width, u32 height); // mips needed to reach 1x1
+
+  // unpacks every mip, destination must hold texInfo.textureSize bytes
   void unpackTexture(const TextureInfo& texInfo, const char* sourceBuffer, size_t sourceSize, char* destination);
-  // void unpackTexturePage(TextureInfo* info, int pageIndex ,char* sourcebuffer, char* destination); // TODO: Mipmaps
+  // destination must hold textureMipSize(texInfo, mipLevel) bytes
+  bool unpackTextureMip(const TextureInfo& texInfo, u32 mipLevel, const char* sourceBuffer, size_t sourceSize, char* destination);
+  // Decodes only the tiles overlapping the region, destination receives the region tightly packed
+  bool unpackTextureRegion(const TextureInfo& texInfo, u32 mipLevel, const TextureRegion& region, const char* sourceBuffer, size_t sourceSize, char* destination);
+
   AssetFile packTexture(TextureInfo* info, void* pixelData);
 }
@@ -29,6 +29,19 @@ struct BakedPrefabs {
 #undef BakedPrefab
 } bakedPrefabAssetData;
 
+// The baker writes each table sorted by name, so these indices are stable and match the indices stored in baked material records
+enum class BakedTextureIndex : u32 {
+#define BakedTexture(name, filePath) name,
+#include "../assets_metadata/baked_textures.incl"
+#undef BakedTexture
+};
+
+enum class BakedMaterialIndex : u32 {
+#define BakedMaterial(name, filePath) name,
+#include "../assets_metadata/baked_materials.incl"
+#undef BakedMaterial
+};
+
 u32 bakedMeshAssetCount() {
   return (sizeof(BakedMeshes) / sizeof(BakedAssetData));
 }
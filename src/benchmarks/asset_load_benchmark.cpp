@@ -0,0 +1,534 @@
+// Times every baked texture and mesh through the phases the engine takes them through at startup:
+// read -> decode -> staging -> upload
+// usage: asset_load_benchmark [--decode-only] [--warm-only] [json output path]
+// Run from the root directory of the project like vk_study, the baked asset tables hold paths relative to it.
+// Without a GPU, point the Vulkan loader at a software ICD (ex: VK_ICD_FILENAMES=<path to lvp_icd json> for lavapipe).
+// --decode-only never creates a device and stops after the decode phase.
+// Unlike the engine, phases run back to back for each asset so they can be timed in isolation.
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <new>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+
+#include <vulkan/vulkan.h>
+
+#include <VkBootstrap.h>
+
+#define VMA_IMPLEMENTATION
+#include <vk_mem_alloc.h>
+
+#include "../types.h"
+#include "../vk_types.h"
+#include "../noop_math/noop_math.h"
+using namespace noop;
+#include "../util.h"
+
+#include <asset_loader.h>
+#include <asset_io.h>
+#include <texture_asset.h>
+#include <mesh_asset.h>
+
+#include "../vk_util.h"
+#include "../vk_initializers.h"
+#include "../upload_manager.h"
+#include "../vk_textures.h"
+#include "../geometry_arena.h"
+#include "../vk_mesh.h"
+
+#include "../baked_assets.h"
+
+#include "../util.cpp"
+#include "../vk_util.cpp"
+#include "../vk_initializers.cpp"
+#include "../upload_manager.cpp"
+#include "../vk_textures.cpp"
+#include "../geometry_arena.cpp"
+#include "../vk_mesh.cpp"
+
+// Counts allocations made through operator new, drivers allocating through malloc directly aren't seen
+std::atomic<u64> heapAllocationCount = 0;
+std::atomic<u64> deviceAllocationCount = 0;
+
+void* operator new(size_t size) {
+  heapAllocationCount++;
+  void* memory = malloc(size > 0 ? size : 1);
+  if(memory == nullptr) { throw std::bad_alloc(); }
+  return memory;
+}
+
+void operator delete(void* memory) noexcept {
+  free(memory);
+}
+
+void operator delete(void* memory, size_t /*size*/) noexcept {
+  free(memory);
+}
+
+enum class LoadPhase : u32 {
+  Read = 0, // file bytes into memory
+  Decode, // parsing and decompressing into the layout the GPU receives
+  Staging, // copying into the upload manager's staging ring and recording the copies out of it
+  Upload, // creating the GPU resource, submitting the copies and waiting on them
+  Count
+};
+
+const internal_access char* mapLoadPhaseToString[] = {
+        "read",
+        "decode",
+        "staging",
+        "upload",
+};
+
+struct PhaseStats {
+  u64 bytes;
+  f64 milliseconds;
+  u64 heapAllocations;
+  u64 deviceAllocations;
+};
+
+struct AssetTypeStats {
+  const char* name;
+  u32 assetCount;
+  u32 failedCount;
+  PhaseStats phases[(u32)LoadPhase::Count];
+};
+
+struct PassStats {
+  const char* name;
+  bool cold;
+  bool pageCacheEvicted; // false if a cold pass could not evict every file
+  AssetTypeStats textures;
+  AssetTypeStats meshes;
+  u64 peakResidentBytes; // of the whole process so far, so never lower than a previous pass
+};
+
+struct GPUContext {
+  VkInstance instance;
+  VkDebugUtilsMessengerEXT debugMessenger;
+  VkPhysicalDevice physicalDevice;
+  VkDevice device;
+  VmaAllocator vmaAllocator;
+  UploadManager uploadManager;
+};
+
+internal_access void VKAPI_PTR countDeviceAllocation(VmaAllocator /*allocator*/, u32 /*memoryType*/, VkDeviceMemory /*memory*/, VkDeviceSize /*size*/, void* /*userData*/) {
+  deviceAllocationCount++;
+}
+
+// fn returns the number of bytes the phase produced
+internal_access bool timePhase(PhaseStats& stats, const std::function<bool(u64* bytes)>& fn) {
+  u64 heapAllocationsBefore = heapAllocationCount;
+  u64 deviceAllocationsBefore = deviceAllocationCount;
+  u64 bytes = 0;
+
+  Timer timer;
+  StartTimer(timer);
+  bool success = fn(&bytes);
+  stats.milliseconds += StopTimer(timer);
+
+  stats.bytes += bytes;
+  stats.heapAllocations += heapAllocationCount - heapAllocationsBefore;
+  stats.deviceAllocations += deviceAllocationCount - deviceAllocationsBefore;
+  return success;
+}
+
+internal_access bool evictFromPageCache(const char* path) {
+#ifdef _WIN32
+  // opening a handle without buffering purges the cached pages of a file that isn't mapped elsewhere, best effort
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, nullptr);
+  if(file == INVALID_HANDLE_VALUE) { return false; }
+  CloseHandle(file);
+  return true;
+#else
+  int file = open(path, O_RDONLY);
+  if(file < 0) { return false; }
+  bool evicted = posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED) == 0;
+  close(file);
+  return evicted;
+#endif
+}
+
+internal_access u64 peakResidentBytes() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS memoryCounters{};
+  GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters));
+  return memoryCounters.PeakWorkingSetSize;
+#else
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return (u64)usage.ru_maxrss * 1024; // reported in kilobytes on Linux
+#endif
+}
+
+internal_access bool initGPU(GPUContext* gpu) {
+  // headless, nothing is ever presented
+  vkb::InstanceBuilder builder;
+  vkb::detail::Result<vkb::Instance> instanceResult = builder
+          .set_app_name("Asset Load Benchmark")
+          .set_headless(true)
+          .require_api_version(1, 2, 0)
+          .build();
+  if(!instanceResult) {
+    std::cout << "Failed to create Vulkan instance: " << instanceResult.error().message() << std::endl;
+    return false;
+  }
+  vkb::Instance vkbInst = instanceResult.value();
+  gpu->instance = vkbInst.instance;
+  gpu->debugMessenger = vkbInst.debug_messenger;
+
+  // software rasterizers report themselves as CPU devices
+  vkb::PhysicalDeviceSelector selector{vkbInst};
+  vkb::detail::Result<vkb::PhysicalDevice> physicalDeviceResult = selector
+          .set_minimum_version(1, 2)
+          .require_present(false)
+          .allow_any_gpu_device_type(true)
+          .select();
+  if(!physicalDeviceResult) {
+    std::cout << "No Vulkan device found: " << physicalDeviceResult.error().message() << std::endl;
+    return false;
+  }
+  vkb::PhysicalDevice physicalDevice = physicalDeviceResult.value();
+
+  // the engine's upload path signals a timeline semaphore, the selector doesn't check 1.2 features itself
+  VkPhysicalDeviceVulkan12Features supported12Features = {};
+  supported12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  VkPhysicalDeviceFeatures2 supportedFeatures = {};
+  supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  supportedFeatures.pNext = &supported12Features;
+  vkGetPhysicalDeviceFeatures2(physicalDevice.physical_device, &supportedFeatures);
+  if(!supported12Features.timelineSemaphore) {
+    std::cout << "The Vulkan device doesn't support timeline semaphores" << std::endl;
+    return false;
+  }
+
+  VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+  vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  vulkan12Features.timelineSemaphore = VK_TRUE;
+
+  vkb::DeviceBuilder deviceBuilder{physicalDevice};
+  vkb::Device vkbDevice = deviceBuilder
+          .add_pNext(&vulkan12Features)
+          .build()
+          .value();
+  gpu->device = vkbDevice.device;
+  gpu->physicalDevice = physicalDevice.physical_device;
+
+  VkPhysicalDeviceProperties gpuProperties;
+  vkGetPhysicalDeviceProperties(gpu->physicalDevice, &gpuProperties);
+  std::cout << "Using " << gpuProperties.deviceName << std::endl;
+
+  VmaDeviceMemoryCallbacks deviceMemoryCallbacks{};
+  deviceMemoryCallbacks.pfnAllocate = countDeviceAllocation;
+
+  VmaAllocatorCreateInfo allocatorInfo = {};
+  allocatorInfo.physicalDevice = gpu->physicalDevice;
+  allocatorInfo.device = gpu->device;
+  allocatorInfo.instance = gpu->instance;
+  allocatorInfo.pDeviceMemoryCallbacks = &deviceMemoryCallbacks;
+  vmaCreateAllocator(&allocatorInfo, &gpu->vmaAllocator);
+
+  // the same queues the engine's uploads go through
+  VkQueue graphicsQueue = vkbDevice.get_queue(vkb::QueueType::graphics).value();
+  u32 graphicsQueueFamily = vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
+  VkQueue transferQueue = graphicsQueue;
+  u32 transferQueueFamily = graphicsQueueFamily;
+  vkb::detail::Result<u32> dedicatedTransferQueueFamily = vkbDevice.get_dedicated_queue_index(vkb::QueueType::transfer);
+  if(dedicatedTransferQueueFamily.has_value()) {
+    transferQueueFamily = dedicatedTransferQueueFamily.value();
+    transferQueue = vkbDevice.get_dedicated_queue(vkb::QueueType::transfer).value();
+  }
+  gpu->uploadManager.init(gpu->device, gpu->vmaAllocator, graphicsQueue, graphicsQueueFamily, transferQueue, transferQueueFamily);
+
+  return true;
+}
+
+internal_access void cleanupGPU(GPUContext* gpu) {
+  gpu->uploadManager.destroy();
+  vmaDestroyAllocator(gpu->vmaAllocator);
+  vkDestroyDevice(gpu->device, nullptr);
+  vkb::destroy_debug_utils_messenger(gpu->instance, gpu->debugMessenger);
+  vkDestroyInstance(gpu->instance, nullptr);
+}
+
+// Identical assets are baked to a single content addressed file and the engine loads each file once
+internal_access std::vector<const char*> uniqueFilePaths(const BakedAssetData* bakedAssets, u32 count) {
+  std::vector<const char*> filePaths;
+  std::unordered_map<std::string, u32> seen;
+  for(u32 i = 0; i < count; i++) {
+    if(seen.emplace(bakedAssets[i].filePath, (u32)filePaths.size()).second) {
+      filePaths.push_back(bakedAssets[i].filePath);
+    }
+  }
+  return filePaths;
+}
+
+internal_access void loadTexture(GPUContext* gpu, const char* filePath, AssetTypeStats& stats) {
+  PhaseStats* phases = stats.phases;
+  stats.assetCount++;
+
+  std::vector<char> fileBytes;
+  assets::AssetFile assetFile;
+  assets::TextureInfo textureInfo{};
+  std::vector<char> pixels;
+  bool success = timePhase(phases[(u32)LoadPhase::Read], [&](u64* bytes) {
+    if(!readFile(filePath, fileBytes)) { return false; }
+    *bytes = fileBytes.size();
+    return true;
+  }) && timePhase(phases[(u32)LoadPhase::Decode], [&](u64* bytes) {
+    if(!assets::parseAssetFile(fileBytes.data(), fileBytes.size(), &assetFile)) { return false; }
+    assets::readTextureInfo(assetFile, &textureInfo);
+    pixels.resize(textureInfo.textureSize);
+    assets::unpackTexture(textureInfo, assetFile.binaryBlob.data(), assetFile.binaryBlob.size(), pixels.data());
+    *bytes = pixels.size();
+    return true;
+  });
+
+  if(!success) {
+    std::cout << "Failed to load texture: " << filePath << std::endl;
+    stats.failedCount++;
+    return;
+  }
+  if(gpu == nullptr) { return; }
+
+  // same steps as vkutil::loadImagesFromAssetFiles, with the flush waited on for every texture so each is timed alone
+  VmaAllocator vmaAllocator = gpu->vmaAllocator;
+  UploadManager& uploadManager = gpu->uploadManager;
+  AllocatedImage image{};
+  timePhase(phases[(u32)LoadPhase::Upload], [&](u64* /*bytes*/) {
+    VkExtent3D imageExtent = {textureInfo.width, textureInfo.height, 1};
+    image.vkFormat = getVkFormat(textureInfo);
+    image.mipLevels = textureInfo.mipCount;
+    VkImageCreateInfo imgCreateInfo = vkinit::imageCreateInfo(image.vkFormat, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageExtent);
+    imgCreateInfo.mipLevels = image.mipLevels;
+    VmaAllocationCreateInfo imgAllocCreateInfo = {};
+    imgAllocCreateInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    vmaCreateImage(vmaAllocator, &imgCreateInfo, &imgAllocCreateInfo, &image.vkImage, &image.vmaAllocation, nullptr);
+    return true;
+  });
+
+  timePhase(phases[(u32)LoadPhase::Staging], [&](u64* bytes) {
+    std::vector<VkBufferImageCopy> mipCopies(image.mipLevels);
+    for(u32 mip = 0; mip < image.mipLevels; mip++) {
+      VkBufferImageCopy& copyRegion = mipCopies[mip];
+      copyRegion = {};
+      copyRegion.bufferOffset = assets::textureMipOffset(textureInfo, mip);
+      copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      copyRegion.imageSubresource.mipLevel = mip;
+      copyRegion.imageSubresource.baseArrayLayer = 0;
+      copyRegion.imageSubresource.layerCount = 1;
+      copyRegion.imageExtent = {assets::textureMipWidth(textureInfo, mip), assets::textureMipHeight(textureInfo, mip), 1};
+    }
+    uploadManager.uploadImage(image.vkImage, image.mipLevels, pixels.data(), pixels.size(), mipCopies.data(), (u32)mipCopies.size(), VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    *bytes = pixels.size();
+    return true;
+  });
+
+  timePhase(phases[(u32)LoadPhase::Upload], [&](u64* bytes) {
+    uploadManager.wait(uploadManager.flush());
+    *bytes = pixels.size();
+    return true;
+  });
+
+  vmaDestroyImage(vmaAllocator, image.vkImage, image.vmaAllocation);
+}
+
+internal_access void loadMesh(GPUContext* gpu, const char* filePath, AssetTypeStats& stats) {
+  PhaseStats* phases = stats.phases;
+  stats.assetCount++;
+
+  std::vector<char> fileBytes;
+  assets::AssetFile assetFile;
+  Mesh mesh{};
+  bool success = timePhase(phases[(u32)LoadPhase::Read], [&](u64* bytes) {
+    if(!readFile(filePath, fileBytes)) { return false; }
+    *bytes = fileBytes.size();
+    return true;
+  }) && timePhase(phases[(u32)LoadPhase::Decode], [&](u64* bytes) {
+    if(!assets::parseAssetFile(fileBytes.data(), fileBytes.size(), &assetFile)) { return false; }
+    if(!mesh.loadFromAssetFile(assetFile)) { return false; }
+    *bytes = mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(u32);
+    return true;
+  });
+
+  if(!success) {
+    std::cout << "Failed to load mesh: " << filePath << std::endl;
+    stats.failedCount++;
+    return;
+  }
+  if(gpu == nullptr) { return; }
+
+  // same steps as the engine's mesh uploads, with the flush waited on for every mesh so each is timed alone
+  // Dedicated buffers stand in for the engine's geometry arena, so the upload phase includes their allocation
+  VmaAllocator vmaAllocator = gpu->vmaAllocator;
+  UploadManager& uploadManager = gpu->uploadManager;
+  u64 vertexBufferSize = mesh.vertices.size() * sizeof(Vertex);
+  u64 indexBufferSize = mesh.indices.size() * sizeof(u32);
+  AllocatedBuffer vertexBuffer{};
+  AllocatedBuffer indexBuffer{};
+  timePhase(phases[(u32)LoadPhase::Upload], [&](u64* /*bytes*/) {
+    vertexBuffer = vkutil::createBuffer(vmaAllocator, vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+    indexBuffer = vkutil::createBuffer(vmaAllocator, indexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+    return true;
+  });
+
+  timePhase(phases[(u32)LoadPhase::Staging], [&](u64* bytes) {
+    uploadManager.uploadBuffer(vertexBuffer.vkBuffer, 0, mesh.vertices.data(), vertexBufferSize, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+    uploadManager.uploadBuffer(indexBuffer.vkBuffer, 0, mesh.indices.data(), indexBufferSize, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+    *bytes = vertexBufferSize + indexBufferSize;
+    return true;
+  });
+
+  timePhase(phases[(u32)LoadPhase::Upload], [&](u64* bytes) {
+    uploadManager.wait(uploadManager.flush());
+    *bytes = vertexBufferSize + indexBufferSize;
+    return true;
+  });
+
+  vmaDestroyBuffer(vmaAllocator, vertexBuffer.vkBuffer, vertexBuffer.vmaAllocation);
+  vmaDestroyBuffer(vmaAllocator, indexBuffer.vkBuffer, indexBuffer.vmaAllocation);
+}
+
+internal_access PassStats runPass(bool cold, GPUContext* gpu, const std::vector<const char*>& texturePaths, const std::vector<const char*>& meshPaths) {
+  PassStats pass{};
+  pass.name = cold ? "cold" : "warm";
+  pass.cold = cold;
+  pass.pageCacheEvicted = cold;
+  pass.textures.name = "texture";
+  pass.meshes.name = "mesh";
+
+  if(cold) {
+    for(const std::vector<const char*>* paths : {&texturePaths, &meshPaths}) {
+      for(const char* path : *paths) {
+        pass.pageCacheEvicted &= evictFromPageCache(path);
+      }
+    }
+  }
+
+  for(const char* path : texturePaths) {
+    loadTexture(gpu, path, pass.textures);
+  }
+  for(const char* path : meshPaths) {
+    loadMesh(gpu, path, pass.meshes);
+  }
+
+  pass.peakResidentBytes = peakResidentBytes();
+  return pass;
+}
+
+internal_access f64 megabytesPerSecond(const PhaseStats& phase) {
+  return phase.milliseconds > 0.0 ? ((f64)phase.bytes / (1024.0 * 1024.0)) / (phase.milliseconds / 1000.0) : 0.0;
+}
+
+internal_access void printPass(const PassStats& pass, bool decodeOnly) {
+  printf("\n%s page cache%s, peak RSS %.1f MB\n", pass.name, pass.cold && !pass.pageCacheEvicted ? " (eviction failed, may be partially warm)" : "",
+         (f64)pass.peakResidentBytes / (1024.0 * 1024.0));
+  printf("%-8s %6s %-8s %10s %10s %10s %12s %12s\n", "type", "count", "phase", "MB", "ms", "MB/s", "heap allocs", "device allocs");
+  u32 phaseCount = decodeOnly ? (u32)LoadPhase::Staging : (u32)LoadPhase::Count;
+  for(const AssetTypeStats* assetType : {&pass.textures, &pass.meshes}) {
+    for(u32 phase = 0; phase < phaseCount; phase++) {
+      const PhaseStats& stats = assetType->phases[phase];
+      printf("%-8s %6d %-8s %10.2f %10.2f %10.1f %12llu %12llu\n", assetType->name, assetType->assetCount - assetType->failedCount, mapLoadPhaseToString[phase],
+             (f64)stats.bytes / (1024.0 * 1024.0), stats.milliseconds, megabytesPerSecond(stats),
+             (unsigned long long)stats.heapAllocations, (unsigned long long)stats.deviceAllocations);
+    }
+  }
+}
+
+internal_access nlohmann::json passToJson(const PassStats& pass, bool decodeOnly) {
+  nlohmann::json passJson;
+  passJson["page_cache"] = pass.name;
+  passJson["page_cache_evicted"] = pass.pageCacheEvicted;
+  passJson["peak_rss_bytes"] = pass.peakResidentBytes;
+  u32 phaseCount = decodeOnly ? (u32)LoadPhase::Staging : (u32)LoadPhase::Count;
+  for(const AssetTypeStats* assetType : {&pass.textures, &pass.meshes}) {
+    nlohmann::json assetTypeJson;
+    assetTypeJson["count"] = assetType->assetCount;
+    assetTypeJson["failed"] = assetType->failedCount;
+    for(u32 phase = 0; phase < phaseCount; phase++) {
+      const PhaseStats& stats = assetType->phases[phase];
+      nlohmann::json phaseJson;
+      phaseJson["bytes"] = stats.bytes;
+      phaseJson["ms"] = stats.milliseconds;
+      phaseJson["mbps"] = megabytesPerSecond(stats);
+      phaseJson["heap_allocations"] = stats.heapAllocations;
+      phaseJson["device_allocations"] = stats.deviceAllocations;
+      assetTypeJson[mapLoadPhaseToString[phase]] = phaseJson;
+    }
+    passJson[assetType->name] = assetTypeJson;
+  }
+  return passJson;
+}
+
+int main(int argc, char* argv[]) {
+  bool decodeOnly = false;
+  bool warmOnly = false;
+  const char* jsonPath = nullptr;
+  for(s32 i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--decode-only") == 0) {
+      decodeOnly = true;
+    } else if(strcmp(argv[i], "--warm-only") == 0) {
+      warmOnly = true;
+    } else {
+      jsonPath = argv[i];
+    }
+  }
+
+  std::vector<const char*> texturePaths = uniqueFilePaths((const BakedAssetData*)&bakedTextureAssetData, bakedTextureAssetCount());
+  std::vector<const char*> meshPaths = uniqueFilePaths((const BakedAssetData*)&bakedMeshAssetData, bakedMeshAssetCount());
+  printf("%zu unique textures, %zu unique meshes%s\n", texturePaths.size(), meshPaths.size(), decodeOnly ? ", decode only" : "");
+
+  GPUContext gpuContext{};
+  GPUContext* gpu = nullptr;
+  if(!decodeOnly) {
+    if(!initGPU(&gpuContext)) {
+      std::cout << "Run with --decode-only to benchmark without a device" << std::endl;
+      return -1;
+    }
+    gpu = &gpuContext;
+  }
+
+  // the cold pass comes first, a warm pass leaves every file in the page cache
+  std::vector<PassStats> passes;
+  if(!warmOnly) {
+    passes.push_back(runPass(true, gpu, texturePaths, meshPaths));
+  }
+  passes.push_back(runPass(false, gpu, texturePaths, meshPaths));
+
+  for(const PassStats& pass : passes) {
+    printPass(pass, decodeOnly);
+  }
+
+  if(jsonPath != nullptr) {
+    nlohmann::json benchmarkJson;
+    benchmarkJson["decode_only"] = decodeOnly;
+    benchmarkJson["passes"] = nlohmann::json::array();
+    for(const PassStats& pass : passes) {
+      benchmarkJson["passes"].push_back(passToJson(pass, decodeOnly));
+    }
+    writeFile(jsonPath, benchmarkJson.dump(2));
+    std::cout << std::endl << "wrote " << jsonPath << std::endl;
+  }
+
+  if(gpu != nullptr) {
+    cleanupGPU(gpu);
+  }
+
+  return 0;
+}
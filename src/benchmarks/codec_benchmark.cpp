@@ -0,0 +1,454 @@
+// Measures every codec, level and pre-filter combination against the asset corpus
+// usage: codec_benchmark <assets directory> [json output path] [iterations]
+// Baked assets are benchmarked on their decoded payload, anything else on its raw file bytes.
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+#include <lz4.h>
+#include <lz4hc.h>
+#include <chrono>
+#include <json.hpp>
+
+#include "../types.h"
+
+#include "../util.h"
+#include "../util.cpp"
+
+#include <asset_loader.h>
+#include <mesh_asset.h>
+#include <texture_asset.h>
+
+#define DEFAULT_ITERATIONS 3
+
+enum class Prefilter : u32 {
+  None = 0,
+  ByteShuffle, // 4 byte words are split into one plane per byte
+  ByteShuffleDelta, // byte shuffle followed by the difference from the previous byte
+  MeshFilters, // the filters packMesh applies to mesh stream chunks
+};
+
+const internal_access char* mapPrefilterToString[] = {
+        "None",
+        "ByteShuffle",
+        "ByteShuffleDelta",
+        "MeshFilters",
+};
+
+enum class Codec : u32 {
+  None = 0, // plain copy, the ceiling for decompression speed
+  LZ4,
+  LZ4HC,
+  MeshStream, // chained 64KB LZ4 blocks exactly as packMesh writes them, meshes only
+};
+
+const internal_access char* mapCodecToString[] = {
+        "None",
+        "LZ4",
+        "LZ4HC",
+        "MeshStream",
+};
+
+struct CodecConfig {
+  Codec codec;
+  s32 level; // acceleration for LZ4, compression level for LZ4HC
+  Prefilter prefilter;
+};
+
+const internal_access CodecConfig codecConfigs[] = {
+        {Codec::None, 0, Prefilter::None},
+        {Codec::LZ4, 1, Prefilter::None},
+        {Codec::LZ4, 1, Prefilter::ByteShuffle},
+        {Codec::LZ4, 1, Prefilter::ByteShuffleDelta},
+        {Codec::LZ4, 8, Prefilter::None},
+        {Codec::LZ4, 32, Prefilter::None},
+        {Codec::LZ4HC, LZ4HC_CLEVEL_MIN, Prefilter::None},
+        {Codec::LZ4HC, LZ4HC_CLEVEL_DEFAULT, Prefilter::None},
+        {Codec::LZ4HC, LZ4HC_CLEVEL_DEFAULT, Prefilter::ByteShuffle},
+        {Codec::LZ4HC, LZ4HC_CLEVEL_DEFAULT, Prefilter::ByteShuffleDelta},
+        {Codec::LZ4HC, LZ4HC_CLEVEL_MAX, Prefilter::None},
+        {Codec::MeshStream, 1, Prefilter::None},
+        {Codec::MeshStream, 1, Prefilter::MeshFilters},
+};
+
+struct CorpusItem {
+  std::string path;
+  std::string category;
+  std::vector<char> payload;
+  assets::MeshInfo meshInfo; // only valid for the mesh category
+};
+
+struct EncodedItem {
+  std::vector<char> bytes;
+  assets::MeshInfo meshInfo; // as written by packMesh, for the mesh stream codec
+};
+
+struct BenchmarkResult {
+  std::string category;
+  CodecConfig config;
+  u32 itemCount;
+  u64 rawBytes;
+  u64 compressedBytes;
+  f64 compressMBps;
+  f64 decompressMBps;
+  f64 decompressMTMBps;
+  bool roundTripped;
+};
+
+internal_access bool configApplies(const CodecConfig& config, const CorpusItem& item) {
+  return config.codec != Codec::MeshStream || item.category == "mesh";
+}
+
+// Trailing bytes that don't make up a whole word are left in place
+internal_access void shuffleBytes(const char* src, char* dst, u64 size) {
+  u64 wordCount = size / 4;
+  for(u64 word = 0; word < wordCount; word++) {
+    for(u32 byte = 0; byte < 4; byte++) {
+      dst[byte * wordCount + word] = src[word * 4 + byte];
+    }
+  }
+  memcpy(dst + wordCount * 4, src + wordCount * 4, size - wordCount * 4);
+}
+
+internal_access void unshuffleBytes(const char* src, char* dst, u64 size) {
+  u64 wordCount = size / 4;
+  for(u64 word = 0; word < wordCount; word++) {
+    for(u32 byte = 0; byte < 4; byte++) {
+      dst[word * 4 + byte] = src[byte * wordCount + word];
+    }
+  }
+  memcpy(dst + wordCount * 4, src + wordCount * 4, size - wordCount * 4);
+}
+
+internal_access void deltaEncodeBytes(char* bytes, u64 size) {
+  u8 previous = 0;
+  for(u64 i = 0; i < size; i++) {
+    u8 current = (u8)bytes[i];
+    bytes[i] = (char)(u8)(current - previous);
+    previous = current;
+  }
+}
+
+internal_access void deltaDecodeBytes(char* bytes, u64 size) {
+  u8 previous = 0;
+  for(u64 i = 0; i < size; i++) {
+    previous = (u8)(previous + (u8)bytes[i]);
+    bytes[i] = (char)previous;
+  }
+}
+
+// scratch must be at least as large as the item's payload
+internal_access bool encodeItem(const CodecConfig& config, const CorpusItem& item, std::vector<char>& scratch, EncodedItem* encoded) {
+  const u64 size = item.payload.size();
+
+  if(config.codec == Codec::MeshStream) {
+    assets::MeshInfo meshInfo = item.meshInfo;
+    meshInfo.filterMask = 0;
+    if(config.prefilter == Prefilter::MeshFilters) {
+      meshInfo.filterMask = assets::meshFilterBit(assets::MeshFilter::Deinterleave) | assets::meshFilterBit(assets::MeshFilter::ByteShuffle) | assets::meshFilterBit(assets::MeshFilter::IndexDelta);
+    }
+    char* vertexData = (char*)item.payload.data();
+    assets::AssetFile meshFile = assets::packMesh(meshInfo, vertexData, vertexData + meshInfo.vertexBufferSize);
+    assets::readMeshInfo(meshFile, &encoded->meshInfo);
+    encoded->bytes = std::move(meshFile.binaryBlob);
+    return true;
+  }
+
+  const char* src = item.payload.data();
+  if(config.prefilter == Prefilter::ByteShuffle || config.prefilter == Prefilter::ByteShuffleDelta) {
+    shuffleBytes(src, scratch.data(), size);
+    if(config.prefilter == Prefilter::ByteShuffleDelta) {
+      deltaEncodeBytes(scratch.data(), size);
+    }
+    src = scratch.data();
+  }
+
+  switch(config.codec) {
+    case Codec::None:
+      encoded->bytes.assign(src, src + size);
+      return true;
+    case Codec::LZ4: {
+      encoded->bytes.resize(LZ4_compressBound((s32)size));
+      s32 compressedSize = LZ4_compress_fast(src, encoded->bytes.data(), (s32)size, (s32)encoded->bytes.size(), config.level);
+      encoded->bytes.resize(compressedSize);
+      return compressedSize > 0 || size == 0;
+    }
+    case Codec::LZ4HC: {
+      encoded->bytes.resize(LZ4_compressBound((s32)size));
+      s32 compressedSize = LZ4_compress_HC(src, encoded->bytes.data(), (s32)size, (s32)encoded->bytes.size(), config.level);
+      encoded->bytes.resize(compressedSize);
+      return compressedSize > 0 || size == 0;
+    }
+    default:
+      return false;
+  }
+}
+
+// destination and scratch must be at least as large as the item's payload
+internal_access bool decodeItem(const CodecConfig& config, const CorpusItem& item, const EncodedItem& encoded, char* destination, char* scratch) {
+  const u64 size = item.payload.size();
+
+  if(config.codec == Codec::MeshStream) {
+    return assets::unpackMeshStreaming(encoded.meshInfo, encoded.bytes.data(), encoded.bytes.size(), [&](u64 offset, const char* data, u64 dataSize) {
+      memcpy(destination + offset, data, dataSize);
+      return true;
+    });
+  }
+
+  bool unfilter = config.prefilter == Prefilter::ByteShuffle || config.prefilter == Prefilter::ByteShuffleDelta;
+  char* decoded = unfilter ? scratch : destination;
+  switch(config.codec) {
+    case Codec::None:
+      memcpy(decoded, encoded.bytes.data(), size);
+      break;
+    case Codec::LZ4:
+    case Codec::LZ4HC:
+      if(LZ4_decompress_safe(encoded.bytes.data(), decoded, (s32)encoded.bytes.size(), (s32)size) != (s32)size) {
+        return false;
+      }
+      break;
+    default:
+      return false;
+  }
+
+  if(unfilter) {
+    if(config.prefilter == Prefilter::ByteShuffleDelta) {
+      deltaDecodeBytes(decoded, size);
+    }
+    unshuffleBytes(decoded, destination, size);
+  }
+  return true;
+}
+
+internal_access bool loadCorpusItem(const fs::path& path, CorpusItem* item) {
+  std::vector<char> fileBytes;
+  if(!readFile(path.string().c_str(), fileBytes) || fileBytes.empty()) {
+    return false;
+  }
+  item->path = path.string();
+
+  // anything that isn't a current baked asset is measured as is
+  const char* bakedTypes[] = {"MESH", "TEXI", "MATX", "PRFB"};
+  bool baked = false;
+  if(fileBytes.size() >= FILE_TYPE_SIZE_IN_BYTES + sizeof(u32)) {
+    u32 version;
+    memcpy(&version, fileBytes.data() + FILE_TYPE_SIZE_IN_BYTES, sizeof(u32));
+    for(const char* bakedType : bakedTypes) {
+      baked |= memcmp(fileBytes.data(), bakedType, FILE_TYPE_SIZE_IN_BYTES) == 0 && version == ASSET_LIB_VERSION;
+    }
+  }
+
+  assets::AssetFile assetFile;
+  if(!baked || !assets::parseAssetFile(fileBytes.data(), fileBytes.size(), &assetFile)) {
+    item->category = "source";
+    item->payload = std::move(fileBytes);
+    return true;
+  }
+
+  if(memcmp(assetFile.type, "MESH", FILE_TYPE_SIZE_IN_BYTES) == 0) {
+    item->category = "mesh";
+    assets::readMeshInfo(assetFile, &item->meshInfo);
+    item->payload.resize(item->meshInfo.vertexBufferSize + item->meshInfo.indexBufferSize);
+    assets::unpackMesh(item->meshInfo, assetFile.binaryBlob.data(), assetFile.binaryBlob.size(), item->payload.data(), item->payload.data() + item->meshInfo.vertexBufferSize);
+  } else if(memcmp(assetFile.type, "TEXI", FILE_TYPE_SIZE_IN_BYTES) == 0) {
+    item->category = "texture";
+    assets::TextureInfo textureInfo;
+    assets::readTextureInfo(assetFile, &textureInfo);
+    item->payload.resize(textureInfo.textureSize);
+    assets::unpackTexture(textureInfo, assetFile.binaryBlob.data(), assetFile.binaryBlob.size(), item->payload.data());
+  } else {
+    // materials and prefabs are stored uncompressed
+    item->category = memcmp(assetFile.type, "MATX", FILE_TYPE_SIZE_IN_BYTES) == 0 ? "material" : "prefab";
+    item->payload = std::move(assetFile.binaryBlob);
+  }
+  return !item->payload.empty();
+}
+
+internal_access f64 megabytesPerSecond(u64 bytes, f64 milliseconds) {
+  return milliseconds > 0.0 ? ((f64)bytes / (1024.0 * 1024.0)) / (milliseconds / 1000.0) : 0.0;
+}
+
+internal_access BenchmarkResult runBenchmark(const std::string& category, const CodecConfig& config, const std::vector<const CorpusItem*>& items, u32 iterations, u32 threadCount) {
+  BenchmarkResult result{};
+  result.category = category;
+  result.config = config;
+  result.itemCount = (u32)items.size();
+  result.roundTripped = true;
+
+  u64 largestPayload = 0;
+  for(const CorpusItem* item : items) {
+    result.rawBytes += item->payload.size();
+    largestPayload = MAX(largestPayload, (u64)item->payload.size());
+  }
+
+  // best of each timing is reported, it is the least disturbed by the rest of the system
+  Timer timer;
+  std::vector<EncodedItem> encodedItems(items.size());
+  std::vector<char> scratch(largestPayload);
+  f64 bestCompressMs = std::numeric_limits<f64>::max();
+  for(u32 iteration = 0; iteration < iterations; iteration++) {
+    StartTimer(timer);
+    for(u64 i = 0; i < items.size(); i++) {
+      result.roundTripped &= encodeItem(config, *items[i], scratch, &encodedItems[i]);
+    }
+    f64 elapsedMs = StopTimer(timer);
+    bestCompressMs = MIN(bestCompressMs, elapsedMs);
+  }
+  for(const EncodedItem& encoded : encodedItems) {
+    result.compressedBytes += encoded.bytes.size();
+  }
+
+  std::vector<char> destination(largestPayload);
+  f64 bestDecompressMs = std::numeric_limits<f64>::max();
+  for(u32 iteration = 0; iteration < iterations; iteration++) {
+    StartTimer(timer);
+    for(u64 i = 0; i < items.size(); i++) {
+      decodeItem(config, *items[i], encodedItems[i], destination.data(), scratch.data());
+    }
+    f64 elapsedMs = StopTimer(timer);
+    bestDecompressMs = MIN(bestDecompressMs, elapsedMs);
+  }
+
+  // verified outside of the timed loops
+  for(u64 i = 0; i < items.size(); i++) {
+    bool decoded = decodeItem(config, *items[i], encodedItems[i], destination.data(), scratch.data());
+    if(!decoded || memcmp(destination.data(), items[i]->payload.data(), items[i]->payload.size()) != 0) {
+      printf("%s did not round trip with %s level %d prefilter %s\n", items[i]->path.c_str(),
+             mapCodecToString[(u32)config.codec], config.level, mapPrefilterToString[(u32)config.prefilter]);
+      result.roundTripped = false;
+    }
+  }
+
+  // workers pull items off a shared counter, so large and small items balance out
+  std::vector<std::vector<char>> threadDestinations(threadCount, std::vector<char>(largestPayload));
+  std::vector<std::vector<char>> threadScratch(threadCount, std::vector<char>(largestPayload));
+  f64 bestDecompressMTMs = std::numeric_limits<f64>::max();
+  for(u32 iteration = 0; iteration < iterations; iteration++) {
+    std::atomic<u64> nextItem = 0;
+    std::vector<std::thread> workers;
+    StartTimer(timer);
+    for(u32 thread = 0; thread < threadCount; thread++) {
+      workers.emplace_back([&, thread]() {
+        for(u64 i = nextItem++; i < items.size(); i = nextItem++) {
+          decodeItem(config, *items[i], encodedItems[i], threadDestinations[thread].data(), threadScratch[thread].data());
+        }
+      });
+    }
+    for(std::thread& worker : workers) {
+      worker.join();
+    }
+    f64 elapsedMs = StopTimer(timer);
+    bestDecompressMTMs = MIN(bestDecompressMTMs, elapsedMs);
+  }
+
+  result.compressMBps = megabytesPerSecond(result.rawBytes, bestCompressMs);
+  result.decompressMBps = megabytesPerSecond(result.rawBytes, bestDecompressMs);
+  result.decompressMTMBps = megabytesPerSecond(result.rawBytes, bestDecompressMTMs);
+  return result;
+}
+
+int main(int argc, char* argv[]) {
+
+  if(argc < 2) {
+    std::cout << "usage: codec_benchmark <assets directory> [json output path] [iterations]" << std::endl;
+    return -1;
+  }
+
+  fs::path corpusDir = argv[1];
+  const char* jsonPath = argc > 2 ? argv[2] : nullptr;
+  u32 iterations = argc > 3 ? (u32)MAX(atoi(argv[3]), 1) : DEFAULT_ITERATIONS;
+  u32 threadCount = MAX(std::thread::hardware_concurrency(), 1u);
+
+  if(!fs::is_directory(corpusDir)) {
+    std::cout << "Invalid assets directory: " << argv[1] << std::endl;
+    return -1;
+  }
+
+  std::vector<CorpusItem> corpus;
+  for(const fs::directory_entry& entry : fs::recursive_directory_iterator(corpusDir)) {
+    if(!entry.is_regular_file()) {
+      continue;
+    }
+    CorpusItem item;
+    if(loadCorpusItem(entry.path(), &item)) {
+      corpus.push_back(std::move(item));
+    }
+  }
+
+  if(corpus.empty()) {
+    std::cout << "No assets found in " << corpusDir << std::endl;
+    return -1;
+  }
+
+  // every category on its own, then the whole corpus
+  std::vector<std::string> categories;
+  for(const CorpusItem& item : corpus) {
+    if(std::find(categories.begin(), categories.end(), item.category) == categories.end()) {
+      categories.push_back(item.category);
+    }
+  }
+  std::sort(categories.begin(), categories.end());
+  categories.push_back("all");
+
+  printf("%zu assets, %d iterations, %d decompression threads\n\n", corpus.size(), iterations, threadCount);
+  printf("%-10s %-10s %5s %-16s %6s %10s %8s %12s %12s %12s\n", "category", "codec", "level", "prefilter", "items",
+         "raw MB", "ratio", "comp MB/s", "decomp MB/s", "decomp MT MB/s");
+
+  std::vector<BenchmarkResult> results;
+  for(const std::string& category : categories) {
+    for(const CodecConfig& config : codecConfigs) {
+      std::vector<const CorpusItem*> items;
+      for(const CorpusItem& item : corpus) {
+        if((category == "all" || item.category == category) && configApplies(config, item)) {
+          items.push_back(&item);
+        }
+      }
+      // mesh streams only apply to meshes and are already reported there
+      if(items.empty() || (config.codec == Codec::MeshStream && category == "all")) {
+        continue;
+      }
+
+      BenchmarkResult result = runBenchmark(category, config, items, iterations, threadCount);
+      printf("%-10s %-10s %5d %-16s %6d %10.2f %8.3f %12.1f %12.1f %12.1f%s\n", result.category.c_str(),
+             mapCodecToString[(u32)config.codec], config.level, mapPrefilterToString[(u32)config.prefilter], result.itemCount,
+             (f64)result.rawBytes / (1024.0 * 1024.0), (f64)result.rawBytes / (f64)MAX(result.compressedBytes, 1ull),
+             result.compressMBps, result.decompressMBps, result.decompressMTMBps, result.roundTripped ? "" : " FAILED");
+      results.push_back(result);
+    }
+  }
+
+  if(jsonPath != nullptr) {
+    nlohmann::json resultsJson = nlohmann::json::array();
+    for(const BenchmarkResult& result : results) {
+      nlohmann::json resultJson;
+      resultJson["category"] = result.category;
+      resultJson["codec"] = mapCodecToString[(u32)result.config.codec];
+      resultJson["level"] = result.config.level;
+      resultJson["prefilter"] = mapPrefilterToString[(u32)result.config.prefilter];
+      resultJson["item_count"] = result.itemCount;
+      resultJson["raw_bytes"] = result.rawBytes;
+      resultJson["compressed_bytes"] = result.compressedBytes;
+      resultJson["ratio"] = (f64)result.rawBytes / (f64)MAX(result.compressedBytes, 1ull);
+      resultJson["compress_mbps"] = result.compressMBps;
+      resultJson["decompress_mbps"] = result.decompressMBps;
+      resultJson["decompress_mt_mbps"] = result.decompressMTMBps;
+      resultJson["round_tripped"] = result.roundTripped;
+      resultsJson.push_back(resultJson);
+    }
+
+    nlohmann::json benchmarkJson;
+    benchmarkJson["corpus"] = corpusDir.string();
+    benchmarkJson["iterations"] = iterations;
+    benchmarkJson["thread_count"] = threadCount;
+    benchmarkJson["results"] = resultsJson;
+    writeFile(jsonPath, benchmarkJson.dump(2));
+    std::cout << std::endl << "wrote " << jsonPath << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,69 @@
+void BindlessTextures::init(VkDevice device, DescriptorSetLayoutCache& layoutCache) {
+  this->device = device;
+
+  DescriptorSetLayoutData setData = {2, {
+          vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+          vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
+  }};
+  setData.bindings[0].descriptorCount = MAX_BINDLESS_TEXTURES;
+  setData.bindings[1].descriptorCount = MAX_BINDLESS_SAMPLERS;
+
+  // entries past the ones written so far are never read, and new ones are written while the set is bound
+  VkDescriptorBindingFlags bindingFlags[] = {
+          VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+          VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+  };
+  setLayout = layoutCache.getLayout(setData, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT, bindingFlags);
+
+  VkDescriptorPoolSize poolSizes[] = {
+          {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, MAX_BINDLESS_TEXTURES},
+          {VK_DESCRIPTOR_TYPE_SAMPLER,       MAX_BINDLESS_SAMPLERS},
+  };
+  VkDescriptorPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.pNext = nullptr;
+  poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+  poolInfo.maxSets = 1;
+  poolInfo.poolSizeCount = ArrayCount(poolSizes);
+  poolInfo.pPoolSizes = poolSizes;
+  VK_CHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool));
+
+  VkDescriptorSetAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.pNext = nullptr;
+  allocInfo.descriptorPool = descriptorPool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &setLayout;
+  VK_CHECK(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet));
+}
+
+void BindlessTextures::destroy() {
+  // the set is freed along with its pool
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+}
+
+u32 BindlessTextures::addTexture(VkImageView imageView) {
+  Assert(textureCount < MAX_BINDLESS_TEXTURES)
+  VkDescriptorImageInfo imageInfo = {};
+  imageInfo.sampler = VK_NULL_HANDLE;
+  imageInfo.imageView = imageView;
+  imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  VkWriteDescriptorSet write = vkinit::writeDescriptorImage(VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, descriptorSet, &imageInfo, 0);
+  write.dstArrayElement = textureCount;
+  vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+  return textureCount++;
+}
+
+u32 BindlessTextures::addSampler(VkSampler sampler) {
+  Assert(samplerCount < MAX_BINDLESS_SAMPLERS)
+  VkDescriptorImageInfo samplerInfo = {};
+  samplerInfo.sampler = sampler;
+  samplerInfo.imageView = VK_NULL_HANDLE;
+  samplerInfo.imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  VkWriteDescriptorSet write = vkinit::writeDescriptorImage(VK_DESCRIPTOR_TYPE_SAMPLER, descriptorSet, &samplerInfo, 1);
+  write.dstArrayElement = samplerCount;
+  vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+  return samplerCount++;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#define MAX_BINDLESS_TEXTURES 4096
+#define MAX_BINDLESS_SAMPLERS 32
+
+// Every texture and sampler sits in one of two arrays of a single descriptor set, bound once per command buffer.
+// Objects pick theirs by index in GPUObjectData, so textures no longer split draws into separate batches.
+// The set is update after bind and partially bound, entries are only ever appended, so writing a new one never
+// touches an entry that a frame in flight may read.
+class BindlessTextures {
+public:
+  void init(VkDevice device, DescriptorSetLayoutCache& layoutCache);
+  void destroy();
+
+  u32 addTexture(VkImageView imageView); // index into the texture array, the view must be in SHADER_READ_ONLY_OPTIMAL
+  u32 addSampler(VkSampler sampler); // index into the sampler array
+
+  VkDescriptorSetLayout setLayout; // owned by the layout cache
+  VkDescriptorSet descriptorSet;
+
+private:
+  VkDevice device;
+  VkDescriptorPool descriptorPool;
+  u32 textureCount = 0;
+  u32 samplerCount = 0;
+};
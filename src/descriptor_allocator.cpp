@@ -0,0 +1,93 @@
+// descriptors of each type per set in a pool, a pool with room for N sets has room for N * ratio of each type
+internal_access const struct {
+  VkDescriptorType type;
+  f32 ratio;
+} descriptorPoolRatios[] = {
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         1.0f},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         2.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 0.5f},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f},
+        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,          1.0f},
+        {VK_DESCRIPTOR_TYPE_SAMPLER,                0.5f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          0.5f},
+};
+
+internal_access VkDescriptorPool createDescriptorPool(VkDevice device, u32 setCount) {
+  VkDescriptorPoolSize poolSizes[ArrayCount(descriptorPoolRatios)];
+  for(u32 i = 0; i < ArrayCount(descriptorPoolRatios); i++) {
+    poolSizes[i].type = descriptorPoolRatios[i].type;
+    poolSizes[i].descriptorCount = (u32)(descriptorPoolRatios[i].ratio * setCount) + 1;
+  }
+
+  VkDescriptorPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.pNext = nullptr;
+  poolInfo.flags = 0; // sets are only ever returned by resetting the whole pool
+  poolInfo.maxSets = setCount;
+  poolInfo.poolSizeCount = ArrayCount(poolSizes);
+  poolInfo.pPoolSizes = poolSizes;
+
+  VkDescriptorPool pool;
+  VK_CHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool));
+  return pool;
+}
+
+void DescriptorAllocator::init(VkDevice device, u32 initialSetsPerPool) {
+  this->device = device;
+  nextPoolSetCount = initialSetsPerPool;
+}
+
+void DescriptorAllocator::destroy() {
+  if(currentPool != VK_NULL_HANDLE) { fullPools.push_back(currentPool); }
+  for(VkDescriptorPool pool: fullPools) { vkDestroyDescriptorPool(device, pool, nullptr); }
+  for(VkDescriptorPool pool: readyPools) { vkDestroyDescriptorPool(device, pool, nullptr); }
+  currentPool = VK_NULL_HANDLE;
+  fullPools.clear();
+  readyPools.clear();
+}
+
+VkDescriptorPool DescriptorAllocator::nextPool() {
+  if(!readyPools.empty()) {
+    VkDescriptorPool pool = readyPools.back();
+    readyPools.pop_back();
+    return pool;
+  }
+
+  VkDescriptorPool pool = createDescriptorPool(device, nextPoolSetCount);
+  nextPoolSetCount = MIN(nextPoolSetCount * 2, DESCRIPTOR_POOL_MAX_SETS);
+  return pool;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+  if(currentPool == VK_NULL_HANDLE) { currentPool = nextPool(); }
+
+  VkDescriptorSetAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.pNext = nullptr;
+  allocInfo.descriptorPool = currentPool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &layout;
+
+  VkDescriptorSet set;
+  VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+  if(result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+    // the set fits an empty pool unless its layout alone needs more descriptors of a type than a pool holds
+    fullPools.push_back(currentPool);
+    currentPool = nextPool();
+    allocInfo.descriptorPool = currentPool;
+    result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+  }
+  VK_CHECK(result);
+  return set;
+}
+
+void DescriptorAllocator::reset() {
+  if(currentPool != VK_NULL_HANDLE) { fullPools.push_back(currentPool); }
+  for(VkDescriptorPool pool: fullPools) {
+    VK_CHECK(vkResetDescriptorPool(device, pool, 0));
+    readyPools.push_back(pool);
+  }
+  currentPool = VK_NULL_HANDLE;
+  fullPools.clear();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#define DESCRIPTOR_POOL_INITIAL_SETS 16
+#define DESCRIPTOR_POOL_MAX_SETS 1024 // pools stop doubling here, more sets just means more pools
+
+// Hands out descriptor sets from a growing list of pools, so nothing has to know up front how many sets a scene needs.
+// When the current pool runs out another one, twice as large, is added and the allocation retried. Sets are never
+// freed one at a time: reset() takes every set back at once and keeps the pools around for the next round.
+class DescriptorAllocator {
+public:
+  void init(VkDevice device, u32 initialSetsPerPool = DESCRIPTOR_POOL_INITIAL_SETS);
+  void destroy();
+
+  VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+  // Every set allocated so far becomes invalid, the caller makes sure the GPU is done with them
+  void reset();
+
+  u32 poolCount() const { return (u32)(fullPools.size() + readyPools.size()) + (currentPool != VK_NULL_HANDLE ? 1 : 0); }
+
+private:
+  VkDescriptorPool nextPool(); // a reset pool if there is one, a new larger one otherwise
+
+  VkDevice device;
+  u32 nextPoolSetCount;
+  VkDescriptorPool currentPool = VK_NULL_HANDLE;
+  std::vector<VkDescriptorPool> fullPools; // ran out since the last reset
+  std::vector<VkDescriptorPool> readyPools; // reset and empty
+};
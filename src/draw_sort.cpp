@@ -0,0 +1,85 @@
+#define RADIX_SORT_MIN_ITEMS_PER_WORKER 2048 // below this waking another worker costs more than it sorts
+
+u64 drawSortStateKey(DrawPass pass, u32 materialId, u32 meshId) {
+  Assert((u32)pass < (1u << SORT_KEY_PASS_BITS))
+  Assert(materialId < (1u << SORT_KEY_MATERIAL_BITS))
+  Assert(meshId < (1u << SORT_KEY_MESH_BITS))
+
+  u64 key = (u64)pass;
+  key = (key << SORT_KEY_MATERIAL_BITS) | materialId;
+  key = (key << SORT_KEY_MESH_BITS) | meshId;
+  return key << SORT_KEY_DEPTH_BITS;
+}
+
+u64 drawSortDepthKey(f32 depth) {
+  const u32 maxDepthKey = (1u << SORT_KEY_DEPTH_BITS) - 1;
+  if(!(depth > 0.0f)) { return 0; } // also catches NaN
+  if(depth >= 1.0f) { return maxDepthKey; }
+  return (u64)(depth * maxDepthKey);
+}
+
+void radixSortDrawItems(WorkerPool& workers, std::vector<DrawSortItem>& items, std::vector<DrawSortItem>& scratch) {
+  u32 count = (u32)items.size();
+  scratch.resize(count);
+  if(count < 2) { return; }
+
+  // a byte that is the same in every key would move nothing, those passes are skipped
+  u64 keysOr = 0;
+  u64 keysAnd = ~0ull;
+  for(u32 i = 0; i < count; i++) {
+    keysOr |= items[i].key;
+    keysAnd &= items[i].key;
+  }
+  u64 varyingBits = keysOr ^ keysAnd;
+
+  u32 workerCount = MIN(workers.workerCount(), (u32)MAX_SORT_WORKERS);
+  u32 neededWorkers = MAX(count / RADIX_SORT_MIN_ITEMS_PER_WORKER, 1u);
+  workerCount = MIN(workerCount, neededWorkers);
+  u32 itemsPerWorker = (count + workerCount - 1) / workerCount;
+
+  // per worker digit counts, turned into the worker's first output slot for each digit
+  u32 workerDigitOffsets[MAX_SORT_WORKERS][256];
+
+  DrawSortItem* src = items.data();
+  DrawSortItem* dst = scratch.data();
+  for(u32 shift = 0; shift < 64; shift += 8) {
+    if(((varyingBits >> shift) & 0xFF) == 0) { continue; }
+
+    workers.run(workerCount, [&](u32 worker) {
+      u32* digitCounts = workerDigitOffsets[worker];
+      memset(digitCounts, 0, 256 * sizeof(u32));
+      u32 begin = MIN(worker * itemsPerWorker, count);
+      u32 end = MIN(begin + itemsPerWorker, count);
+      for(u32 i = begin; i < end; i++) {
+        digitCounts[(src[i].key >> shift) & 0xFF]++;
+      }
+    });
+
+    // digit major, worker minor, so items with equal digits keep their order and the sort stays stable
+    u32 offset = 0;
+    for(u32 digit = 0; digit < 256; digit++) {
+      for(u32 worker = 0; worker < workerCount; worker++) {
+        u32 digitCount = workerDigitOffsets[worker][digit];
+        workerDigitOffsets[worker][digit] = offset;
+        offset += digitCount;
+      }
+    }
+
+    workers.run(workerCount, [&](u32 worker) {
+      u32* digitOffsets = workerDigitOffsets[worker];
+      u32 begin = MIN(worker * itemsPerWorker, count);
+      u32 end = MIN(begin + itemsPerWorker, count);
+      for(u32 i = begin; i < end; i++) {
+        dst[digitOffsets[(src[i].key >> shift) & 0xFF]++] = src[i];
+      }
+    });
+
+    DrawSortItem* sorted = dst;
+    dst = src;
+    src = sorted;
+  }
+
+  if(src != items.data()) {
+    items.swap(scratch);
+  }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+// Draw sort keys compare as plain integers, most significant field first:
+// | pass 4 | material 12 | mesh 20 | depth 28 |
+// Sorting by them groups draws by the state that is most expensive to change and orders each group front to back.
+// Textures are indexed per object out of the bindless set, so they aren't draw state and have no field.
+#define SORT_KEY_DEPTH_BITS 28
+#define SORT_KEY_MESH_BITS 20
+#define SORT_KEY_MATERIAL_BITS 12
+#define SORT_KEY_PASS_BITS 4
+
+#define MAX_SORT_WORKERS 16
+
+enum class DrawPass : u32 {
+  Opaque = 0,
+};
+
+struct DrawSortItem {
+  u64 key;
+  u32 objectIndex;
+};
+
+// Ids are small per frame indices handed out by the caller, not handles, they must fit in their field
+u64 drawSortStateKey(DrawPass pass, u32 materialId, u32 meshId);
+// depth is normalized to [0, 1] between the near and far planes and clamped, nearer sorts first
+u64 drawSortDepthKey(f32 depth);
+
+// Stable LSD radix sort by key, one byte per pass, split across the pool's workers
+// Passes in which every key has the same byte are skipped, so keys with unused high fields cost nothing extra
+// scratch is resized to match items, the sorted result is left in items
+void radixSortDrawItems(WorkerPool& workers, std::vector<DrawSortItem>& items, std::vector<DrawSortItem>& scratch);
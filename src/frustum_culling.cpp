@@ -0,0 +1,115 @@
+void CullingSpheres::resize(u32 sphereCount) {
+  u32 paddedCount = (sphereCount + CULLING_BATCH_WIDTH - 1) / CULLING_BATCH_WIDTH * CULLING_BATCH_WIDTH;
+  centerX.resize(paddedCount);
+  centerY.resize(paddedCount);
+  centerZ.resize(paddedCount);
+  radius.resize(paddedCount);
+  count = sphereCount;
+
+  // a negative infinite radius fails every plane test
+  for(u32 i = sphereCount; i < paddedCount; i++) {
+    centerX[i] = 0.0f;
+    centerY[i] = 0.0f;
+    centerZ[i] = 0.0f;
+    radius[i] = -INFINITY;
+  }
+}
+
+void CullingSpheres::set(u32 index, const mat4& modelMatrix, const vec4& boundingSphere) {
+  Assert(index < count)
+  if(boundingSphere.w < 0.0f) {
+    // nothing to test against, an infinite radius passes every plane test
+    centerX[index] = 0.0f;
+    centerY[index] = 0.0f;
+    centerZ[index] = 0.0f;
+    radius[index] = INFINITY;
+    return;
+  }
+
+  vec4 center = modelMatrix * Vec4(boundingSphere.xyz, 1.0f);
+  centerX[index] = center.x;
+  centerY[index] = center.y;
+  centerZ[index] = center.z;
+
+  // non-uniform scale stretches the sphere by the longest scaled axis
+  f32 scaleSquared = MAX(magnitudeSquared(modelMatrix.xTransform.xyz), magnitudeSquared(modelMatrix.yTransform.xyz));
+  scaleSquared = MAX(scaleSquared, magnitudeSquared(modelMatrix.zTransform.xyz));
+  radius[index] = boundingSphere.w * sqrtf(scaleSquared);
+}
+
+// Gribb & Hartmann, "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix"
+// Clip space is -w <= x,y,z <= w, each plane is the last row of viewProj plus or minus one of the other rows
+Frustum frustumFromViewProj(const mat4& viewProj) {
+  vec4 rows[4];
+  for(u32 row = 0; row < 4; row++) {
+    rows[row] = {viewProj.val2d[0][row], viewProj.val2d[1][row], viewProj.val2d[2][row], viewProj.val2d[3][row]};
+  }
+
+  Frustum frustum;
+  frustum.planes[0] = rows[3] + rows[0]; // left
+  frustum.planes[1] = rows[3] - rows[0]; // right
+  frustum.planes[2] = rows[3] + rows[1]; // bottom
+  frustum.planes[3] = rows[3] - rows[1]; // top
+  frustum.planes[4] = rows[3] + rows[2]; // near
+  frustum.planes[5] = rows[3] - rows[2]; // far
+
+  // normalized so the plane distance can be compared against a sphere's radius
+  for(vec4& plane: frustum.planes) {
+    plane = plane * (1.0f / magnitude(plane.xyz));
+  }
+  return frustum;
+}
+
+u32 cullSpheres(const Frustum& frustum, const CullingSpheres& spheres, u32* outVisibleIndices) {
+  u32 visibleCount = 0;
+  for(u32 batch = 0; batch < spheres.count; batch += CULLING_BATCH_WIDTH) {
+    u32 visibleMask;
+#if FRUSTUM_CULLING_AVX
+    __m256 centerX = _mm256_loadu_ps(spheres.centerX.data() + batch);
+    __m256 centerY = _mm256_loadu_ps(spheres.centerY.data() + batch);
+    __m256 centerZ = _mm256_loadu_ps(spheres.centerZ.data() + batch);
+    __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius.data() + batch));
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for(const vec4& plane: frustum.planes) {
+      __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(centerX, _mm256_set1_ps(plane.x)),
+                                                _mm256_mul_ps(centerY, _mm256_set1_ps(plane.y))),
+                                  _mm256_add_ps(_mm256_mul_ps(centerZ, _mm256_set1_ps(plane.z)),
+                                                _mm256_set1_ps(plane.w)));
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, negRadius, _CMP_GE_OQ));
+    }
+    visibleMask = (u32)_mm256_movemask_ps(inside);
+#elif FRUSTUM_CULLING_SSE
+    __m128 centerX = _mm_loadu_ps(spheres.centerX.data() + batch);
+    __m128 centerY = _mm_loadu_ps(spheres.centerY.data() + batch);
+    __m128 centerZ = _mm_loadu_ps(spheres.centerZ.data() + batch);
+    __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius.data() + batch));
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for(const vec4& plane: frustum.planes) {
+      __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(plane.x)),
+                                          _mm_mul_ps(centerY, _mm_set1_ps(plane.y))),
+                               _mm_add_ps(_mm_mul_ps(centerZ, _mm_set1_ps(plane.z)),
+                                          _mm_set1_ps(plane.w)));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, negRadius));
+    }
+    visibleMask = (u32)_mm_movemask_ps(inside);
+#else
+    visibleMask = 0;
+    for(u32 lane = 0; lane < CULLING_BATCH_WIDTH; lane++) {
+      u32 i = batch + lane;
+      bool inside = true;
+      for(const vec4& plane: frustum.planes) {
+        f32 dist = spheres.centerX[i] * plane.x + spheres.centerY[i] * plane.y + spheres.centerZ[i] * plane.z + plane.w;
+        inside = inside && dist >= -spheres.radius[i];
+      }
+      visibleMask |= (u32)inside << lane;
+    }
+#endif
+
+    for(u32 lane = 0; lane < CULLING_BATCH_WIDTH; lane++) {
+      if(visibleMask & (1u << lane)) {
+        outVisibleIndices[visibleCount++] = batch + lane;
+      }
+    }
+  }
+  return visibleCount;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_CULLING_AVX 1
+#define CULLING_BATCH_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define FRUSTUM_CULLING_SSE 1
+#define CULLING_BATCH_WIDTH 4
+#else
+#define CULLING_BATCH_WIDTH 4
+#endif
+
+// Planes are stored as {normal.x, normal.y, normal.z, distance} with normals pointing into the frustum,
+// so a point p is inside a plane when dot(normal, p) + distance >= 0
+struct Frustum {
+  vec4 planes[6];
+};
+
+// World space bounding spheres laid out SoA so they can be tested CULLING_BATCH_WIDTH at a time
+// The arrays are padded up to a multiple of CULLING_BATCH_WIDTH, padding is never reported as visible
+struct CullingSpheres {
+  std::vector<f32> centerX;
+  std::vector<f32> centerY;
+  std::vector<f32> centerZ;
+  std::vector<f32> radius;
+  u32 count = 0;
+
+  void resize(u32 sphereCount);
+  // boundingSphere is in object space, xyz: center, w: radius, negative for spheres that are never culled
+  void set(u32 index, const mat4& modelMatrix, const vec4& boundingSphere);
+};
+
+Frustum frustumFromViewProj(const mat4& viewProj);
+// Writes the indices of every sphere that intersects the frustum to outVisibleIndices, in ascending order
+// outVisibleIndices must have room for spheres.count indices
+u32 cullSpheres(const Frustum& frustum, const CullingSpheres& spheres, u32* outVisibleIndices);
@@ -0,0 +1,73 @@
+void RangeAllocator::init(u32 capacity) {
+  freeRanges.clear();
+  freeRanges.push_back({0, capacity});
+  freeTotal = capacity;
+  totalCapacity = capacity;
+}
+
+bool RangeAllocator::allocate(u32 size, u32* outOffset) {
+  for(u64 i = 0; i < freeRanges.size(); i++) {
+    Range& range = freeRanges[i];
+    if(range.size < size) { continue; }
+
+    *outOffset = range.offset;
+    range.offset += size;
+    range.size -= size;
+    if(range.size == 0) {
+      freeRanges.erase(freeRanges.begin() + i);
+    }
+    freeTotal -= size;
+    return true;
+  }
+  return false;
+}
+
+void RangeAllocator::free(u32 offset, u32 size) {
+  if(size == 0) { return; }
+  freeTotal += size;
+
+  auto next = std::lower_bound(freeRanges.begin(), freeRanges.end(), offset, [](const Range& range, u32 value) {
+    return range.offset < value;
+  });
+  Assert(next == freeRanges.end() || offset + size <= next->offset)
+
+  bool joinsPrevious = next != freeRanges.begin() && (next - 1)->offset + (next - 1)->size == offset;
+  bool joinsNext = next != freeRanges.end() && offset + size == next->offset;
+  if(joinsPrevious && joinsNext) {
+    (next - 1)->size += size + next->size;
+    freeRanges.erase(next);
+  } else if(joinsPrevious) {
+    (next - 1)->size += size;
+  } else if(joinsNext) {
+    next->offset = offset;
+    next->size += size;
+  } else {
+    freeRanges.insert(next, {offset, size});
+  }
+}
+
+void GeometryArena::init(VmaAllocator vmaAllocator, u32 vertexCapacity, u32 indexCapacity, u32 vertexSize) {
+  vertexBuffer = vkutil::createBuffer(vmaAllocator, (u64)vertexCapacity * vertexSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+  indexBuffer = vkutil::createBuffer(vmaAllocator, (u64)indexCapacity * sizeof(u32), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+  vertexRanges.init(vertexCapacity);
+  indexRanges.init(indexCapacity);
+}
+
+void GeometryArena::destroy(VmaAllocator vmaAllocator) {
+  vmaDestroyBuffer(vmaAllocator, vertexBuffer.vkBuffer, vertexBuffer.vmaAllocation);
+  vmaDestroyBuffer(vmaAllocator, indexBuffer.vkBuffer, indexBuffer.vmaAllocation);
+}
+
+bool GeometryArena::allocate(u32 vertexCount, u32 indexCount, u32* outVertexOffset, u32* outFirstIndex) {
+  if(!vertexRanges.allocate(vertexCount, outVertexOffset)) { return false; }
+  if(!indexRanges.allocate(indexCount, outFirstIndex)) {
+    vertexRanges.free(*outVertexOffset, vertexCount);
+    return false;
+  }
+  return true;
+}
+
+void GeometryArena::free(u32 vertexOffset, u32 vertexCount, u32 firstIndex, u32 indexCount) {
+  vertexRanges.free(vertexOffset, vertexCount);
+  indexRanges.free(firstIndex, indexCount);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// Hands out ranges of [0, capacity) first fit, freed ranges are merged back into their free neighbours
+// Offsets and sizes are in elements, the caller decides what an element is
+class RangeAllocator {
+public:
+  void init(u32 capacity);
+  bool allocate(u32 size, u32* outOffset); // false when no free range is large enough
+  void free(u32 offset, u32 size);
+  u32 freeCount() const { return freeTotal; }
+  u32 capacity() const { return totalCapacity; }
+
+private:
+  struct Range {
+    u32 offset;
+    u32 size;
+  };
+  std::vector<Range> freeRanges; // sorted by offset, never touching each other
+  u32 freeTotal = 0;
+  u32 totalCapacity = 0;
+};
+
+// Every mesh's vertices and indices live in one shared pair of device local buffers, so draws only bind them once
+// per command buffer and select a mesh through vertexOffset and firstIndex
+struct GeometryArena {
+  AllocatedBuffer vertexBuffer;
+  AllocatedBuffer indexBuffer;
+  RangeAllocator vertexRanges; // in vertices
+  RangeAllocator indexRanges; // in indices
+
+  void init(VmaAllocator vmaAllocator, u32 vertexCapacity, u32 indexCapacity, u32 vertexSize);
+  void destroy(VmaAllocator vmaAllocator);
+  // Reserves room for a mesh, false and nothing reserved when either buffer is out of space
+  bool allocate(u32 vertexCount, u32 indexCount, u32* outVertexOffset, u32* outFirstIndex);
+  void free(u32 vertexOffset, u32 vertexCount, u32 firstIndex, u32 indexCount);
+};
@@ -8,6 +8,7 @@ void MaterialManager::getPushConstantRangeData(const ReflectData& data, std::vec
     pushConstantRange.offset = pushConstantBlock->offset;
     pushConstantRange.size = pushConstantBlock->size;
     pushConstantRange.stageFlags = data.shaderStage;
+    outData.push_back(pushConstantRange);
   }
 
   // sort the push constant ranges by offset
@@ -187,6 +188,32 @@ void MaterialManager::destroyAll(VkDevice device) {
   cachedVertShaders.clear();
   cachedFragShaders.clear();
   cachedShaders.clear();
+  prefetchedShaderFiles.clear();
+}
+
+void MaterialManager::prefetchShaderFile(assets::AsyncAssetReader& assetReader, const char* fileName) {
+  if(cachedVertShaders.find(fileName) != cachedVertShaders.end() ||
+     cachedFragShaders.find(fileName) != cachedFragShaders.end() ||
+     prefetchedShaderFiles.find(fileName) != prefetchedShaderFiles.end()) {
+    return;
+  }
+  prefetchedShaderFiles[fileName] = assetReader.readFile(fileName);
+}
+
+void MaterialManager::loadShaderBytes(const char* fileName, std::vector<char>& outBytes) {
+  auto prefetchedIter = prefetchedShaderFiles.find(fileName);
+  if(prefetchedIter == prefetchedShaderFiles.end()) {
+    vkutil::loadShaderBuffer(fileName, outBytes);
+    return;
+  }
+
+  outBytes = prefetchedIter->second.get();
+  prefetchedShaderFiles.erase(prefetchedIter);
+  if(outBytes.empty()) { // failed prefetch, let the blocking path report the error
+    vkutil::loadShaderBuffer(fileName, outBytes);
+    return;
+  }
+  vkutil::alignShaderBuffer(outBytes);
 }
 
 void MaterialManager::loadShaderMetadata(VkDevice device, const char* vertFileName, const char* fragFileName, ShaderMetadata& out) {
@@ -200,7 +227,7 @@ void MaterialManager::loadShaderMetadata(VkDevice device, const char* vertFileNa
     vertShader = cachedVertShaders[vertFileName];
   } else {
     std::vector<char> vertShaderBytes;
-    vkutil::loadShaderBuffer(vertFileName, vertShaderBytes);
+    loadShaderBytes(vertFileName, vertShaderBytes);
 
     vertShader.module = vkutil::loadShaderModule(device, vertShaderBytes);
     if(vertShader.module == VK_NULL_HANDLE) { return; }
@@ -279,7 +306,7 @@ void MaterialManager::loadShaderMetadata(VkDevice device, const char* vertFileNa
     fragShader = cachedFragShaders[fragFileName];
   } else {
     std::vector<char> fragShaderBytes;
-    vkutil::loadShaderBuffer(fragFileName, fragShaderBytes);
+    loadShaderBytes(fragFileName, fragShaderBytes);
 
     fragShader.module = vkutil::loadShaderModule(device, fragShaderBytes);
     if(fragShader.module == VK_NULL_HANDLE) { return; }
@@ -303,13 +330,11 @@ void MaterialManager::loadShaderMetadata(VkDevice device, const char* vertFileNa
     spvReflectDestroyShaderModule(&fragReflModule);
   }
 
+  // both stages may be cached from other pairings without this pairing having been merged yet
   const std::string vertFragShaderKey = std::string(vertFileName) + fragFileName;
-  if(vertShaderCached && fragShaderCached) {
-    combinationShaderCached = cachedShaders.find(vertFragShaderKey) != cachedShaders.end();
-
-    if(combinationShaderCached) {
-      out = cachedShaders[vertFragShaderKey];
-    }
+  combinationShaderCached = cachedShaders.find(vertFragShaderKey) != cachedShaders.end();
+  if(combinationShaderCached) {
+    out = cachedShaders[vertFragShaderKey];
   } else {
     mergeReflectionData(vertShader, fragShader, out);
 
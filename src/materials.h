@@ -66,8 +66,14 @@ public:
 
   void loadShaderMetadata(VkDevice device, const char* vertFileName, const char* fragFileName, ShaderMetadata& out);
 
+  // Starts reading the shader file in the background, loadShaderMetadata() picks up the result when it needs it
+  void prefetchShaderFile(assets::AsyncAssetReader& assetReader, const char* fileName);
+
 private:
 
+  std::unordered_map<std::string, std::future<std::vector<char>>> prefetchedShaderFiles;
+  void loadShaderBytes(const char* fileName, std::vector<char>& outBytes);
+
   struct ReflectData {
     VkShaderStageFlagBits shaderStage;
     std::vector<SpvReflectDescriptorSet*> reflectDescSets;
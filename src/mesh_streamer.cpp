@@ -0,0 +1,185 @@
+internal_access Mesh decodeStreamedMesh(bool success, assets::AssetFile& assetFile) {
+  Mesh mesh{};
+  if(success) { mesh.loadFromAssetFile(assetFile); }
+  return mesh;
+}
+
+// false when the decode failed, the handle's geometry is left empty then
+internal_access bool takeDecodedMesh(Mesh* mesh, Mesh& decoded) {
+  mesh->vertices = std::move(decoded.vertices);
+  mesh->indices = std::move(decoded.indices);
+  mesh->vertexCount = decoded.vertexCount;
+  mesh->indexCount = decoded.indexCount;
+  mesh->bounds = decoded.bounds;
+  return !mesh->vertices.empty();
+}
+
+// the upload manager copies into its staging ring as uploads are recorded, the CPU copy isn't needed after that
+internal_access void releaseCpuCopy(Mesh* mesh) {
+  std::vector<Vertex>().swap(mesh->vertices);
+  std::vector<u32>().swap(mesh->indices);
+}
+
+internal_access u64 meshByteSize(const Mesh& mesh) {
+  return (u64)mesh.vertexCount * sizeof(Vertex) + (u64)mesh.indexCount * sizeof(u32);
+}
+
+void MeshStreamer::init(assets::AsyncAssetReader* assetReader, UploadManager* uploadManager, GeometryArena* geometryArena, u32 meshCapacity, u32 framesInFlight) {
+  this->assetReader = assetReader;
+  this->uploadManager = uploadManager;
+  this->geometryArena = geometryArena;
+  this->framesInFlight = framesInFlight;
+  meshStorage.reserve(meshCapacity);
+}
+
+void MeshStreamer::destroy() {
+  // reads still in flight complete into their futures' shared state, they don't touch anything owned here
+  queuedMeshes.clear();
+  pendingLoads.clear();
+  decodedMeshes.clear();
+  uploadingMeshes.clear();
+  residentMeshes.clear();
+  pendingFrees.clear();
+  meshStorage.clear();
+  placeholder = nullptr;
+}
+
+Mesh* MeshStreamer::registerMesh(const char* filePath) {
+  Assert(meshStorage.size() < meshStorage.capacity())
+  meshStorage.push_back({});
+  Mesh& mesh = meshStorage.back();
+  mesh.filePath = filePath;
+  mesh.residency = MeshResidency::Unloaded;
+  return &mesh;
+}
+
+bool MeshStreamer::loadPlaceholder(Mesh* mesh) {
+  Mesh decoded = assetReader->readAssetFile<Mesh>(mesh->filePath, decodeStreamedMesh).get();
+  if(!takeDecodedMesh(mesh, decoded) || !mesh->uploadMesh(*uploadManager, *geometryArena)) {
+    releaseCpuCopy(mesh);
+    mesh->residency = MeshResidency::Failed;
+    return false;
+  }
+  releaseCpuCopy(mesh);
+
+  // nothing waits on this on the CPU, the first frame's submission waits for it on the GPU
+  mesh->uploadValue = uploadManager->flush();
+  mesh->residency = MeshResidency::Resident;
+  placeholder = mesh;
+  return true;
+}
+
+bool MeshStreamer::update(u32 frameNumber) {
+  bool drawablesChanged = false;
+
+  // pendingFrees is in eviction order, the ranges evicted framesInFlight frames ago are no longer read by any frame
+  u64 retiredCount = 0;
+  while(retiredCount < pendingFrees.size() && pendingFrees[retiredCount].evictedFrame + framesInFlight <= frameNumber) {
+    const PendingFree& range = pendingFrees[retiredCount++];
+    geometryArena->free(range.vertexOffset, range.vertexCount, range.firstIndex, range.indexCount);
+    pendingFreeVertices -= range.vertexCount;
+    pendingFreeIndices -= range.indexCount;
+  }
+  pendingFrees.erase(pendingFrees.begin(), pendingFrees.begin() + retiredCount);
+
+  for(u64 i = 0; i < uploadingMeshes.size();) {
+    Mesh* mesh = uploadingMeshes[i];
+    if(!uploadManager->isComplete(mesh->uploadValue)) {
+      i++;
+      continue;
+    }
+    mesh->residency = MeshResidency::Resident;
+    // counts as used on arrival, a mesh only ever referenced is then evicted in the order it came in
+    mesh->lastUsedFrame = frameNumber;
+    residentMeshes.push_back(mesh);
+    uploadingMeshes[i] = uploadingMeshes.back();
+    uploadingMeshes.pop_back();
+    drawablesChanged = true;
+  }
+
+  for(u64 i = 0; i < pendingLoads.size();) {
+    PendingLoad& load = pendingLoads[i];
+    if(load.decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      i++;
+      continue;
+    }
+
+    Mesh* mesh = load.mesh;
+    Mesh decoded = load.decoded.get();
+    bool fitsArena = decoded.vertexCount <= geometryArena->vertexRanges.capacity() && decoded.indexCount <= geometryArena->indexRanges.capacity();
+    if(takeDecodedMesh(mesh, decoded) && fitsArena) {
+      mesh->residency = MeshResidency::Decoded;
+      decodedMeshes.push_back(mesh);
+    } else {
+      std::cout << "Failed to stream mesh: " << mesh->filePath << std::endl;
+      releaseCpuCopy(mesh);
+      mesh->residency = MeshResidency::Failed;
+    }
+    pendingLoads[i] = std::move(pendingLoads.back());
+    pendingLoads.pop_back();
+  }
+
+  u64 startedCount = 0;
+  while(startedCount < queuedMeshes.size() && loadsInFlight() < MAX_MESH_LOADS_IN_FLIGHT) {
+    Mesh* mesh = queuedMeshes[startedCount++];
+    mesh->residency = MeshResidency::Loading;
+    pendingLoads.push_back({mesh, assetReader->readAssetFile<Mesh>(mesh->filePath, decodeStreamedMesh)});
+  }
+  queuedMeshes.erase(queuedMeshes.begin(), queuedMeshes.begin() + startedCount);
+
+  // a mesh that doesn't fit stays decoded and is retried every frame until evictions have made room
+  u64 firstNewUpload = uploadingMeshes.size();
+  for(u64 i = 0; i < decodedMeshes.size();) {
+    Mesh* mesh = decodedMeshes[i];
+    if(!mesh->uploadMesh(*uploadManager, *geometryArena)) {
+      drawablesChanged |= evictFor(*mesh, frameNumber);
+      i++;
+      continue;
+    }
+    releaseCpuCopy(mesh);
+    mesh->residency = MeshResidency::Uploading;
+    uploadingMeshes.push_back(mesh);
+    residentByteCount += meshByteSize(*mesh);
+    decodedMeshes.erase(decodedMeshes.begin() + i);
+  }
+
+  if(uploadingMeshes.size() > firstNewUpload) {
+    u64 uploadValue = uploadManager->flush();
+    for(u64 i = firstNewUpload; i < uploadingMeshes.size(); i++) {
+      uploadingMeshes[i]->uploadValue = uploadValue;
+    }
+  }
+
+  return drawablesChanged;
+}
+
+bool MeshStreamer::evictFor(const Mesh& mesh, u32 frameNumber) {
+  u32 evictedCount = 0;
+  // With enough free space in total the arena is only fragmented, one eviction may open a large enough range
+  // Meshes evicted earlier are waited for before evicting more
+  while(geometryArena->vertexRanges.freeCount() + pendingFreeVertices < mesh.vertexCount ||
+        geometryArena->indexRanges.freeCount() + pendingFreeIndices < mesh.indexCount ||
+        (evictedCount == 0 && pendingFrees.empty())) {
+    // meshes drawn last frame would only be requested straight back
+    u64 victimIndex = U64_MAX;
+    for(u64 i = 0; i < residentMeshes.size(); i++) {
+      const Mesh* resident = residentMeshes[i];
+      if(resident->lastUsedFrame + 1 >= frameNumber) { continue; }
+      if(victimIndex == U64_MAX || resident->lastUsedFrame < residentMeshes[victimIndex]->lastUsedFrame) {
+        victimIndex = i;
+      }
+    }
+    if(victimIndex == U64_MAX) { break; }
+
+    Mesh* victim = residentMeshes[victimIndex];
+    pendingFrees.push_back({victim->vertexOffset, victim->vertexCount, victim->firstIndex, victim->indexCount, frameNumber});
+    pendingFreeVertices += victim->vertexCount;
+    pendingFreeIndices += victim->indexCount;
+    residentByteCount -= meshByteSize(*victim);
+    victim->residency = MeshResidency::Unloaded;
+    residentMeshes[victimIndex] = residentMeshes.back();
+    residentMeshes.pop_back();
+    evictedCount++;
+  }
+  return evictedCount > 0;
+}
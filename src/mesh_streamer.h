@@ -0,0 +1,76 @@
+#pragma once
+
+#define MAX_MESH_LOADS_IN_FLIGHT 8 // decoded meshes waiting on the arena are the only CPU copies kept, this bounds them
+
+// Meshes are registered by file and only read once something asks to draw them. The Mesh pointers handed out stay
+// valid for the life of the streamer and are the handles, whatever the mesh's residency. Until a mesh is resident its
+// draws use the placeholder. When the geometry arena runs out of room the least recently used meshes are evicted, their
+// ranges only go back to the arena once every frame that could still draw them has finished.
+class MeshStreamer {
+public:
+  // framesInFlight is how many frames after an eviction the evicted ranges may still be read by the GPU
+  void init(assets::AsyncAssetReader* assetReader, UploadManager* uploadManager, GeometryArena* geometryArena, u32 meshCapacity, u32 framesInFlight);
+  void destroy();
+
+  Mesh* registerMesh(const char* filePath); // nothing is read until the mesh is requested
+  // Loads the mesh on the calling thread, it is drawn in place of meshes that aren't resident and is never evicted
+  bool loadPlaceholder(Mesh* mesh);
+
+  // Marks the mesh as used by this frame and queues a load if it isn't resident
+  void request(Mesh* mesh, u32 frameNumber) {
+    mesh->lastUsedFrame = frameNumber;
+    reference(mesh);
+  }
+  // Queues a load like request() but leaves the mesh evictable, for meshes drawn only if the GPU finds them visible
+  void reference(Mesh* mesh) {
+    if(mesh->residency == MeshResidency::Unloaded) {
+      mesh->residency = MeshResidency::Queued;
+      queuedMeshes.push_back(mesh);
+    }
+  }
+  // The mesh itself once resident, the placeholder until then
+  Mesh* drawable(Mesh* mesh) const { return mesh->residency == MeshResidency::Resident ? mesh : placeholder; }
+
+  // Finishes loads and uploads, starts queued loads and evicts what doesn't fit, called once per frame
+  // True when a mesh became resident or was evicted, anything built from drawable() is out of date then
+  bool update(u32 frameNumber);
+
+  u32 residentCount() const { return (u32)residentMeshes.size(); }
+  u64 residentBytes() const { return residentByteCount; }
+  u32 loadsInFlight() const { return (u32)(pendingLoads.size() + decodedMeshes.size()); }
+
+private:
+  struct PendingLoad {
+    Mesh* mesh;
+    std::future<Mesh> decoded;
+  };
+
+  struct PendingFree {
+    u32 vertexOffset, vertexCount;
+    u32 firstIndex, indexCount;
+    u32 evictedFrame;
+  };
+
+  // Evicts least recently used meshes not drawn last frame until the arena, once pending frees retire, has room for the mesh
+  // Returns whether anything was evicted
+  bool evictFor(const Mesh& mesh, u32 frameNumber);
+
+  assets::AsyncAssetReader* assetReader;
+  UploadManager* uploadManager;
+  GeometryArena* geometryArena;
+  u32 framesInFlight;
+
+  std::vector<Mesh> meshStorage; // reserved up front and never reallocated, the handles point into it
+  Mesh* placeholder = nullptr;
+
+  std::vector<Mesh*> queuedMeshes; // in request order
+  std::vector<PendingLoad> pendingLoads;
+  std::vector<Mesh*> decodedMeshes;
+  std::vector<Mesh*> uploadingMeshes;
+  std::vector<Mesh*> residentMeshes; // placeholder excluded
+  u64 residentByteCount = 0; // uploading meshes included
+
+  std::vector<PendingFree> pendingFrees;
+  u32 pendingFreeVertices = 0;
+  u32 pendingFreeIndices = 0;
+};
@@ -0,0 +1,667 @@
+struct RenderGraphAccessInfo {
+  VkPipelineStageFlags stage;
+  VkAccessFlags access;
+  VkImageLayout layout; // for images
+  VkImageUsageFlags usage; // for transient images
+  bool write;
+  bool attachment;
+};
+
+// indexed by RenderGraphAccess
+internal_access const RenderGraphAccessInfo renderGraphAccessInfos[] = {
+        {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true, true},
+        {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+         VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true, true},
+        {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+         VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, false, true},
+        {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false, false},
+        {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false, false},
+        {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+         VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false, false},
+        {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+         VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, true, false},
+        {VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+         VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false, false},
+        {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+         VK_IMAGE_LAYOUT_UNDEFINED /*buffers only*/, 0, false, false},
+};
+static_assert(ArrayCount(renderGraphAccessInfos) == (u32)RenderGraphAccess::Count, "every access needs its info");
+
+internal_access const VkAccessFlags renderGraphWriteAccesses = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                                               VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+internal_access const RenderGraphAccessInfo& accessInfo(RenderGraphAccess access) {
+  return renderGraphAccessInfos[(u32)access];
+}
+
+internal_access bool isDepthFormat(VkFormat format) {
+  return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_X8_D24_UNORM_PACK32 || format == VK_FORMAT_D32_SFLOAT ||
+         format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+void RenderGraph::init(VkDevice device, VmaAllocator vmaAllocator) {
+  this->device = device;
+  this->vmaAllocator = vmaAllocator;
+}
+
+void RenderGraph::reset() {
+  if(compiled) {
+    for(Group& group: groups) {
+      for(VkFramebuffer framebuffer: group.framebuffers) {
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+      }
+      vkDestroyRenderPass(device, group.renderPass, nullptr);
+    }
+    for(Resource& resource: resources) {
+      if(!resource.isImage || resource.imported || resource.images[0] == VK_NULL_HANDLE) { continue; }
+      vkDestroyImageView(device, resource.views[0], nullptr);
+      vkDestroyImage(device, resource.images[0], nullptr);
+    }
+    for(MemorySlot& slot: memorySlots) {
+      vmaFreeMemory(vmaAllocator, slot.allocation);
+    }
+  }
+
+  resources.clear();
+  passes.clear();
+  groups.clear();
+  steps.clear();
+  finalBarriers.clear();
+  memorySlots.clear();
+  transientBytes = 0;
+  compiled = false;
+}
+
+RenderGraphResource RenderGraph::createImage(const char* name, VkFormat format, VkExtent2D extent) {
+  Assert(!compiled)
+  Resource resource = {};
+  resource.name = name;
+  resource.isImage = true;
+  resource.imported = false;
+  resource.format = format;
+  resource.extent = extent;
+  resource.aspect = isDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+  resource.imageCount = 1;
+  resources.push_back(resource);
+  return (RenderGraphResource)resources.size() - 1;
+}
+
+RenderGraphResource RenderGraph::importImage(const char* name, VkFormat format, VkExtent2D extent, const VkImage* images, const VkImageView* views, u32 imageCount,
+                                             VkPipelineStageFlags readyStage, VkImageLayout finalLayout) {
+  Assert(!compiled)
+  Assert(imageCount <= RENDER_GRAPH_MAX_IMPORTED_IMAGES)
+  Resource resource = {};
+  resource.name = name;
+  resource.isImage = true;
+  resource.imported = true;
+  resource.format = format;
+  resource.extent = extent;
+  resource.aspect = isDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+  resource.imageCount = imageCount;
+  for(u32 i = 0; i < imageCount; i++) {
+    resource.images[i] = images[i];
+    resource.views[i] = views[i];
+  }
+  resource.readyStage = readyStage;
+  resource.finalLayout = finalLayout;
+  resources.push_back(resource);
+  return (RenderGraphResource)resources.size() - 1;
+}
+
+RenderGraphResource RenderGraph::importBuffer(const char* name) {
+  Assert(!compiled)
+  Resource resource = {};
+  resource.name = name;
+  resource.isImage = false;
+  resource.imported = true;
+  resources.push_back(resource);
+  return (RenderGraphResource)resources.size() - 1;
+}
+
+RenderGraphPass RenderGraph::addPass(const char* name, RenderGraphPassType type, RenderGraphRecordFunc&& record) {
+  Assert(!compiled)
+  Pass pass = {};
+  pass.name = name;
+  pass.type = type;
+  pass.record = std::move(record);
+  pass.group = U32_MAX;
+  passes.push_back(std::move(pass));
+  return (RenderGraphPass)passes.size() - 1;
+}
+
+void RenderGraph::use(RenderGraphPass pass, RenderGraphResource resource, RenderGraphAccess access, const VkClearValue* clearValue) {
+  Assert(!compiled)
+  const RenderGraphAccessInfo& info = accessInfo(access);
+  Assert(!info.attachment || (resources[resource].isImage && passes[pass].type == RenderGraphPassType::Raster))
+  Assert(clearValue == nullptr || (info.attachment && info.write))
+
+  Use newUse = {};
+  newUse.resource = resource;
+  newUse.access = access;
+  newUse.clear = clearValue != nullptr;
+  if(clearValue != nullptr) { newUse.clearValue = *clearValue; }
+  passes[pass].uses.push_back(newUse);
+}
+
+void RenderGraph::compile() {
+  Assert(!compiled)
+  cullPasses();
+  buildSteps();
+  chooseAttachmentOps();
+  allocateTransients();
+  createRenderPasses();
+  buildBarriers();
+  compiled = true;
+}
+
+// Walks the passes backwards keeping track of which resources still have a reader, imported images are read by
+// whatever comes after the frame. Clearing a resource ends the interest in what was written to it before.
+void RenderGraph::cullPasses() {
+  std::vector<bool> live(resources.size());
+  for(u64 i = 0; i < resources.size(); i++) {
+    live[i] = resources[i].imported && resources[i].isImage;
+  }
+
+  for(s64 passIndex = (s64)passes.size() - 1; passIndex >= 0; passIndex--) {
+    Pass& pass = passes[passIndex];
+    pass.culled = true;
+    for(const Use& use: pass.uses) {
+      if(accessInfo(use.access).write && live[use.resource]) { pass.culled = false; }
+    }
+    if(pass.culled) { continue; }
+
+    // anything not cleared may be read, including attachments loaded before they're drawn over
+    for(const Use& use: pass.uses) {
+      if(use.clear) { live[use.resource] = false; }
+    }
+    for(const Use& use: pass.uses) {
+      if(!use.clear) { live[use.resource] = true; }
+    }
+  }
+}
+
+bool RenderGraph::canJoinGroup(const Group& group, const Pass& pass) const {
+  RenderGraphResource depthAttachment = U32_MAX;
+  std::vector<RenderGraphResource> colorAttachments;
+  for(const Use& use: pass.uses) {
+    const RenderGraphAccessInfo& info = accessInfo(use.access);
+    if(info.attachment) {
+      if(resources[use.resource].aspect == VK_IMAGE_ASPECT_DEPTH_BIT) {
+        depthAttachment = use.resource;
+      } else {
+        colorAttachments.push_back(use.resource);
+      }
+    }
+
+    // resources used within a render pass can only be ordered against each other by rasterization order, which
+    // only covers attachments, and with one layout each for the whole render pass
+    for(RenderGraphPass memberIndex: group.passes) {
+      for(const Use& memberUse: passes[memberIndex].uses) {
+        if(memberUse.resource != use.resource) { continue; }
+        const RenderGraphAccessInfo& memberInfo = accessInfo(memberUse.access);
+        if(info.attachment != memberInfo.attachment) { return false; }
+        if(!info.attachment && (info.write || memberInfo.write)) { return false; }
+        if(resources[use.resource].isImage && info.layout != memberInfo.layout) { return false; }
+      }
+    }
+  }
+
+  if(colorAttachments != group.colorAttachments) { return false; }
+  if(depthAttachment != U32_MAX && group.depthAttachment != U32_MAX && depthAttachment != group.depthAttachment) { return false; }
+  return true;
+}
+
+// Compute passes each get a step, consecutive raster passes share one for as long as their attachments allow
+void RenderGraph::buildSteps() {
+  for(RenderGraphPass passIndex = 0; passIndex < (RenderGraphPass)passes.size(); passIndex++) {
+    Pass& pass = passes[passIndex];
+    if(pass.culled) { continue; }
+
+    if(pass.type == RenderGraphPassType::Compute) {
+      steps.push_back({passIndex, U32_MAX, {}});
+      continue;
+    }
+
+    bool joined = !steps.empty() && steps.back().group != U32_MAX && canJoinGroup(groups[steps.back().group], pass);
+    if(!joined) {
+      Group group = {};
+      group.depthAttachment = U32_MAX;
+      group.extent = {0, 0};
+      for(const Use& use: pass.uses) {
+        if(!accessInfo(use.access).attachment) { continue; }
+        if(resources[use.resource].aspect != VK_IMAGE_ASPECT_DEPTH_BIT) {
+          group.colorAttachments.push_back(use.resource);
+        }
+      }
+      groups.push_back(group);
+      steps.push_back({U32_MAX, (u32)groups.size() - 1, {}});
+    }
+
+    Group& group = groups[steps.back().group];
+    group.passes.push_back(passIndex);
+    pass.group = steps.back().group;
+    for(const Use& use: pass.uses) {
+      if(!accessInfo(use.access).attachment) { continue; }
+      const Resource& resource = resources[use.resource];
+      if(resource.aspect == VK_IMAGE_ASPECT_DEPTH_BIT) { group.depthAttachment = use.resource; }
+      if(group.extent.width == 0) { group.extent = resource.extent; }
+      Assert(resource.extent.width == group.extent.width && resource.extent.height == group.extent.height)
+    }
+  }
+
+  for(Resource& resource: resources) {
+    resource.firstStep = U32_MAX;
+    resource.lastStep = U32_MAX;
+    resource.usage = 0;
+  }
+  for(u32 stepIndex = 0; stepIndex < (u32)steps.size(); stepIndex++) {
+    const Step& step = steps[stepIndex];
+    auto markUses = [&](const Pass& pass) {
+      for(const Use& use: pass.uses) {
+        Resource& resource = resources[use.resource];
+        if(resource.firstStep == U32_MAX) { resource.firstStep = stepIndex; }
+        resource.lastStep = stepIndex;
+        resource.usage |= accessInfo(use.access).usage;
+      }
+    };
+    if(step.group == U32_MAX) {
+      markUses(passes[step.pass]);
+    } else {
+      for(RenderGraphPass passIndex: groups[step.group].passes) { markUses(passes[passIndex]); }
+    }
+  }
+}
+
+// Attachments are cleared when the first pass using them asks for it, loaded when an earlier step wrote them and left
+// undefined otherwise. They are only stored when a later step uses them or they are imported.
+void RenderGraph::chooseAttachmentOps() {
+  for(u32 stepIndex = 0; stepIndex < (u32)steps.size(); stepIndex++) {
+    if(steps[stepIndex].group == U32_MAX) { continue; }
+    Group& group = groups[steps[stepIndex].group];
+
+    std::vector<RenderGraphResource> attachments = group.colorAttachments;
+    if(group.depthAttachment != U32_MAX) { attachments.push_back(group.depthAttachment); }
+
+    for(RenderGraphResource attachment: attachments) {
+      const Use* firstUse = nullptr;
+      for(RenderGraphPass passIndex: group.passes) {
+        for(const Use& use: passes[passIndex].uses) {
+          if(use.resource == attachment && firstUse == nullptr) { firstUse = &use; }
+        }
+      }
+      Assert(firstUse != nullptr)
+
+      bool writtenBefore = false;
+      for(u32 earlierStep = 0; earlierStep < stepIndex; earlierStep++) {
+        auto writes = [&](const Pass& pass) {
+          for(const Use& use: pass.uses) {
+            if(use.resource == attachment && accessInfo(use.access).write) { return true; }
+          }
+          return false;
+        };
+        const Step& step = steps[earlierStep];
+        if(step.group == U32_MAX) {
+          writtenBefore |= writes(passes[step.pass]);
+        } else {
+          for(RenderGraphPass passIndex: groups[step.group].passes) { writtenBefore |= writes(passes[passIndex]); }
+        }
+      }
+
+      const Resource& resource = resources[attachment];
+      bool usedAfter = resource.lastStep > stepIndex;
+
+      VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+      if(firstUse->clear) {
+        loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+      } else if(writtenBefore) {
+        loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+      }
+      group.loadOps.push_back(loadOp);
+      group.storeOps.push_back(resource.imported || usedAfter ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE);
+      group.layouts.push_back(accessInfo(firstUse->access).layout);
+      group.clearValues.push_back(firstUse->clear ? firstUse->clearValue : VkClearValue{});
+    }
+  }
+}
+
+// Transient images are placed first fit into memory slots, an image can take a slot over once every image placed
+// in it before is done with. Images that are only ever attachments, never loaded and never stored, don't need
+// memory outside of the tile on GPUs that have lazily allocated memory.
+void RenderGraph::allocateTransients() {
+  std::vector<RenderGraphResource> transients;
+  for(RenderGraphResource i = 0; i < (RenderGraphResource)resources.size(); i++) {
+    Resource& resource = resources[i];
+    resource.memorySlot = U32_MAX;
+    if(!resource.isImage || resource.imported) { continue; }
+    resource.images[0] = VK_NULL_HANDLE;
+    resource.views[0] = VK_NULL_HANDLE;
+    if(resource.firstStep == U32_MAX) { continue; } // only used by culled passes
+    transients.push_back(i);
+  }
+  std::sort(transients.begin(), transients.end(), [&](RenderGraphResource a, RenderGraphResource b) {
+    return resources[a].firstStep < resources[b].firstStep;
+  });
+
+  for(RenderGraphResource transient: transients) {
+    Resource& resource = resources[transient];
+
+    bool tileOnly = true;
+    for(const Step& step: steps) {
+      if(step.group == U32_MAX) {
+        for(const Use& use: passes[step.pass].uses) {
+          if(use.resource == transient) { tileOnly = false; }
+        }
+        continue;
+      }
+      const Group& group = groups[step.group];
+      for(RenderGraphPass passIndex: group.passes) {
+        for(const Use& use: passes[passIndex].uses) {
+          if(use.resource == transient && !accessInfo(use.access).attachment) { tileOnly = false; }
+        }
+      }
+      u32 attachmentIndex = 0;
+      for(RenderGraphResource attachment: group.colorAttachments) {
+        if(attachment == transient && (group.loadOps[attachmentIndex] == VK_ATTACHMENT_LOAD_OP_LOAD || group.storeOps[attachmentIndex] == VK_ATTACHMENT_STORE_OP_STORE)) { tileOnly = false; }
+        attachmentIndex++;
+      }
+      if(group.depthAttachment == transient && (group.loadOps[attachmentIndex] == VK_ATTACHMENT_LOAD_OP_LOAD || group.storeOps[attachmentIndex] == VK_ATTACHMENT_STORE_OP_STORE)) { tileOnly = false; }
+    }
+    if(tileOnly) { resource.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT; }
+
+    VkImageCreateInfo imageInfo = vkinit::imageCreateInfo(resource.format, resource.usage, {resource.extent.width, resource.extent.height, 1});
+    VK_CHECK(vkCreateImage(device, &imageInfo, nullptr, &resource.images[0]));
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device, resource.images[0], &requirements);
+
+    for(u32 slotIndex = 0; slotIndex < (u32)memorySlots.size(); slotIndex++) {
+      MemorySlot& slot = memorySlots[slotIndex];
+      if(slot.lastStep >= resource.firstStep || slot.lazy != tileOnly) { continue; }
+      if((slot.requirements.memoryTypeBits & requirements.memoryTypeBits) == 0) { continue; }
+      slot.requirements.size = MAX(slot.requirements.size, requirements.size);
+      slot.requirements.alignment = MAX(slot.requirements.alignment, requirements.alignment);
+      slot.requirements.memoryTypeBits &= requirements.memoryTypeBits;
+      slot.lastStep = resource.lastStep;
+      resource.memorySlot = slotIndex;
+      break;
+    }
+    if(resource.memorySlot == U32_MAX) {
+      memorySlots.push_back({VK_NULL_HANDLE, requirements, resource.lastStep, tileOnly});
+      resource.memorySlot = (u32)memorySlots.size() - 1;
+    }
+  }
+
+  for(MemorySlot& slot: memorySlots) {
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    allocInfo.preferredFlags = slot.lazy ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0;
+    VK_CHECK(vmaAllocateMemory(vmaAllocator, &slot.requirements, &allocInfo, &slot.allocation, nullptr));
+    transientBytes += slot.requirements.size;
+  }
+
+  for(RenderGraphResource transient: transients) {
+    Resource& resource = resources[transient];
+    VK_CHECK(vmaBindImageMemory(vmaAllocator, memorySlots[resource.memorySlot].allocation, resource.images[0]));
+    VkImageViewCreateInfo viewInfo = vkinit::imageViewCreateInfo(resource.format, resource.images[0], resource.aspect);
+    VK_CHECK(vkCreateImageView(device, &viewInfo, nullptr, &resource.views[0]));
+  }
+}
+
+// Layout transitions all happen in barriers before the render pass, so attachments start and end in one layout
+void RenderGraph::createRenderPasses() {
+  for(Group& group: groups) {
+    std::vector<RenderGraphResource> attachments = group.colorAttachments;
+    if(group.depthAttachment != U32_MAX) { attachments.push_back(group.depthAttachment); }
+
+    std::vector<VkAttachmentDescription> descriptions(attachments.size());
+    std::vector<VkAttachmentReference> references(attachments.size());
+    u32 framebufferCount = 1;
+    for(u32 i = 0; i < (u32)attachments.size(); i++) {
+      const Resource& resource = resources[attachments[i]];
+      VkAttachmentDescription& description = descriptions[i];
+      description.flags = 0;
+      description.format = resource.format;
+      description.samples = VK_SAMPLE_COUNT_1_BIT;
+      description.loadOp = group.loadOps[i];
+      description.storeOp = group.storeOps[i];
+      description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+      description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+      description.initialLayout = group.layouts[i];
+      description.finalLayout = group.layouts[i];
+      references[i] = {i, group.layouts[i]};
+      framebufferCount = MAX(framebufferCount, resource.imported ? resource.imageCount : 1);
+    }
+
+    VkSubpassDescription subpass = {};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = (u32)group.colorAttachments.size();
+    subpass.pColorAttachments = references.data();
+    subpass.pDepthStencilAttachment = group.depthAttachment != U32_MAX ? &references.back() : nullptr;
+
+    VkRenderPassCreateInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.pNext = nullptr;
+    renderPassInfo.attachmentCount = (u32)descriptions.size();
+    renderPassInfo.pAttachments = descriptions.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    VK_CHECK(vkCreateRenderPass(device, &renderPassInfo, nullptr, &group.renderPass));
+
+    VkFramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.pNext = nullptr;
+    framebufferInfo.renderPass = group.renderPass;
+    framebufferInfo.attachmentCount = (u32)attachments.size();
+    framebufferInfo.width = group.extent.width;
+    framebufferInfo.height = group.extent.height;
+    framebufferInfo.layers = 1;
+
+    std::vector<VkImageView> views(attachments.size());
+    group.framebuffers.resize(framebufferCount);
+    for(u32 framebufferIndex = 0; framebufferIndex < framebufferCount; framebufferIndex++) {
+      for(u32 i = 0; i < (u32)attachments.size(); i++) {
+        views[i] = view(attachments[i], framebufferIndex);
+      }
+      framebufferInfo.pAttachments = views.data();
+      VK_CHECK(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &group.framebuffers[framebufferIndex]));
+    }
+  }
+}
+
+// Follows each resource's last accesses through the steps and emits a barrier wherever a step's use of it has to wait:
+// after any write, before any write that follows reads, and on every layout change
+void RenderGraph::buildBarriers() {
+  struct State {
+    VkPipelineStageFlags stage; // accesses since the last barrier, or before the frame
+    VkAccessFlags writeAccess;
+    VkImageLayout layout;
+  };
+  std::vector<State> states(resources.size());
+  for(u64 i = 0; i < resources.size(); i++) {
+    const Resource& resource = resources[i];
+    states[i] = {0, 0, VK_IMAGE_LAYOUT_UNDEFINED};
+    if(resource.isImage && resource.imported) {
+      states[i].stage = resource.readyStage;
+    }
+  }
+
+  // An aliased image's memory was last touched by whichever image last used its slot, possibly in the previous frame
+  for(u64 i = 0; i < resources.size(); i++) {
+    const Resource& resource = resources[i];
+    if(resource.memorySlot == U32_MAX) { continue; }
+    for(const Pass& pass: passes) {
+      if(pass.culled) { continue; }
+      for(const Use& use: pass.uses) {
+        if(resources[use.resource].memorySlot != resource.memorySlot) { continue; }
+        const RenderGraphAccessInfo& info = accessInfo(use.access);
+        states[i].stage |= info.stage;
+        states[i].writeAccess |= info.access & renderGraphWriteAccesses;
+      }
+    }
+  }
+
+  for(Step& step: steps) {
+    struct StepUse {
+      VkPipelineStageFlags stage;
+      VkAccessFlags access;
+      VkImageLayout layout;
+      bool write;
+    };
+    std::vector<StepUse> stepUses(resources.size(), StepUse{0, 0, VK_IMAGE_LAYOUT_UNDEFINED, false});
+    auto addUses = [&](const Pass& pass) {
+      for(const Use& use: pass.uses) {
+        const RenderGraphAccessInfo& info = accessInfo(use.access);
+        StepUse& stepUse = stepUses[use.resource];
+        if(stepUse.stage == 0) { stepUse.layout = info.layout; }
+        Assert(!resources[use.resource].isImage || stepUse.layout == info.layout)
+        stepUse.stage |= info.stage;
+        stepUse.access |= info.access;
+        stepUse.write |= info.write;
+      }
+    };
+    if(step.group == U32_MAX) {
+      addUses(passes[step.pass]);
+    } else {
+      for(RenderGraphPass passIndex: groups[step.group].passes) { addUses(passes[passIndex]); }
+    }
+
+    Barrier memoryBarrier = {U32_MAX, 0, 0, 0, 0, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED};
+    for(RenderGraphResource i = 0; i < (RenderGraphResource)resources.size(); i++) {
+      const StepUse& stepUse = stepUses[i];
+      if(stepUse.stage == 0) { continue; }
+      State& state = states[i];
+      bool isImage = resources[i].isImage;
+
+      bool layoutChange = isImage && state.layout != stepUse.layout;
+      bool afterWrite = state.writeAccess != 0;
+      bool writeAfterRead = stepUse.write && state.stage != 0;
+      if(!layoutChange && !afterWrite && !writeAfterRead) {
+        state.stage |= stepUse.stage; // reads after reads, a later write has to wait on all of them
+        continue;
+      }
+
+      VkPipelineStageFlags srcStage = state.stage != 0 ? state.stage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+      if(isImage) {
+        step.barriers.push_back({i, srcStage, stepUse.stage, state.writeAccess, stepUse.access, state.layout, stepUse.layout});
+      } else {
+        memoryBarrier.srcStage |= srcStage;
+        memoryBarrier.dstStage |= stepUse.stage;
+        memoryBarrier.srcAccess |= state.writeAccess;
+        memoryBarrier.dstAccess |= stepUse.access;
+      }
+      state.stage = stepUse.stage;
+      state.writeAccess = stepUse.write ? stepUse.access & renderGraphWriteAccesses : 0;
+      state.layout = stepUse.layout;
+    }
+    if(memoryBarrier.dstStage != 0) {
+      step.barriers.push_back(memoryBarrier);
+    }
+  }
+
+  for(RenderGraphResource i = 0; i < (RenderGraphResource)resources.size(); i++) {
+    const Resource& resource = resources[i];
+    if(!resource.isImage || !resource.imported || resource.firstStep == U32_MAX) { continue; }
+    const State& state = states[i];
+    finalBarriers.push_back({i, state.stage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, state.writeAccess, 0, state.layout, resource.finalLayout});
+  }
+}
+
+VkImage RenderGraph::image(RenderGraphResource resource, u32 importedImageIndex) const {
+  const Resource& r = resources[resource];
+  return r.imported ? r.images[importedImageIndex] : r.images[0];
+}
+
+VkImageView RenderGraph::view(RenderGraphResource resource, u32 importedImageIndex) const {
+  const Resource& r = resources[resource];
+  return r.imported ? r.views[importedImageIndex] : r.views[0];
+}
+
+// Everything before the step is recorded in one vkCmdPipelineBarrier, the stage masks are the union of all barriers'
+void RenderGraph::recordBarriers(VkCommandBuffer cmd, const std::vector<Barrier>& barriers, u32 importedImageIndex) {
+  if(barriers.empty()) { return; }
+
+  VkPipelineStageFlags srcStages = 0;
+  VkPipelineStageFlags dstStages = 0;
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.pNext = nullptr;
+  u32 memoryBarrierCount = 0;
+  VkImageMemoryBarrier imageBarriers[16];
+  u32 imageBarrierCount = 0;
+
+  for(const Barrier& barrier: barriers) {
+    srcStages |= barrier.srcStage;
+    dstStages |= barrier.dstStage;
+    if(barrier.resource == U32_MAX) {
+      memoryBarrier.srcAccessMask = barrier.srcAccess;
+      memoryBarrier.dstAccessMask = barrier.dstAccess;
+      memoryBarrierCount = 1;
+      continue;
+    }
+
+    Assert(imageBarrierCount < ArrayCount(imageBarriers))
+    VkImageMemoryBarrier& imageBarrier = imageBarriers[imageBarrierCount++];
+    imageBarrier = {};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.pNext = nullptr;
+    imageBarrier.srcAccessMask = barrier.srcAccess;
+    imageBarrier.dstAccessMask = barrier.dstAccess;
+    imageBarrier.oldLayout = barrier.oldLayout;
+    imageBarrier.newLayout = barrier.newLayout;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = image(barrier.resource, importedImageIndex);
+    imageBarrier.subresourceRange.aspectMask = resources[barrier.resource].aspect;
+    imageBarrier.subresourceRange.baseMipLevel = 0;
+    imageBarrier.subresourceRange.levelCount = 1;
+    imageBarrier.subresourceRange.baseArrayLayer = 0;
+    imageBarrier.subresourceRange.layerCount = 1;
+  }
+
+  vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0,
+                       memoryBarrierCount, &memoryBarrier,
+                       0, nullptr,
+                       imageBarrierCount, imageBarriers);
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd, u32 importedImageIndex) {
+  Assert(compiled)
+  for(const Step& step: steps) {
+    recordBarriers(cmd, step.barriers, importedImageIndex);
+
+    if(step.group == U32_MAX) {
+      passes[step.pass].record(cmd, nullptr);
+      continue;
+    }
+
+    const Group& group = groups[step.group];
+    VkFramebuffer framebuffer = group.framebuffers[group.framebuffers.size() > 1 ? importedImageIndex : 0];
+    VkRenderPassBeginInfo beginInfo = vkinit::renderPassBeginInfo(group.renderPass, group.extent, framebuffer);
+    beginInfo.clearValueCount = (u32)group.clearValues.size();
+    beginInfo.pClearValues = group.clearValues.data();
+    vkCmdBeginRenderPass(cmd, &beginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+    VkCommandBufferInheritanceInfo inheritance = vkinit::commandBufferInheritanceInfo(group.renderPass, 0, framebuffer);
+    for(RenderGraphPass passIndex: group.passes) {
+      passes[passIndex].record(cmd, &inheritance);
+    }
+    vkCmdEndRenderPass(cmd);
+  }
+  recordBarriers(cmd, finalBarriers, importedImageIndex);
+}
+
+VkRenderPass RenderGraph::renderPass(RenderGraphPass pass) const {
+  Assert(compiled && !passes[pass].culled && passes[pass].group != U32_MAX)
+  return groups[passes[pass].group].renderPass;
+}
+
+VkCommandBufferInheritanceInfo RenderGraph::inheritanceInfo(RenderGraphPass pass, u32 importedImageIndex) const {
+  Assert(compiled && !passes[pass].culled && passes[pass].group != U32_MAX)
+  const Group& group = groups[passes[pass].group];
+  VkFramebuffer framebuffer = group.framebuffers[group.framebuffers.size() > 1 ? importedImageIndex : 0];
+  return vkinit::commandBufferInheritanceInfo(group.renderPass, 0, framebuffer);
+}
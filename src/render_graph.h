@@ -0,0 +1,164 @@
+#pragma once
+
+#define RENDER_GRAPH_MAX_IMPORTED_IMAGES 8 // per imported image resource, one per swap chain image
+
+typedef u32 RenderGraphResource;
+typedef u32 RenderGraphPass;
+
+// How a pass touches a resource, this is all the graph needs to order passes against each other
+enum class RenderGraphAccess : u32 {
+  ColorAttachment, // read-modify-write unless a clear value is given
+  DepthAttachment, // depth tested and written, read-modify-write unless a clear value is given
+  DepthAttachmentRead, // depth tested only
+  FragmentSampled,
+  ComputeSampled,
+  ComputeStorageRead,
+  ComputeStorageWrite,
+  VertexStorageRead,
+  IndirectCommandRead,
+  Count
+};
+
+enum class RenderGraphPassType : u32 {
+  Raster, // recorded inside a render pass, into secondary command buffers
+  Compute, // recorded straight into the frame's command buffer, outside of any render pass
+};
+
+// inheritanceInfo is null for compute passes. Raster passes record secondary command buffers with it and execute
+// them into cmd, as the render pass is begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+typedef std::function<void(VkCommandBuffer cmd, const VkCommandBufferInheritanceInfo* inheritanceInfo)> RenderGraphRecordFunc;
+
+// A frame described as passes declaring what they read and write, compiled once and executed every frame.
+// From the declarations alone compile():
+// - culls passes whose writes never reach an imported image
+// - merges consecutive raster passes sharing attachments into one VkRenderPass
+// - picks load and store ops, an attachment is only stored when a later pass or the presentation engine reads it
+// - derives every layout transition and barrier, buffers are only ever ordered with global memory barriers
+// - lets transient images whose lifetimes don't overlap share memory, and asks for lazily allocated memory for
+//   attachments that never leave the tile
+// The declarations are kept until reset(), which the swap chain recreation goes through as extents change.
+class RenderGraph {
+public:
+  void init(VkDevice device, VmaAllocator vmaAllocator);
+  void reset(); // destroys everything compile() created and forgets every declaration
+
+  // Transient images are created, and aliased, by compile() and only live within a frame
+  RenderGraphResource createImage(const char* name, VkFormat format, VkExtent2D extent);
+  // execute() picks images[importedImageIndex]. Imported images start every frame with undefined contents, the frame's
+  // submission waits on readyStage before they may be touched, and they are left in finalLayout.
+  // Writes to imported images are the graph's outputs, the passes they depend on are the only ones kept.
+  RenderGraphResource importImage(const char* name, VkFormat format, VkExtent2D extent, const VkImage* images, const VkImageView* views, u32 imageCount,
+                                  VkPipelineStageFlags readyStage, VkImageLayout finalLayout);
+  RenderGraphResource importBuffer(const char* name);
+
+  RenderGraphPass addPass(const char* name, RenderGraphPassType type, RenderGraphRecordFunc&& record);
+  // clearValue only applies to attachment accesses, the attachment is cleared when the pass's render pass begins
+  void use(RenderGraphPass pass, RenderGraphResource resource, RenderGraphAccess access, const VkClearValue* clearValue = nullptr);
+
+  void compile();
+  void execute(VkCommandBuffer cmd, u32 importedImageIndex);
+
+  // Valid after compile() for raster passes that weren't culled. Passes merged into one render pass share it.
+  VkRenderPass renderPass(RenderGraphPass pass) const;
+  VkCommandBufferInheritanceInfo inheritanceInfo(RenderGraphPass pass, u32 importedImageIndex) const;
+  bool culled(RenderGraphPass pass) const { return passes[pass].culled; }
+
+  u32 renderPassCount() const { return (u32)groups.size(); }
+  u64 transientMemoryBytes() const { return transientBytes; }
+
+private:
+  struct Resource {
+    const char* name;
+    bool isImage;
+    bool imported;
+    VkFormat format;
+    VkExtent2D extent;
+    VkImageAspectFlags aspect;
+    u32 imageCount;
+    VkImage images[RENDER_GRAPH_MAX_IMPORTED_IMAGES];
+    VkImageView views[RENDER_GRAPH_MAX_IMPORTED_IMAGES];
+    VkPipelineStageFlags readyStage;
+    VkImageLayout finalLayout;
+
+    // filled in by compile(), for transient images
+    VkImageUsageFlags usage;
+    u32 firstStep, lastStep;
+    u32 memorySlot;
+  };
+
+  struct Use {
+    RenderGraphResource resource;
+    RenderGraphAccess access;
+    bool clear;
+    VkClearValue clearValue;
+  };
+
+  struct Pass {
+    const char* name;
+    RenderGraphPassType type;
+    RenderGraphRecordFunc record;
+    std::vector<Use> uses;
+    bool culled;
+    u32 group; // index into groups for raster passes
+  };
+
+  // One VkRenderPass, with a single subpass every merged pass records into in order
+  struct Group {
+    std::vector<RenderGraphPass> passes;
+    std::vector<RenderGraphResource> colorAttachments;
+    RenderGraphResource depthAttachment; // U32_MAX when there is none
+    VkExtent2D extent;
+    // per attachment, colors first and depth last
+    std::vector<VkAttachmentLoadOp> loadOps;
+    std::vector<VkAttachmentStoreOp> storeOps;
+    std::vector<VkImageLayout> layouts;
+    VkRenderPass renderPass;
+    std::vector<VkFramebuffer> framebuffers; // one per imported image when an attachment is imported, one otherwise
+    std::vector<VkClearValue> clearValues;
+  };
+
+  struct Barrier {
+    RenderGraphResource resource; // U32_MAX for a global memory barrier
+    VkPipelineStageFlags srcStage, dstStage;
+    VkAccessFlags srcAccess, dstAccess;
+    VkImageLayout oldLayout, newLayout;
+  };
+
+  // A compute pass or a group of raster passes, with the barriers recorded before it
+  struct Step {
+    RenderGraphPass pass; // compute passes only
+    u32 group; // U32_MAX for compute passes
+    std::vector<Barrier> barriers;
+  };
+
+  struct MemorySlot {
+    VmaAllocation allocation;
+    VkMemoryRequirements requirements;
+    u32 lastStep; // of the latest image placed in the slot
+    bool lazy; // every image in the slot is a transient attachment
+  };
+
+  void cullPasses();
+  void buildSteps();
+  bool canJoinGroup(const Group& group, const Pass& pass) const;
+  void chooseAttachmentOps();
+  void allocateTransients();
+  void buildBarriers();
+  void createRenderPasses();
+  void recordBarriers(VkCommandBuffer cmd, const std::vector<Barrier>& barriers, u32 importedImageIndex);
+  VkImage image(RenderGraphResource resource, u32 importedImageIndex) const;
+  VkImageView view(RenderGraphResource resource, u32 importedImageIndex) const;
+
+  VkDevice device;
+  VmaAllocator vmaAllocator;
+
+  std::vector<Resource> resources;
+  std::vector<Pass> passes;
+
+  std::vector<Group> groups;
+  std::vector<Step> steps;
+  std::vector<Barrier> finalBarriers; // imported images into their final layouts
+  std::vector<MemorySlot> memorySlots; // back every transient image, images[0] and views[0] of their resources
+  u64 transientBytes = 0;
+  bool compiled = false;
+};
@@ -0,0 +1,312 @@
+#include "test.h"
+
+#include <atomic>
+#include <cstdio>
+
+#include "asset_loader.h"
+#include "asset_io.h"
+#include "material_asset.h"
+#include "mesh_asset.h"
+#include "prefab_asset.h"
+#include "texture_asset.h"
+
+#define TEST_ASSET_FILE "assetlib_test_asset.bin"
+
+class AssetLibTest : public testing::Test {
+protected:
+  assets::AssetFile assetFile;
+
+  void SetUp() override {
+    assetFile = {};
+    memcpy(assetFile.type, "TEST", FILE_TYPE_SIZE_IN_BYTES);
+    assetFile.version = ASSET_LIB_VERSION;
+    assetFile.json = "{\"test\":true}";
+    assetFile.binaryBlob.resize(3'000'000);
+    for(u64 i = 0; i < assetFile.binaryBlob.size(); i++) {
+      assetFile.binaryBlob[i] = (char)(i * 31);
+    }
+    assets::saveAssetFile(TEST_ASSET_FILE, assetFile);
+  }
+
+  void TearDown() override {
+    remove(TEST_ASSET_FILE);
+  }
+
+  bool matchesTestAsset(const assets::AssetFile& file) {
+    return memcmp(file.type, assetFile.type, FILE_TYPE_SIZE_IN_BYTES) == 0 &&
+           file.version == assetFile.version &&
+           file.json == assetFile.json &&
+           file.binaryBlob == assetFile.binaryBlob;
+  }
+
+  void readManyAssetFiles(bool allowIoUring) {
+    assets::AsyncAssetReader assetReader;
+    ASSERT_TRUE(assetReader.init(0, 8, allowIoUring));
+
+    const u32 readCount = 64; // more reads than the queue depth
+    std::atomic<u32> matchCount = 0;
+    for(u32 i = 0; i < readCount; i++) {
+      assetReader.readAssetFile(TEST_ASSET_FILE, [this, &matchCount](bool success, assets::AssetFile& file) {
+        if(success && matchesTestAsset(file)) { matchCount++; }
+      });
+    }
+    std::future<u64> blobSize = assetReader.readAssetFile<u64>(TEST_ASSET_FILE, [](bool, assets::AssetFile& file) {
+      return (u64)file.binaryBlob.size();
+    });
+    std::future<std::vector<char>> missingFile = assetReader.readFile("assetlib_test_missing_file.bin");
+
+    assetReader.waitIdle();
+    ASSERT_EQ(matchCount, readCount);
+    ASSERT_EQ(blobSize.get(), assetFile.binaryBlob.size());
+    ASSERT_TRUE(missingFile.get().empty());
+
+    assetReader.shutdown();
+  }
+};
+
+TEST_F(AssetLibTest, ParseMatchesLoad) {
+  std::vector<char> fileBytes;
+  FILE* file = fopen(TEST_ASSET_FILE, "rb");
+  ASSERT_NE(file, nullptr);
+  fseek(file, 0, SEEK_END);
+  fileBytes.resize(ftell(file));
+  fseek(file, 0, SEEK_SET);
+  fread(fileBytes.data(), 1, fileBytes.size(), file);
+  fclose(file);
+
+  assets::AssetFile parsedFile{};
+  ASSERT_TRUE(assets::parseAssetFile(fileBytes.data(), fileBytes.size(), &parsedFile));
+  ASSERT_TRUE(matchesTestAsset(parsedFile));
+
+  // truncated files are rejected instead of read past the end
+  assets::AssetFile truncatedFile{};
+  ASSERT_FALSE(assets::parseAssetFile(fileBytes.data(), fileBytes.size() - 1, &truncatedFile));
+}
+
+TEST_F(AssetLibTest, AsyncReadThreadPool) {
+  readManyAssetFiles(false);
+}
+
+// falls back to the thread pool where io_uring is unavailable
+TEST_F(AssetLibTest, AsyncReadPreferIoUring) {
+  readManyAssetFiles(true);
+}
+
+TEST(PrefabTest, SortedWorldMatrices) {
+  // child listed before its parent, root at the end
+  assets::PrefabInfo prefabInfo;
+  prefabInfo.nodeParents = {2, 0, PREFAB_ROOT_NODE};
+  prefabInfo.nodeMatrices = {noop::translate_mat4({0.0f, 1.0f, 0.0f}), noop::translate_mat4({0.0f, 0.0f, 1.0f}), noop::translate_mat4({1.0f, 0.0f, 0.0f})};
+  prefabInfo.nodeMeshes = {PREFAB_NO_MESH, 0, PREFAB_NO_MESH};
+  prefabInfo.nodeNames = {"middle", "leaf", "root"};
+  ASSERT_TRUE(assets::sortPrefabNodes(&prefabInfo));
+
+  ASSERT_EQ(prefabInfo.nodeNames, std::vector<std::string>({"root", "middle", "leaf"}));
+  ASSERT_EQ(prefabInfo.nodeParents, std::vector<s32>({PREFAB_ROOT_NODE, 0, 1}));
+  ASSERT_EQ(prefabInfo.nodeMeshes, std::vector<s32>({PREFAB_NO_MESH, PREFAB_NO_MESH, 0}));
+
+  noop::mat4 worldMatrices[3];
+  noop::mat4 rootTransform = noop::translate_mat4({0.0f, 0.0f, 10.0f});
+  assets::computeWorldMatrices(prefabInfo.nodeParents.data(), prefabInfo.nodeMatrices.data(), prefabInfo.nodeCount(), rootTransform, worldMatrices);
+  for(u32 i = 0; i < 3; i++) {
+    s32 parent = prefabInfo.nodeParents[i];
+    noop::mat4 expected = (parent == PREFAB_ROOT_NODE ? rootTransform : worldMatrices[parent]) * prefabInfo.nodeMatrices[i];
+    for(u32 j = 0; j < 16; j++) {
+      ASSERT_FLOAT_EQ(worldMatrices[i].val[j], expected.val[j]);
+    }
+  }
+  ASSERT_FLOAT_EQ(worldMatrices[2].val2d[3][0], 1.0f);
+  ASSERT_FLOAT_EQ(worldMatrices[2].val2d[3][1], 1.0f);
+  ASSERT_FLOAT_EQ(worldMatrices[2].val2d[3][2], 11.0f);
+
+  // cycles are rejected
+  prefabInfo.nodeParents = {1, 0, PREFAB_ROOT_NODE};
+  ASSERT_FALSE(assets::sortPrefabNodes(&prefabInfo));
+}
+
+TEST(PrefabTest, RejectsInvalidIndices) {
+  assets::PrefabInfo prefabInfo;
+  prefabInfo.nodeParents = {PREFAB_ROOT_NODE, 0};
+  prefabInfo.nodeMatrices = {noop::translate_mat4({1.0f, 0.0f, 0.0f}), noop::translate_mat4({0.0f, 1.0f, 0.0f})};
+  prefabInfo.nodeMeshes = {PREFAB_NO_MESH, 0};
+  prefabInfo.nodeNames = {"root", "leaf"};
+  prefabInfo.meshes.push_back({"material", "mesh"});
+
+  assets::AssetFile prefabFile = assets::packPrefab(prefabInfo);
+  assets::PrefabInfo readInfo = assets::readPrefabInfo(&prefabFile);
+  ASSERT_EQ(readInfo.nodeCount(), 2u);
+  ASSERT_EQ(readInfo.nodeMeshes, prefabInfo.nodeMeshes);
+
+  prefabInfo.nodeMeshes = {PREFAB_NO_MESH, 1};
+  prefabFile = assets::packPrefab(prefabInfo);
+  ASSERT_EQ(assets::readPrefabInfo(&prefabFile).nodeCount(), 0u);
+
+  prefabInfo.nodeMeshes = {-2, 0};
+  prefabFile = assets::packPrefab(prefabInfo);
+  ASSERT_EQ(assets::readPrefabInfo(&prefabFile).nodeCount(), 0u);
+
+  // unsorted, the child comes first
+  prefabInfo.nodeMeshes = {PREFAB_NO_MESH, 0};
+  prefabInfo.nodeParents = {1, PREFAB_ROOT_NODE};
+  prefabFile = assets::packPrefab(prefabInfo);
+  ASSERT_EQ(assets::readPrefabInfo(&prefabFile).nodeCount(), 0u);
+}
+
+TEST(MaterialTest, ResolveTextureIndices) {
+  assets::MaterialInfo materialInfo;
+  materialInfo.baseEffect = "defaultPBR";
+  materialInfo.record = assets::defaultMaterialRecord();
+  materialInfo.record.roughnessFactor = 0.25f;
+  materialInfo.textureNames[(u32)assets::MaterialTextureSlot::BaseColor] = "brick_albedo";
+  materialInfo.textureNames[(u32)assets::MaterialTextureSlot::Normals] = "brick_normal";
+  materialInfo.textureNames[(u32)assets::MaterialTextureSlot::Emissive] = "never_baked";
+
+  std::vector<std::string> sortedTextureNames = {"brick_albedo", "brick_normal", "single_white_pixel"};
+  ASSERT_FALSE(assets::resolveMaterialTextures(&materialInfo, sortedTextureNames));
+
+  assets::AssetFile materialFile = assets::packMaterial(&materialInfo);
+  assets::MaterialRecord record;
+  ASSERT_TRUE(assets::readMaterialRecord(materialFile, &record));
+  ASSERT_EQ(record.textureIndices[(u32)assets::MaterialTextureSlot::BaseColor], 0u);
+  ASSERT_EQ(record.textureIndices[(u32)assets::MaterialTextureSlot::Normals], 1u);
+  ASSERT_EQ(record.textureIndices[(u32)assets::MaterialTextureSlot::MetallicRoughness], MATERIAL_NO_TEXTURE);
+  ASSERT_EQ(record.textureIndices[(u32)assets::MaterialTextureSlot::Emissive], MATERIAL_NO_TEXTURE);
+  ASSERT_FLOAT_EQ(record.roughnessFactor, 0.25f);
+
+  // names survive packing so indices can be re-resolved against a later texture table
+  assets::MaterialInfo readInfo = assets::readMaterialInfo(&materialFile);
+  ASSERT_EQ(readInfo.textureNames[(u32)assets::MaterialTextureSlot::Normals], "brick_normal");
+  sortedTextureNames.insert(sortedTextureNames.begin(), "aaa_new_texture");
+  ASSERT_FALSE(assets::resolveMaterialTextures(&readInfo, sortedTextureNames));
+  ASSERT_EQ(readInfo.record.textureIndices[(u32)assets::MaterialTextureSlot::Normals], 2u);
+}
+
+TEST(TextureTest, TiledRegionsMatchFullUnpack) {
+  // not a multiple of the tile size so edge tiles are partial
+  assets::TextureInfo textureInfo{};
+  textureInfo.textureFormat = assets::TextureFormat::RGBA8;
+  textureInfo.width = TEXTURE_TILE_SIZE * 2 + 37;
+  textureInfo.height = TEXTURE_TILE_SIZE + 5;
+  textureInfo.mipCount = assets::textureFullMipCount(textureInfo.width, textureInfo.height);
+  textureInfo.textureSize = assets::textureMipOffset(textureInfo, textureInfo.mipCount);
+  ASSERT_EQ(textureInfo.mipCount, 9u);
+
+  std::vector<char> pixels(textureInfo.textureSize);
+  for(u64 i = 0; i < pixels.size(); i++) {
+    pixels[i] = (i % 7 == 0) ? (char)(i * 13) : (char)(i / 1024); // partially compressible
+  }
+  assets::AssetFile textureFile = assets::packTexture(&textureInfo, pixels.data());
+
+  assets::TextureInfo readInfo{};
+  assets::readTextureInfo(textureFile, &readInfo);
+  ASSERT_EQ(readInfo.tileSize, (u32)TEXTURE_TILE_SIZE);
+  ASSERT_EQ(readInfo.mipCount, textureInfo.mipCount);
+
+  std::vector<char> unpacked(readInfo.textureSize);
+  assets::unpackTexture(readInfo, textureFile.binaryBlob.data(), textureFile.binaryBlob.size(), unpacked.data());
+  ASSERT_EQ(unpacked, pixels);
+
+  // region straddling four tiles of mip 0, then a region of mip 1
+  u32 regionMips[] = {0, 1};
+  assets::TextureRegion regions[] = {{TEXTURE_TILE_SIZE - 10, TEXTURE_TILE_SIZE - 3, 150, 8}, {3, 1, 60, 40}};
+  for(u32 i = 0; i < ArrayCount(regions); i++) {
+    const assets::TextureRegion& region = regions[i];
+    u32 mipWidth = assets::textureMipWidth(readInfo, regionMips[i]);
+    const char* mipPixels = pixels.data() + assets::textureMipOffset(readInfo, regionMips[i]);
+    std::vector<char> regionPixels((u64)region.width * region.height * 4);
+    ASSERT_TRUE(assets::unpackTextureRegion(readInfo, regionMips[i], region, textureFile.binaryBlob.data(), textureFile.binaryBlob.size(), regionPixels.data()));
+    for(u32 row = 0; row < region.height; row++) {
+      ASSERT_EQ(memcmp(regionPixels.data() + (u64)row * region.width * 4, mipPixels + ((u64)(region.y + row) * mipWidth + region.x) * 4, (u64)region.width * 4), 0);
+    }
+  }
+
+  assets::TextureRegion outsideRegion = {0, 0, readInfo.width + 1, 1};
+  std::vector<char> unused((u64)outsideRegion.width * 4);
+  ASSERT_FALSE(assets::unpackTextureRegion(readInfo, 0, outsideRegion, textureFile.binaryBlob.data(), textureFile.binaryBlob.size(), unused.data()));
+}
+
+TEST(MeshTest, StreamingUnpackMatchesSource) {
+  std::vector<assets::Vertex_PNCV_f32> vertices(20'000);
+  for(u32 i = 0; i < vertices.size(); i++) {
+    vertices[i] = {{(f32)i, (f32)(i % 17), 1.0f}, {0.0f, 0.0f, 1.0f}, {0.5f, 0.5f, (f32)(i % 3)}, {(f32)i / 7.0f, 0.0f}};
+  }
+  std::vector<u32> indices(30'001);
+  for(u32 i = 0; i < indices.size(); i++) {
+    indices[i] = (i * 7919) % vertices.size();
+  }
+
+  assets::MeshInfo meshInfo{};
+  meshInfo.vertexFormat = assets::VertexFormat::PNCV_F32;
+  meshInfo.vertexBufferSize = vertices.size() * sizeof(assets::Vertex_PNCV_f32);
+  meshInfo.indexBufferSize = indices.size() * sizeof(u32);
+  meshInfo.indexSize = sizeof(u32);
+  meshInfo.originalFile = "generated";
+  assets::AssetFile meshFile = assets::packMesh(meshInfo, (char*)vertices.data(), (char*)indices.data());
+
+  assets::MeshInfo readInfo{};
+  assets::readMeshInfo(meshFile, &readInfo);
+  ASSERT_EQ(readInfo.streamChunkSize, (u32)MESH_STREAM_CHUNK_SIZE);
+
+  u64 expectedOffset = 0;
+  ASSERT_TRUE(assets::unpackMeshStreaming(readInfo, meshFile.binaryBlob.data(), meshFile.binaryBlob.size(), [&](u64 offset, const char*, u64 size) {
+    EXPECT_EQ(offset, expectedOffset);
+    EXPECT_LE(size, (u64)MESH_STREAM_CHUNK_SIZE);
+    expectedOffset += size;
+    return true;
+  }));
+  ASSERT_EQ(expectedOffset, readInfo.vertexBufferSize + readInfo.indexBufferSize);
+
+  std::vector<assets::Vertex_PNCV_f32> unpackedVertices(vertices.size());
+  std::vector<u32> unpackedIndices(indices.size());
+  assets::unpackMesh(readInfo, meshFile.binaryBlob.data(), meshFile.binaryBlob.size(), (char*)unpackedVertices.data(), (char*)unpackedIndices.data());
+  ASSERT_EQ(memcmp(unpackedVertices.data(), vertices.data(), readInfo.vertexBufferSize), 0);
+  ASSERT_EQ(unpackedIndices, indices);
+
+  // meshes baked before streaming are a single LZ4 block
+  std::vector<char> merged(readInfo.vertexBufferSize + readInfo.indexBufferSize);
+  memcpy(merged.data(), vertices.data(), readInfo.vertexBufferSize);
+  memcpy(merged.data() + readInfo.vertexBufferSize, indices.data(), readInfo.indexBufferSize);
+  std::vector<char> singleBlock(LZ4_compressBound((s32)merged.size()));
+  singleBlock.resize(LZ4_compress_default(merged.data(), singleBlock.data(), (s32)merged.size(), (s32)singleBlock.size()));
+  readInfo.streamChunkSize = 0;
+  std::fill(unpackedIndices.begin(), unpackedIndices.end(), 0);
+  assets::unpackMesh(readInfo, singleBlock.data(), singleBlock.size(), (char*)unpackedVertices.data(), (char*)unpackedIndices.data());
+  ASSERT_EQ(unpackedIndices, indices);
+
+  // truncated streams fail instead of reading past the end
+  readInfo.streamChunkSize = MESH_STREAM_CHUNK_SIZE;
+  ASSERT_FALSE(assets::unpackMeshStreaming(readInfo, meshFile.binaryBlob.data(), meshFile.binaryBlob.size() / 2, [](u64, const char*, u64) {
+    return true;
+  }));
+
+  // filtered chunks hold whole vertices and indices, and the filters must undo exactly
+  meshInfo.filterMask = assets::meshFilterBit(assets::MeshFilter::Deinterleave) | assets::meshFilterBit(assets::MeshFilter::ByteShuffle) | assets::meshFilterBit(assets::MeshFilter::IndexDelta);
+  assets::AssetFile filteredFile = assets::packMesh(meshInfo, (char*)vertices.data(), (char*)indices.data());
+  assets::MeshInfo filteredInfo{};
+  assets::readMeshInfo(filteredFile, &filteredInfo);
+  ASSERT_EQ(filteredInfo.filterMask, meshInfo.filterMask);
+  ASSERT_LT(filteredFile.binaryBlob.size(), meshFile.binaryBlob.size());
+  ASSERT_TRUE(assets::unpackMeshStreaming(filteredInfo, filteredFile.binaryBlob.data(), filteredFile.binaryBlob.size(), [&](u64 offset, const char*, u64 size) {
+    if(offset < filteredInfo.vertexBufferSize) {
+      EXPECT_EQ(size % sizeof(assets::Vertex_PNCV_f32), 0u);
+      EXPECT_LE(offset + size, filteredInfo.vertexBufferSize);
+    }
+    return true;
+  }));
+  std::fill(unpackedVertices.begin(), unpackedVertices.end(), assets::Vertex_PNCV_f32{});
+  std::fill(unpackedIndices.begin(), unpackedIndices.end(), 0);
+  assets::unpackMesh(filteredInfo, filteredFile.binaryBlob.data(), filteredFile.binaryBlob.size(), (char*)unpackedVertices.data(), (char*)unpackedIndices.data());
+  ASSERT_EQ(memcmp(unpackedVertices.data(), vertices.data(), filteredInfo.vertexBufferSize), 0);
+  ASSERT_EQ(unpackedIndices, indices);
+
+  // index filters are dropped for 16 bit indices
+  std::vector<u16> shortIndices(indices.begin(), indices.end());
+  meshInfo.indexSize = sizeof(u16);
+  meshInfo.indexBufferSize = shortIndices.size() * sizeof(u16);
+  filteredFile = assets::packMesh(meshInfo, (char*)vertices.data(), (char*)shortIndices.data());
+  assets::readMeshInfo(filteredFile, &filteredInfo);
+  ASSERT_EQ(filteredInfo.filterMask & assets::meshFilterBit(assets::MeshFilter::IndexDelta), 0u);
+  std::vector<u16> unpackedShortIndices(shortIndices.size());
+  assets::unpackMesh(filteredInfo, filteredFile.binaryBlob.data(), filteredFile.binaryBlob.size(), (char*)unpackedVertices.data(), (char*)unpackedShortIndices.data());
+  ASSERT_EQ(unpackedShortIndices, shortIndices);
+}
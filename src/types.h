@@ -24,6 +24,7 @@ typedef size_t memory_index;
 #define Tau32 6.28318530717958647692f
 #define RadiansPerDegree (Pi32 / 180.0f)
 #define U32_MAX ~0u
+#define U64_MAX ~0ull
 
 #define ArrayCount(Array) (sizeof(Array) / sizeof((Array)[0]))
 
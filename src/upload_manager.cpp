@@ -0,0 +1,287 @@
+#define UPLOAD_STAGING_ALIGNMENT 16 // covers the texel sizes of every format uploaded and common optimalBufferCopyOffsetAlignment values
+
+void UploadManager::init(VkDevice device, VmaAllocator vmaAllocator, VkQueue graphicsQueue, u32 graphicsQueueFamily, VkQueue transferQueue, u32 transferQueueFamily) {
+  this->device = device;
+  this->vmaAllocator = vmaAllocator;
+  this->graphicsQueue = graphicsQueue;
+  this->graphicsQueueFamily = graphicsQueueFamily;
+  this->transferQueue = transferQueue;
+  this->transferQueueFamily = transferQueueFamily;
+  ownershipTransfers = transferQueueFamily != graphicsQueueFamily;
+
+  VkSemaphoreTypeCreateInfo timelineCreateInfo = {};
+  timelineCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+  timelineCreateInfo.pNext = nullptr;
+  timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+  timelineCreateInfo.initialValue = 0;
+  VkSemaphoreCreateInfo semaphoreCreateInfo = vkinit::semaphoreCreateInfo();
+  semaphoreCreateInfo.pNext = &timelineCreateInfo;
+  VK_CHECK(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &semaphore));
+
+  // CPU_ONLY memory is host coherent, writes to the ring never need flushing
+  stagingBuffer = vkutil::createBuffer(vmaAllocator, UPLOAD_STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, 0, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+  stagingData = (char*)stagingBuffer.mappedData;
+
+  for(Submission& submission: submissions) {
+    submission = {};
+    VkCommandPoolCreateInfo transferPoolInfo = vkinit::commandPoolCreateInfo(transferQueueFamily, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+    VK_CHECK(vkCreateCommandPool(device, &transferPoolInfo, nullptr, &submission.transferCommandPool));
+    VkCommandBufferAllocateInfo transferAllocInfo = vkinit::commandBufferAllocateInfo(submission.transferCommandPool, 1);
+    VK_CHECK(vkAllocateCommandBuffers(device, &transferAllocInfo, &submission.transferCommandBuffer));
+
+    if(ownershipTransfers) {
+      VkCommandPoolCreateInfo graphicsPoolInfo = vkinit::commandPoolCreateInfo(graphicsQueueFamily, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+      VK_CHECK(vkCreateCommandPool(device, &graphicsPoolInfo, nullptr, &submission.graphicsCommandPool));
+      VkCommandBufferAllocateInfo graphicsAllocInfo = vkinit::commandBufferAllocateInfo(submission.graphicsCommandPool, 1);
+      VK_CHECK(vkAllocateCommandBuffers(device, &graphicsAllocInfo, &submission.graphicsCommandBuffer));
+    }
+  }
+}
+
+void UploadManager::destroy() {
+  flush();
+  wait(lastSubmittedValue);
+  retireSubmissions(false);
+
+  for(Submission& submission: submissions) {
+    vkDestroyCommandPool(device, submission.transferCommandPool, nullptr);
+    if(submission.graphicsCommandPool != VK_NULL_HANDLE) {
+      vkDestroyCommandPool(device, submission.graphicsCommandPool, nullptr);
+    }
+  }
+  vmaDestroyBuffer(vmaAllocator, stagingBuffer.vkBuffer, stagingBuffer.vmaAllocation);
+  vkDestroySemaphore(device, semaphore, nullptr);
+}
+
+void UploadManager::uploadBuffer(VkBuffer dstBuffer, u64 dstOffset, const void* data, u64 size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+  // buffers larger than the ring are copied through it a piece at a time
+  u64 copied = 0;
+  while(copied < size) {
+    u64 chunkSize = MIN(size - copied, UPLOAD_STAGING_RING_SIZE);
+    u64 stagingOffset = allocateStaging(chunkSize);
+    memcpy(stagingData + stagingOffset, (const char*)data + copied, chunkSize);
+
+    VkBufferCopy copy;
+    copy.srcOffset = stagingOffset;
+    copy.dstOffset = dstOffset + copied;
+    copy.size = chunkSize;
+    vkCmdCopyBuffer(recordingCommandBuffer(), stagingBuffer.vkBuffer, dstBuffer, 1, &copy);
+    copied += chunkSize;
+  }
+
+  VkCommandBuffer cmd = recordingCommandBuffer();
+  VkBufferMemoryBarrier barrier = vkinit::bufferMemoryBarrier(dstBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, dstAccess);
+  barrier.offset = dstOffset;
+  barrier.size = size;
+  if(ownershipTransfers) {
+    // the release half, its destination access is ignored and performed by the matching acquire instead
+    barrier.dstAccessMask = 0;
+    barrier.srcQueueFamilyIndex = transferQueueFamily;
+    barrier.dstQueueFamilyIndex = graphicsQueueFamily;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = dstAccess;
+    bufferAcquires.push_back(barrier);
+    acquireStages |= dstStage;
+  } else {
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+  }
+}
+
+void UploadManager::uploadImage(VkImage dstImage, u32 mipLevels, const void* data, u64 size, const VkBufferImageCopy* regions, u32 regionCount, VkPipelineStageFlags dstStage) {
+  VkBuffer stagingSrc = stagingBuffer.vkBuffer;
+  u64 stagingOffset = 0;
+  if(size <= UPLOAD_STAGING_RING_SIZE) {
+    stagingOffset = allocateStaging(size);
+    memcpy(stagingData + stagingOffset, data, size);
+  } else {
+    // a single region can't be split across ring wraps, so the whole image gets a staging buffer of its own
+    AllocatedBuffer dedicated = vkutil::createBuffer(vmaAllocator, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, 0, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    memcpy(dedicated.mappedData, data, size);
+    stagingSrc = dedicated.vkBuffer;
+    recordingCommandBuffer();
+    submissions[(oldestSubmission + inFlightCount) % UPLOAD_SUBMISSION_COUNT].dedicatedStaging.push_back(dedicated);
+  }
+  VkCommandBuffer cmd = recordingCommandBuffer();
+
+  VkImageMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.pNext = nullptr;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED; // previous contents are discarded
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = dstImage;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = mipLevels;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+  imageCopies.assign(regions, regions + regionCount);
+  for(VkBufferImageCopy& copy: imageCopies) {
+    copy.bufferOffset += stagingOffset;
+  }
+  vkCmdCopyBufferToImage(cmd, stagingSrc, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regionCount, imageCopies.data());
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  if(ownershipTransfers) {
+    // the layout transition has to be identical in the release and the acquire
+    barrier.dstAccessMask = 0;
+    barrier.srcQueueFamilyIndex = transferQueueFamily;
+    barrier.dstQueueFamilyIndex = graphicsQueueFamily;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    imageAcquires.push_back(barrier);
+    acquireStages |= dstStage;
+  } else {
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+  }
+}
+
+u64 UploadManager::flush() {
+  if(!recording) { return lastSubmittedValue; }
+
+  Submission& submission = submissions[(oldestSubmission + inFlightCount) % UPLOAD_SUBMISSION_COUNT];
+  VK_CHECK(vkEndCommandBuffer(submission.transferCommandBuffer));
+  submission.timelineValue = nextTimelineValue++;
+  // Both queues signal the one semaphore, so the copies wait for the previous acquire to keep values increasing in
+  // submission order. Without the wait a later copy could signal past an acquire that hasn't run yet.
+  u64 previousAcquireValue = ownershipTransfers ? lastSubmittedValue : 0;
+  submit(transferQueue, submission.transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, previousAcquireValue, submission.timelineValue);
+
+  if(ownershipTransfers) {
+    VkCommandBuffer acquireCmd = submission.graphicsCommandBuffer;
+    VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    VK_CHECK(vkBeginCommandBuffer(acquireCmd, &beginInfo));
+    vkCmdPipelineBarrier(acquireCmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, acquireStages, 0,
+                         0, nullptr,
+                         (u32)bufferAcquires.size(), bufferAcquires.data(),
+                         (u32)imageAcquires.size(), imageAcquires.data());
+    VK_CHECK(vkEndCommandBuffer(acquireCmd));
+
+    // the whole acquire waits for the copies, the graphics queue never sees the data before it owns it
+    u64 transferValue = submission.timelineValue;
+    submission.timelineValue = nextTimelineValue++;
+    submit(graphicsQueue, acquireCmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, transferValue, submission.timelineValue);
+
+    bufferAcquires.clear();
+    imageAcquires.clear();
+    acquireStages = 0;
+  }
+
+  submission.stagingEnd = stagingHead;
+  lastSubmittedValue = submission.timelineValue;
+  inFlightCount++;
+  recording = false;
+  return lastSubmittedValue;
+}
+
+bool UploadManager::isComplete(u64 uploadValue) {
+  u64 completedValue;
+  VK_CHECK(vkGetSemaphoreCounterValue(device, semaphore, &completedValue));
+  return completedValue >= uploadValue;
+}
+
+void UploadManager::wait(u64 uploadValue) {
+  VkSemaphoreWaitInfo waitInfo = {};
+  waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+  waitInfo.pNext = nullptr;
+  waitInfo.semaphoreCount = 1;
+  waitInfo.pSemaphores = &semaphore;
+  waitInfo.pValues = &uploadValue;
+  VK_CHECK(vkWaitSemaphores(device, &waitInfo, U64_MAX));
+}
+
+u64 UploadManager::allocateStaging(u64 size) {
+  Assert(size <= UPLOAD_STAGING_RING_SIZE)
+  u64 start = (stagingHead + UPLOAD_STAGING_ALIGNMENT - 1) & ~(u64)(UPLOAD_STAGING_ALIGNMENT - 1);
+  // an allocation never wraps around the end of the ring, whatever is left at the end is skipped instead
+  u64 ringOffset = start % UPLOAD_STAGING_RING_SIZE;
+  if(ringOffset + size > UPLOAD_STAGING_RING_SIZE) {
+    start += UPLOAD_STAGING_RING_SIZE - ringOffset;
+  }
+
+  retireSubmissions(false);
+  while(start + size - stagingTail > UPLOAD_STAGING_RING_SIZE) {
+    if(inFlightCount > 0) {
+      retireSubmissions(true);
+    } else if(recording) {
+      // the copies recorded so far are what holds the ring, they have to be submitted before they can be waited on
+      flush();
+    } else {
+      // nothing reads from the ring anymore, including whatever was skipped to get to start
+      stagingTail = start;
+    }
+  }
+
+  stagingHead = start + size;
+  return start % UPLOAD_STAGING_RING_SIZE;
+}
+
+VkCommandBuffer UploadManager::recordingCommandBuffer() {
+  if(!recording) {
+    if(inFlightCount == UPLOAD_SUBMISSION_COUNT) {
+      retireSubmissions(true);
+    }
+
+    Submission& submission = submissions[(oldestSubmission + inFlightCount) % UPLOAD_SUBMISSION_COUNT];
+    VK_CHECK(vkResetCommandPool(device, submission.transferCommandPool, 0));
+    if(ownershipTransfers) {
+      VK_CHECK(vkResetCommandPool(device, submission.graphicsCommandPool, 0));
+    }
+    VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    VK_CHECK(vkBeginCommandBuffer(submission.transferCommandBuffer, &beginInfo));
+    recording = true;
+  }
+  return submissions[(oldestSubmission + inFlightCount) % UPLOAD_SUBMISSION_COUNT].transferCommandBuffer;
+}
+
+void UploadManager::retireSubmissions(bool waitForOldest) {
+  if(waitForOldest && inFlightCount > 0) {
+    wait(submissions[oldestSubmission].timelineValue);
+  }
+
+  u64 completedValue;
+  VK_CHECK(vkGetSemaphoreCounterValue(device, semaphore, &completedValue));
+  while(inFlightCount > 0 && submissions[oldestSubmission].timelineValue <= completedValue) {
+    stagingTail = submissions[oldestSubmission].stagingEnd;
+    for(AllocatedBuffer& dedicated: submissions[oldestSubmission].dedicatedStaging) {
+      vmaDestroyBuffer(vmaAllocator, dedicated.vkBuffer, dedicated.vmaAllocation);
+    }
+    submissions[oldestSubmission].dedicatedStaging.clear();
+    oldestSubmission = (oldestSubmission + 1) % UPLOAD_SUBMISSION_COUNT;
+    inFlightCount--;
+  }
+}
+
+void UploadManager::submit(VkQueue queue, VkCommandBuffer cmd, VkPipelineStageFlags waitStage, u64 waitValue, u64 signalValue) {
+  VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineInfo.pNext = nullptr;
+  timelineInfo.signalSemaphoreValueCount = 1;
+  timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+  VkSubmitInfo submitInfo = vkinit::submitInfo(&cmd);
+  submitInfo.pNext = &timelineInfo;
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores = &semaphore;
+  if(waitValue != 0) {
+    timelineInfo.waitSemaphoreValueCount = 1;
+    timelineInfo.pWaitSemaphoreValues = &waitValue;
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = &semaphore;
+    submitInfo.pWaitDstStageMask = &waitStage;
+  }
+
+  VK_CHECK(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE));
+}
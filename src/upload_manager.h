@@ -0,0 +1,77 @@
+#pragma once
+
+#define UPLOAD_STAGING_RING_SIZE (64ull * 1024 * 1024)
+#define UPLOAD_SUBMISSION_COUNT 4 // batches that can be in flight before recording another one waits on the oldest
+
+// Moves data into device local buffers and images through a single persistently mapped staging ring.
+// Copies are recorded as they are requested and submitted together by flush(), on a dedicated transfer queue when the
+// device has one, in which case ownership of every destination is released to and acquired by the graphics queue.
+// Each submission signals a timeline semaphore value rather than a fence. With ownership transfers each transfer submission
+// waits on the previous acquire, so values are signaled in order across both queues. Callers keep the value and either poll it
+// with isComplete() or have a queue submission wait on it, nothing in here blocks unless the staging ring is full.
+class UploadManager {
+public:
+  void init(VkDevice device, VmaAllocator vmaAllocator, VkQueue graphicsQueue, u32 graphicsQueueFamily, VkQueue transferQueue, u32 transferQueueFamily);
+  void destroy();
+
+  // dstStage and dstAccess describe the first use of the data on the graphics queue
+  void uploadBuffer(VkBuffer dstBuffer, u64 dstOffset, const void* data, u64 size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+  // Every mip of the image is written from data, the regions' bufferOffsets are relative to data
+  // The image ends up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL. Images larger than the staging ring are staged
+  // through a buffer of their own, freed once the upload completes.
+  void uploadImage(VkImage dstImage, u32 mipLevels, const void* data, u64 size, const VkBufferImageCopy* regions, u32 regionCount, VkPipelineStageFlags dstStage);
+
+  // Submits everything recorded since the last flush, returns the timeline value signaled once it is all on the graphics queue
+  u64 flush();
+  bool isComplete(u64 uploadValue);
+  void wait(u64 uploadValue);
+
+  VkSemaphore timelineSemaphore() const { return semaphore; }
+  u64 submittedValue() const { return lastSubmittedValue; } // covers every upload flushed so far
+
+private:
+  struct Submission {
+    VkCommandPool transferCommandPool;
+    VkCommandBuffer transferCommandBuffer;
+    VkCommandPool graphicsCommandPool; // only used to acquire ownership on a separate transfer queue
+    VkCommandBuffer graphicsCommandBuffer;
+    u64 timelineValue;
+    u64 stagingEnd; // staging ring position up to which this submission reads
+    std::vector<AllocatedBuffer> dedicatedStaging; // for uploads too large for the ring, destroyed when the submission retires
+  };
+
+  u64 allocateStaging(u64 size); // size must not exceed UPLOAD_STAGING_RING_SIZE
+  VkCommandBuffer recordingCommandBuffer();
+  void retireSubmissions(bool waitForOldest);
+  void submit(VkQueue queue, VkCommandBuffer cmd, VkPipelineStageFlags waitStage, u64 waitValue, u64 signalValue);
+
+  VkDevice device;
+  VmaAllocator vmaAllocator;
+  VkQueue graphicsQueue;
+  VkQueue transferQueue;
+  u32 graphicsQueueFamily;
+  u32 transferQueueFamily;
+  bool ownershipTransfers; // the transfer queue belongs to a different family than the graphics queue
+
+  VkSemaphore semaphore;
+  u64 nextTimelineValue = 1;
+  u64 lastSubmittedValue = 0;
+
+  AllocatedBuffer stagingBuffer;
+  char* stagingData;
+  // positions only ever increase, the offset into the ring is the position modulo UPLOAD_STAGING_RING_SIZE
+  u64 stagingHead = 0; // next free byte
+  u64 stagingTail = 0; // oldest byte still read by a submission
+
+  Submission submissions[UPLOAD_SUBMISSION_COUNT];
+  u32 oldestSubmission = 0;
+  u32 inFlightCount = 0;
+  bool recording = false; // the submission after the in flight ones has commands recorded into it
+
+  // ownership acquires recorded on the graphics queue when the recording submission is flushed
+  std::vector<VkBufferMemoryBarrier> bufferAcquires;
+  std::vector<VkImageMemoryBarrier> imageAcquires;
+  VkPipelineStageFlags acquireStages = 0;
+
+  std::vector<VkBufferImageCopy> imageCopies; // scratch space for uploadImage()
+};
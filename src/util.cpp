@@ -1,11 +1,11 @@
 void StartTimer(Timer& timer) {
-  timer.prev = std::chrono::high_resolution_clock::now();
+  timer.prev = std::chrono::steady_clock::now();
   timer.delta = 0.0;
 }
 
 f64 StopTimer(Timer& timer) {
   std::chrono::steady_clock::time_point prevPrev = timer.prev;
-  timer.prev = std::chrono::high_resolution_clock::now();
+  timer.prev = std::chrono::steady_clock::now();
   std::chrono::duration<double, std::milli> dur = timer.prev - prevPrev;
   timer.delta = dur.count();
   return timer.delta;
@@ -35,11 +35,12 @@ bool readFile(const char* filePath, std::vector<char>& fileBytes) {
 }
 
 void writeFile(const char* filePath, const std::string& fileBytes) {
+  writeFile(filePath, fileBytes.data(), fileBytes.size());
+}
+
+void writeFile(const char* filePath, const char* fileBytes, u64 fileSize) {
   std::ofstream outfile;
   outfile.open(filePath, std::ios::binary | std::ios::out);
-
-  u32 fileLength = static_cast<u32>(fileBytes.size());
-  outfile.write(fileBytes.data(), fileLength);
-
+  outfile.write(fileBytes, fileSize);
   outfile.close();
 }
\ No newline at end of file
@@ -5,4 +5,5 @@ struct Timer {
 void StartTimer(Timer& timer);
 f64 StopTimer(Timer& timer);
 bool readFile(const char* filePath, std::vector<char>& fileBytes);
-void writeFile(const char* filePath, const std::string& fileBytes);
\ No newline at end of file
+void writeFile(const char* filePath, const std::string& fileBytes);
+void writeFile(const char* filePath, const char* fileBytes, u64 fileSize);
\ No newline at end of file
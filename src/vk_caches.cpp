@@ -0,0 +1,225 @@
+size_t CacheKeyHash::operator()(const CacheKey& key) const {
+  u64 hash = 14695981039346656037ull;
+  for(u32 word: key.words) {
+    hash = (hash ^ word) * 1099511628211ull;
+  }
+  return (size_t)hash;
+}
+
+void DescriptorSetLayoutCache::init(VkDevice device) {
+  this->device = device;
+}
+
+void DescriptorSetLayoutCache::destroy() {
+  for(std::pair<const CacheKey, VkDescriptorSetLayout>& pair: layouts) {
+    vkDestroyDescriptorSetLayout(device, pair.second, nullptr);
+  }
+  layouts.clear();
+}
+
+VkDescriptorSetLayout DescriptorSetLayoutCache::getLayout(const DescriptorSetLayoutData& layoutData, VkDescriptorSetLayoutCreateFlags flags, const VkDescriptorBindingFlags* bindingFlags) {
+  u32 bindingCount = (u32)layoutData.bindings.size();
+
+  // bindings are keyed in binding number order, whatever order they were listed in
+  std::vector<u32> bindingOrder(bindingCount);
+  for(u32 i = 0; i < bindingCount; i++) { bindingOrder[i] = i; }
+  std::sort(bindingOrder.begin(), bindingOrder.end(), [&](u32 a, u32 b) {
+    return layoutData.bindings[a].binding < layoutData.bindings[b].binding;
+  });
+
+  CacheKey key;
+  key.add(flags);
+  key.add(bindingCount);
+  for(u32 i: bindingOrder) {
+    const VkDescriptorSetLayoutBinding& binding = layoutData.bindings[i];
+    Assert(binding.pImmutableSamplers == nullptr) // immutable samplers would have to be keyed by value
+    key.add(binding.binding);
+    key.add((u32)binding.descriptorType);
+    key.add(binding.descriptorCount);
+    key.add(binding.stageFlags);
+    key.add(bindingFlags != nullptr ? bindingFlags[i] : 0u);
+  }
+
+  auto it = layouts.find(key);
+  if(it != layouts.end()) { return it->second; }
+
+  std::vector<VkDescriptorSetLayoutBinding> sortedBindings;
+  std::vector<VkDescriptorBindingFlags> sortedBindingFlags;
+  for(u32 i: bindingOrder) {
+    sortedBindings.push_back(layoutData.bindings[i]);
+    if(bindingFlags != nullptr) { sortedBindingFlags.push_back(bindingFlags[i]); }
+  }
+
+  VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+  bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+  bindingFlagsInfo.pNext = nullptr;
+  bindingFlagsInfo.bindingCount = bindingCount;
+  bindingFlagsInfo.pBindingFlags = sortedBindingFlags.data();
+
+  VkDescriptorSetLayoutCreateInfo setLayoutInfo = {};
+  setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutInfo.pNext = bindingFlags != nullptr ? &bindingFlagsInfo : nullptr;
+  setLayoutInfo.flags = flags;
+  setLayoutInfo.bindingCount = bindingCount;
+  setLayoutInfo.pBindings = sortedBindings.data();
+
+  VkDescriptorSetLayout setLayout;
+  VK_CHECK(vkCreateDescriptorSetLayout(device, &setLayoutInfo, nullptr, &setLayout));
+  layouts.emplace(std::move(key), setLayout);
+  return setLayout;
+}
+
+void PipelineLayoutCache::init(VkDevice device) {
+  this->device = device;
+}
+
+void PipelineLayoutCache::destroy() {
+  for(std::pair<const CacheKey, VkPipelineLayout>& pair: layouts) {
+    vkDestroyPipelineLayout(device, pair.second, nullptr);
+  }
+  layouts.clear();
+}
+
+VkPipelineLayout PipelineLayoutCache::getLayout(const VkDescriptorSetLayout* setLayouts, u32 setLayoutCount, const std::vector<VkPushConstantRange>& pushConstantRanges) {
+  // ranges are keyed in offset order, see MaterialManager::mergePushConstantRangeData
+  std::vector<VkPushConstantRange> sortedRanges = pushConstantRanges;
+  std::sort(sortedRanges.begin(), sortedRanges.end(), [](const VkPushConstantRange& a, const VkPushConstantRange& b) {
+    return a.offset < b.offset;
+  });
+
+  // set layouts come out of the DescriptorSetLayoutCache, so equal handles mean equal layouts
+  CacheKey key;
+  key.add(setLayoutCount);
+  for(u32 i = 0; i < setLayoutCount; i++) {
+    key.addHandle(setLayouts[i]);
+  }
+  key.add((u32)sortedRanges.size());
+  for(const VkPushConstantRange& range: sortedRanges) {
+    key.add(range.stageFlags);
+    key.add(range.offset);
+    key.add(range.size);
+  }
+
+  auto it = layouts.find(key);
+  if(it != layouts.end()) { return it->second; }
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo = vkinit::pipelineLayoutCreateInfo();
+  pipelineLayoutInfo.setLayoutCount = setLayoutCount;
+  pipelineLayoutInfo.pSetLayouts = setLayouts;
+  pipelineLayoutInfo.pushConstantRangeCount = (u32)sortedRanges.size();
+  pipelineLayoutInfo.pPushConstantRanges = sortedRanges.data();
+
+  VkPipelineLayout pipelineLayout;
+  VK_CHECK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout));
+  layouts.emplace(std::move(key), pipelineLayout);
+  return pipelineLayout;
+}
+
+void PipelineStateCache::init(VkDevice device, VkPipelineCache pipelineCache) {
+  this->device = device;
+  this->pipelineCache = pipelineCache;
+}
+
+void PipelineStateCache::clear() {
+  for(std::pair<const CacheKey, VkPipeline>& pair: pipelines) {
+    vkDestroyPipeline(device, pair.second, nullptr);
+  }
+  pipelines.clear();
+}
+
+// Everything PipelineBuilder::buildPipeline() reads, any state it hard codes is the same for every pipeline
+internal_access void addPipelineBuilderState(CacheKey& key, const PipelineBuilder& builder, VkRenderPass pass) {
+  key.addHandle(pass);
+  key.addHandle(builder.pipelineLayout);
+
+  key.add((u32)builder.shaderStages.size());
+  for(const VkPipelineShaderStageCreateInfo& stage: builder.shaderStages) {
+    Assert(stage.pSpecializationInfo == nullptr) // specialization constants would have to be keyed by value
+    key.add((u32)stage.stage);
+    key.addHandle(stage.module);
+    for(const char* c = stage.pName; *c != '\0'; c++) { key.add((u32)*c); }
+    key.add(0u);
+  }
+
+  const VkPipelineVertexInputStateCreateInfo& vertexInput = builder.vertexInputInfo;
+  key.add(vertexInput.vertexBindingDescriptionCount);
+  for(u32 i = 0; i < vertexInput.vertexBindingDescriptionCount; i++) {
+    const VkVertexInputBindingDescription& binding = vertexInput.pVertexBindingDescriptions[i];
+    key.add(binding.binding);
+    key.add(binding.stride);
+    key.add((u32)binding.inputRate);
+  }
+  key.add(vertexInput.vertexAttributeDescriptionCount);
+  for(u32 i = 0; i < vertexInput.vertexAttributeDescriptionCount; i++) {
+    const VkVertexInputAttributeDescription& attribute = vertexInput.pVertexAttributeDescriptions[i];
+    key.add(attribute.location);
+    key.add(attribute.binding);
+    key.add((u32)attribute.format);
+    key.add(attribute.offset);
+  }
+
+  key.add((u32)builder.inputAssembly.topology);
+  key.add(builder.inputAssembly.primitiveRestartEnable);
+
+  const VkPipelineRasterizationStateCreateInfo& rasterizer = builder.rasterizer;
+  key.add(rasterizer.depthClampEnable);
+  key.add(rasterizer.rasterizerDiscardEnable);
+  key.add((u32)rasterizer.polygonMode);
+  key.add(rasterizer.cullMode);
+  key.add((u32)rasterizer.frontFace);
+  key.add(rasterizer.depthBiasEnable);
+  key.add(rasterizer.depthBiasConstantFactor);
+  key.add(rasterizer.depthBiasClamp);
+  key.add(rasterizer.depthBiasSlopeFactor);
+  key.add(rasterizer.lineWidth);
+
+  const VkPipelineColorBlendAttachmentState& blend = builder.colorBlendAttachment;
+  key.add(blend.blendEnable);
+  key.add((u32)blend.srcColorBlendFactor);
+  key.add((u32)blend.dstColorBlendFactor);
+  key.add((u32)blend.colorBlendOp);
+  key.add((u32)blend.srcAlphaBlendFactor);
+  key.add((u32)blend.dstAlphaBlendFactor);
+  key.add((u32)blend.alphaBlendOp);
+  key.add(blend.colorWriteMask);
+
+  const VkPipelineMultisampleStateCreateInfo& multisampling = builder.multisampling;
+  Assert(multisampling.pSampleMask == nullptr)
+  key.add((u32)multisampling.rasterizationSamples);
+  key.add(multisampling.sampleShadingEnable);
+  key.add(multisampling.minSampleShading);
+  key.add(multisampling.alphaToCoverageEnable);
+  key.add(multisampling.alphaToOneEnable);
+
+  const VkPipelineDepthStencilStateCreateInfo& depthStencil = builder.depthStencil;
+  key.add(depthStencil.depthTestEnable);
+  key.add(depthStencil.depthWriteEnable);
+  key.add((u32)depthStencil.depthCompareOp);
+  key.add(depthStencil.depthBoundsTestEnable);
+  key.add(depthStencil.stencilTestEnable);
+  for(const VkStencilOpState* stencil: {&depthStencil.front, &depthStencil.back}) {
+    key.add((u32)stencil->failOp);
+    key.add((u32)stencil->passOp);
+    key.add((u32)stencil->depthFailOp);
+    key.add((u32)stencil->compareOp);
+    key.add(stencil->compareMask);
+    key.add(stencil->writeMask);
+    key.add(stencil->reference);
+  }
+  key.add(depthStencil.minDepthBounds);
+  key.add(depthStencil.maxDepthBounds);
+}
+
+VkPipeline PipelineStateCache::getPipeline(const PipelineBuilder& builder, VkRenderPass pass) {
+  CacheKey key;
+  addPipelineBuilderState(key, builder, pass);
+
+  auto it = pipelines.find(key);
+  if(it != pipelines.end()) { return it->second; }
+
+  VkPipeline pipeline = builder.buildPipeline(device, pass, pipelineCache);
+  if(pipeline != VK_NULL_HANDLE) {
+    pipelines.emplace(std::move(key), pipeline);
+  }
+  return pipeline;
+}
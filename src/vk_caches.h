@@ -0,0 +1,68 @@
+#pragma once
+
+// A Vulkan object's description flattened into words, two keys are equal exactly when they describe identical objects
+// Handles are added by value, so a key naming another cached object only matches while that object is alive
+struct CacheKey {
+  std::vector<u32> words;
+
+  void add(u32 value) { words.push_back(value); }
+  void add(u64 value) { words.push_back((u32)value); words.push_back((u32)(value >> 32)); }
+  void add(f32 value) { u32 bits; memcpy(&bits, &value, sizeof(bits)); words.push_back(bits); }
+  template<typename VkHandle>
+  void addHandle(VkHandle handle) { add((u64)handle); }
+
+  bool operator==(const CacheKey& other) const { return words == other.words; }
+};
+
+struct CacheKeyHash {
+  size_t operator()(const CacheKey& key) const; // FNV-1a over the words
+};
+
+// Set layouts are shared by every pipeline layout built from identical bindings, and pipeline layouts built from
+// identical set layouts are compatible, so descriptor sets stay bound when switching between their pipelines
+class DescriptorSetLayoutCache {
+public:
+  void init(VkDevice device);
+  void destroy();
+
+  // The set index of layoutData isn't part of the layout, identical bindings at different set indices share one
+  // bindingFlags is null or holds one entry per binding, in the order of layoutData.bindings
+  VkDescriptorSetLayout getLayout(const DescriptorSetLayoutData& layoutData, VkDescriptorSetLayoutCreateFlags flags = 0, const VkDescriptorBindingFlags* bindingFlags = nullptr);
+  u32 count() const { return (u32)layouts.size(); }
+
+private:
+  VkDevice device;
+  std::unordered_map<CacheKey, VkDescriptorSetLayout, CacheKeyHash> layouts;
+};
+
+class PipelineLayoutCache {
+public:
+  void init(VkDevice device);
+  void destroy();
+
+  // setLayouts are indexed by set number
+  VkPipelineLayout getLayout(const VkDescriptorSetLayout* setLayouts, u32 setLayoutCount, const std::vector<VkPushConstantRange>& pushConstantRanges);
+  u32 count() const { return (u32)layouts.size(); }
+
+private:
+  VkDevice device;
+  std::unordered_map<CacheKey, VkPipelineLayout, CacheKeyHash> layouts;
+};
+
+// Every material asking for the same shaders and fixed function state gets the same pipeline, so the draws of
+// different materials no longer rebind identical state
+class PipelineStateCache {
+public:
+  void init(VkDevice device, VkPipelineCache pipelineCache);
+  // Destroys every pipeline, which has to happen before the render pass they were built for is destroyed
+  void clear();
+
+  // VK_NULL_HANDLE if creation failed, failures aren't cached
+  VkPipeline getPipeline(const PipelineBuilder& builder, VkRenderPass pass);
+  u32 count() const { return (u32)pipelines.size(); }
+
+private:
+  VkDevice device;
+  VkPipelineCache pipelineCache; // driver side cache compiled pipelines are looked up in, see vkutil::loadPipelineCache
+  std::unordered_map<CacheKey, VkPipeline, CacheKeyHash> pipelines;
+};
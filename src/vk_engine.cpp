@@ -5,8 +5,19 @@
 
 #define PRESENT_MODE VK_PRESENT_MODE_FIFO_KHR
 
+#define IMGUI_MAX_TEXTURES 16 // font atlas included
+
+#define PIPELINE_CACHE_FILE "pipeline_cache.bin"
+
 #define MAX_OBJECTS 100'000
 
+#define MIN_DRAWS_PER_RECORDING_THREAD 256 // fewer draws aren't worth the cost of another secondary command buffer
+#define MESH_RESIDENCY_BUDGET (64ull * 1024 * 1024) // upper bound on the geometry arena, VMA's heap budget can lower it
+#define GEOMETRY_ARENA_INDICES_PER_VERTEX 4 // how the arena's bytes are split between its vertex and index buffers
+
+#define CULL_WORKGROUP_SIZE 256 // must match local_size_x in cull_objects.comp
+#define COMPACT_DRAWS_WORKGROUP_SIZE 256 // must match local_size_x in compact_draws.comp
+
 const VkClearValue colorClearValue{
         {0.1f, 0.1f, 0.1f, 1.0f}
 };
@@ -19,6 +30,9 @@ void VulkanEngine::init() {
   // needed for SDL to counteract the scaling Windows can do for windows
   SetProcessDPIAware();
 
+  // started first so that disk reads overlap window and Vulkan initialization
+  initAssetIO();
+
   initSDL();
 
   initCamera();
@@ -26,14 +40,18 @@ void VulkanEngine::init() {
   initVulkan();
   initSwapchain();
   initCommands();
-  initDefaultRenderpass();
-  initFramebuffers();
+  initRenderGraph();
   initSyncStructures();
   initDescriptors();
   initPipelines();
+  initComputePipelines();
   loadImages();
+  loadMaterials();
   loadMeshes();
+  loadPrefabs();
   initScene();
+  // everything uploaded so far is drawn without checking whether its upload is complete, frames wait for it on the GPU
+  startupUploadValue = uploadManager.submittedValue();
 
   initImgui();
 
@@ -42,18 +60,13 @@ void VulkanEngine::init() {
 
 void VulkanEngine::cleanup() {
   VK_CHECK(vkDeviceWaitIdle(device));
+  recordingWorkers.shutdown();
 
   if(isInitialized) {
     cleanupSwapChain();
+    destroyPipelines();
     mainDeletionQueue.flush();
 
-    for(std::pair<std::string, Texture> pair: loadedTextures) {
-      const Texture& texture = pair.second;
-      vkDestroyImageView(device, texture.imageView, nullptr);
-      vmaDestroyImage(vmaAllocator, texture.image.vkImage, texture.image.vmaAllocation);
-    }
-    loadedTextures.clear();
-
     vmaDestroyAllocator(vmaAllocator);
     materialManager.destroyAll(device);
 
@@ -63,12 +76,53 @@ void VulkanEngine::cleanup() {
     vkDestroyInstance(instance, nullptr);
     SDL_DestroyWindow(window);
   }
+
+  assetReader.shutdown();
+}
+
+void VulkanEngine::initAssetIO() {
+  assetReader.init();
+  std::cout << "Asset I/O backend: " << assetReader.backendName() << std::endl;
+
+  materialManager.prefetchShaderFile(assetReader, SHADER_DIR"hard_coded_fullscreen_quad.vert.spv");
+  materialManager.prefetchShaderFile(assetReader, SHADER_DIR"fragment_shader_test.frag.spv");
+  for(u32 i = 0; i < ArrayCount(materialInfos); i++) {
+    materialManager.prefetchShaderFile(assetReader, materialInfos[i].vertFileName);
+    materialManager.prefetchShaderFile(assetReader, materialInfos[i].fragFileName);
+  }
+
+  // Only a read ahead hint, the actual reads are issued in loadImages()
+  // Meshes are streamed in as they are first drawn, prefetching them would read the whole library up front again
+  BakedAssetData* bakedTextures = (BakedAssetData*)(&bakedTextureAssetData);
+  u32 textureCount = bakedTextureAssetCount();
+  for(u32 i = 0; i < textureCount; i++) {
+    assetReader.prefetch(bakedTextures[i].filePath);
+  }
 }
 
 void VulkanEngine::draw() {
   FrameData& frame = getCurrentFrame();
   VK_CHECK(vkWaitForFences(device, 1, &frame.renderFence, true, DEFAULT_NANOSEC_TIMEOUT));
   VK_CHECK(vkResetFences(device, 1, &frame.renderFence));
+  frame.transientDescriptors.reset();
+
+  // meshes of batches the GPU found visible the last time this frame was culled count as used now
+  if(!frame.readbackBatchMeshes.empty()) {
+    u32 batchCount = (u32)frame.readbackBatchMeshes.size();
+    vmaInvalidateAllocation(vmaAllocator, frame.drawCommandReadbackBuffer.vmaAllocation, 0, batchCount * sizeof(VkDrawIndexedIndirectCommand));
+    const VkDrawIndexedIndirectCommand* culledCommands = (const VkDrawIndexedIndirectCommand*)frame.drawCommandReadbackBuffer.mappedData;
+    for(u32 batchIndex = 0; batchIndex < batchCount; batchIndex++) {
+      if(culledCommands[batchIndex].instanceCount > 0) { meshStreamer.request(frame.readbackBatchMeshes[batchIndex], frameNumber); }
+    }
+    frame.readbackBatchMeshes.clear();
+  }
+
+  // every frame FRAME_OVERLAP frames back has finished, ranges of meshes evicted back then can be reused
+  if(meshStreamer.update(frameNumber)) {
+    renderables.version++; // draw batches point at placeholders or evicted meshes
+  }
+  quickDebugText("Mesh streaming: %d resident (%.2f MB), %d loading", meshStreamer.residentCount(), meshStreamer.residentBytes() / (1024.0 * 1024.0), meshStreamer.loadsInFlight());
+  quickDebugText("Render graph: %d render passes, %.2f MB of transient images", renderGraph.renderPassCount(), renderGraph.transientMemoryBytes() / (1024.0 * 1024.0));
 
   // present semaphore is signaled when the presentation engine has finished using the image and
   // it may now be used as a target for drawing
@@ -86,35 +140,48 @@ void VulkanEngine::draw() {
   VkCommandBufferBeginInfo cmdBeginInfo = vkinit::commandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
   VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
-  {
-    VkClearValue clearValues[] = {colorClearValue, depthClearValue};
 
-    VkRenderPassBeginInfo rpInfo = vkinit::renderPassBeginInfo(renderPass, windowExtent, framebuffers[swapchainImageIndex]);
-    rpInfo.clearValueCount = 2;
-    rpInfo.pClearValues = clearValues; // Clear values for each attachment
+  // Raster passes are recorded into secondary command buffers up front, the render graph executes them within
+  // its render passes and records the cull pass, and every barrier and layout transition between them, into cmd
+  VkCommandBufferInheritanceInfo backgroundInheritance = renderGraph.inheritanceInfo(backgroundPass, swapchainImageIndex);
+  VkCommandBufferBeginInfo backgroundBeginInfo = vkinit::commandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &backgroundInheritance);
+  VK_CHECK(vkBeginCommandBuffer(frame.backgroundCommandBuffer, &backgroundBeginInfo));
+  drawFragmentShader(frame.backgroundCommandBuffer);
+  VK_CHECK(vkEndCommandBuffer(frame.backgroundCommandBuffer));
 
-    // binds the framebuffers, clears the color & depth images and puts the image in the layout specified in the renderpass
-    vkCmdBeginRenderPass(cmd, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
+  VkCommandBufferInheritanceInfo objectsInheritance = renderGraph.inheritanceInfo(objectsPass, swapchainImageIndex);
+  objectCommandBufferCount = drawObjects(objectsInheritance, renderables, objectCommandBuffers);
 
-    drawFragmentShader(cmd);
-    drawObjects(cmd, renderables.data(), (u32)renderables.size());
-    renderImgui(cmd);
+  VkCommandBufferInheritanceInfo imguiInheritance = renderGraph.inheritanceInfo(imguiPass, swapchainImageIndex);
+  VkCommandBufferBeginInfo imguiBeginInfo = vkinit::commandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &imguiInheritance);
+  VK_CHECK(vkBeginCommandBuffer(frame.imguiCommandBuffer, &imguiBeginInfo));
+  renderImgui(frame.imguiCommandBuffer);
+  VK_CHECK(vkEndCommandBuffer(frame.imguiCommandBuffer));
 
-    // finishes render and transitions image to layout specified in renderpass
-    vkCmdEndRenderPass(cmd);
-  }
+  renderGraph.execute(cmd, swapchainImageIndex);
   VK_CHECK(vkEndCommandBuffer(cmd));
 
   VkSubmitInfo submitInfo = {};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
   submitInfo.pNext = nullptr;
 
-  VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-
-  submitInfo.pWaitDstStageMask = &waitStage;
   //we want to wait on the presentSemaphore, as that semaphore is signaled when the swapchain is ready
-  submitInfo.waitSemaphoreCount = 1;
-  submitInfo.pWaitSemaphores = &frame.presentSemaphore;
+  //and on the startup uploads, which only holds up the first frames. Streaming uploads aren't waited on, the meshes they
+  //fill are only drawn once the streamer has seen them complete
+  VkSemaphore waitSemaphores[] = {frame.presentSemaphore, uploadManager.timelineSemaphore()};
+  VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT};
+  u64 waitValues[] = {0 /*binary semaphore, ignored*/, startupUploadValue};
+
+  VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineInfo.pNext = nullptr;
+  timelineInfo.waitSemaphoreValueCount = ArrayCount(waitValues);
+  timelineInfo.pWaitSemaphoreValues = waitValues;
+  submitInfo.pNext = &timelineInfo;
+
+  submitInfo.pWaitDstStageMask = waitStages;
+  submitInfo.waitSemaphoreCount = ArrayCount(waitSemaphores);
+  submitInfo.pWaitSemaphores = waitSemaphores;
   //we will signal the renderSemaphore, to signal that rendering has finished
   submitInfo.signalSemaphoreCount = 1;
   submitInfo.pSignalSemaphores = &frame.renderSemaphore;
@@ -205,6 +272,12 @@ void VulkanEngine::quickDebugText(const char* fmt, ...) const {
   }
 }
 
+void VulkanEngine::quickDebugCheckbox(const char* label, bool* v) const {
+  if(imguiState.showQuickDebug) {
+    ImGui::Checkbox(label, v);
+  }
+}
+
 void VulkanEngine::quickDebugFloat(const char* label, float* v, float v_min, float v_max, const char* format, ImGuiSliderFlags flags) const {
   if(imguiState.showQuickDebug) {
     ImGui::SliderFloat(label, v, v_min, v_max, format, flags);
@@ -351,26 +424,17 @@ void VulkanEngine::initImgui() {
   imguiWindow.FrameSemaphores = nullptr;
 
   // Create Descriptor Pool
+  // ImGui's Vulkan backend only allocates combined image sampler sets, one for the font atlas and one per texture handed to it
   VkDescriptorPool imguiDescriptorPool;
   {
     VkDescriptorPoolSize poolSizes[] =
             {
-                    {VK_DESCRIPTOR_TYPE_SAMPLER,                1000},
-                    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000},
-                    {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,          1000},
-                    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          1000},
-                    {VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER,   1000},
-                    {VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,   1000},
-                    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         1000},
-                    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         1000},
-                    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1000},
-                    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1000},
-                    {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,       1000}
+                    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, IMGUI_MAX_TEXTURES},
             };
     VkDescriptorPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-    poolInfo.maxSets = 1000 * IM_ARRAYSIZE(poolSizes);
+    poolInfo.maxSets = IMGUI_MAX_TEXTURES;
     poolInfo.poolSizeCount = (uint32_t)IM_ARRAYSIZE(poolSizes);
     poolInfo.pPoolSizes = poolSizes;
     VK_CHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &imguiDescriptorPool));
@@ -383,7 +447,7 @@ void VulkanEngine::initImgui() {
   initInfo.Device = device;
   initInfo.QueueFamily = graphicsQueueFamily;
   initInfo.Queue = graphicsQueue;
-  initInfo.PipelineCache = VK_NULL_HANDLE;
+  initInfo.PipelineCache = pipelineCache;
   initInfo.DescriptorPool = imguiDescriptorPool;
   initInfo.MinImageCount = 3;
   initInfo.ImageCount = (u32)swapchainImageViews.size();
@@ -430,7 +494,7 @@ void VulkanEngine::initVulkan() {
   vkb::Instance vkbInst = builder
           .set_app_name("Example Vulkan Application")
           .request_validation_layers(true)
-          .require_api_version(1, 1, 0)
+          .require_api_version(1, 2, 0)
           .use_default_debug_messenger()
           //.enable_extension("VK_KHR_Maintenance1") // needed for Vulkan versions <1.1 when using negative viewport valuesto perform y-inversion of the clip space
           .build()
@@ -441,21 +505,85 @@ void VulkanEngine::initVulkan() {
 
   SDL_Vulkan_CreateSurface(window, instance, &surface);
 
-//  VkPhysicalDeviceFeatures physicalDeviceFeatures{};
+  VkPhysicalDeviceFeatures physicalDeviceFeatures{};
 //  physicalDeviceFeatures.fillModeNonSolid = VK_TRUE;
+  // the cull shader's indirect commands start each batch at its own firstInstance
+  physicalDeviceFeatures.drawIndirectFirstInstance = VK_TRUE;
 
   vkb::PhysicalDeviceSelector selector{vkbInst};
   vkb::PhysicalDevice physicalDevice = selector
-          .set_minimum_version(1, 1)
+          .set_minimum_version(1, 2)
           .set_surface(surface)
           .require_present()
-//          .set_required_features(physicalDeviceFeatures)
+          .set_required_features(physicalDeviceFeatures)
           .select()
           .value();
 
+  // timeline semaphores are core in 1.2 but still have to be enabled
+  VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+  vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  vulkan12Features.timelineSemaphore = VK_TRUE;
+  // bindless textures: runtime sized, partially written arrays that are indexed per object and appended to while bound
+  vulkan12Features.descriptorIndexing = VK_TRUE;
+  vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+  vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+  vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+  vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+
+  // the selector only checks 1.0 features, enabling an unsupported one would fail device creation or worse
+  VkPhysicalDeviceVulkan12Features supported12Features = {};
+  supported12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  VkPhysicalDeviceFeatures2 supportedFeatures = {};
+  supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  supportedFeatures.pNext = &supported12Features;
+  vkGetPhysicalDeviceFeatures2(physicalDevice.physical_device, &supportedFeatures);
+
+  VkPhysicalDeviceVulkan12Properties supported12Properties = {};
+  supported12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+  VkPhysicalDeviceProperties2 supportedProperties = {};
+  supportedProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  supportedProperties.pNext = &supported12Properties;
+  vkGetPhysicalDeviceProperties2(physicalDevice.physical_device, &supportedProperties);
+
+  struct {
+    VkBool32 supported;
+    const char* name;
+  } required12Features[] = {
+    {supported12Features.timelineSemaphore, "timelineSemaphore"},
+    {supported12Features.descriptorIndexing, "descriptorIndexing"},
+    {supported12Features.runtimeDescriptorArray, "runtimeDescriptorArray"},
+    {supported12Features.shaderSampledImageArrayNonUniformIndexing, "shaderSampledImageArrayNonUniformIndexing"},
+    {supported12Features.descriptorBindingPartiallyBound, "descriptorBindingPartiallyBound"},
+    {supported12Features.descriptorBindingSampledImageUpdateAfterBind, "descriptorBindingSampledImageUpdateAfterBind"},
+  };
+  bool deviceSupported = true;
+  for(u32 i = 0; i < ArrayCount(required12Features); i++) {
+    if(!required12Features[i].supported) {
+      std::cout << "The GPU " << supportedProperties.properties.deviceName << " doesn't support the Vulkan 1.2 feature " << required12Features[i].name << std::endl;
+      deviceSupported = false;
+    }
+  }
+  if(supported12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages < MAX_BINDLESS_TEXTURES) {
+    std::cout << "The GPU " << supportedProperties.properties.deviceName << " allows " << supported12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages
+              << " update after bind sampled images per stage, bindless textures need " << MAX_BINDLESS_TEXTURES << std::endl;
+    deviceSupported = false;
+  }
+  if(!deviceSupported) {
+    abort(); // like VK_CHECK, release builds would otherwise go on to create a device that can't run the engine
+  }
+
+  // Optional, each run of batches sharing a pipeline becomes a single indirect draw with these, one draw per batch without.
+  // A count draw of more than one command needs multiDrawIndirect as well.
+  multiDrawIndirectSupported = supportedFeatures.features.multiDrawIndirect == VK_TRUE;
+  drawIndirectCountSupported = multiDrawIndirectSupported && supported12Features.drawIndirectCount == VK_TRUE;
+  physicalDevice.features.multiDrawIndirect = multiDrawIndirectSupported ? VK_TRUE : VK_FALSE;
+  vulkan12Features.drawIndirectCount = drawIndirectCountSupported ? VK_TRUE : VK_FALSE;
+  std::cout << "Indirect draws: " << (drawIndirectCountSupported ? "draw count from the cull pass" : multiDrawIndirectSupported ? "multi draw" : "one per batch") << std::endl;
+
   vkb::DeviceBuilder deviceBuilder{physicalDevice};
 
   vkb::Device vkbDevice = deviceBuilder
+          .add_pNext(&vulkan12Features)
           .build()
           .value();
 
@@ -467,6 +595,23 @@ void VulkanEngine::initVulkan() {
 
   vkGetPhysicalDeviceProperties(chosenGPU, &gpuProperties);
 
+  // every pipeline, ImGui's included, is created through this cache, so warm starts and swap chain recreation
+  // mostly skip compilation. It is written back to disk when the engine shuts down.
+  pipelineCache = vkutil::loadPipelineCache(device, gpuProperties, PIPELINE_CACHE_FILE);
+  mainDeletionQueue.pushFunction([=]() {
+    vkutil::savePipelineCache(device, gpuProperties, pipelineCache, PIPELINE_CACHE_FILE);
+    vkDestroyPipelineCache(device, pipelineCache, nullptr);
+  });
+
+  // layouts outlive every pipeline, the pipelines themselves go with the render pass in destroyPipelines()
+  descSetLayoutCache.init(device);
+  pipelineLayoutCache.init(device);
+  pipelineStateCache.init(device, pipelineCache);
+  mainDeletionQueue.pushFunction([=]() {
+    pipelineLayoutCache.destroy();
+    descSetLayoutCache.destroy();
+  });
+
   //initialize the memory allocator
   VmaAllocatorCreateInfo allocatorInfo = {};
   allocatorInfo.physicalDevice = chosenGPU;
@@ -474,8 +619,20 @@ void VulkanEngine::initVulkan() {
   allocatorInfo.instance = instance;
   vmaCreateAllocator(&allocatorInfo, &vmaAllocator);
 
-  uploadContext.device = device;
-  uploadContext.queue = graphicsQueue;
+  // uploads go through a transfer only queue when there is one, so they run alongside rendering
+  VkQueue transferQueue = graphicsQueue;
+  u32 transferQueueFamily = graphicsQueueFamily;
+  vkb::detail::Result<u32> dedicatedTransferQueueFamily = vkbDevice.get_dedicated_queue_index(vkb::QueueType::transfer);
+  if(dedicatedTransferQueueFamily.has_value()) {
+    transferQueueFamily = dedicatedTransferQueueFamily.value();
+    transferQueue = vkbDevice.get_dedicated_queue(vkb::QueueType::transfer).value();
+  }
+  uploadManager.init(device, vmaAllocator, graphicsQueue, graphicsQueueFamily, transferQueue, transferQueueFamily);
+  mainDeletionQueue.pushFunction([=]() {
+    uploadManager.destroy();
+  });
+
+  renderGraph.init(device, vmaAllocator);
 }
 
 void VulkanEngine::initSwapchain() {
@@ -497,25 +654,8 @@ void VulkanEngine::initSwapchain() {
   swapchainImageViews = vkbSwapchain.get_image_views().value();
   swapchainImageFormat = vkbSwapchain.image_format;
 
-  // setup depth buffer
-  VkExtent3D depthImageExtent = {
-          windowExtent.width,
-          windowExtent.height,
-          1
-  };
+  // the depth image itself is a transient of the render graph
   depthFormat = VK_FORMAT_D32_SFLOAT;
-  VkImageCreateInfo depthImageInfo = vkinit::imageCreateInfo(depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depthImageExtent);
-
-  // We want GPU local memory as we do not currently need to access the depth buffer on the CPU side
-  VmaAllocationCreateInfo depthImageAllocInfo = {};
-  depthImageAllocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY; // Requst it to be on GPU
-  depthImageAllocInfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT); // Require it to be on GPU
-  vmaCreateImage(vmaAllocator, &depthImageInfo, &depthImageAllocInfo, &depthImage.vkImage, &depthImage.vmaAllocation, nullptr);
-
-  // build an image-view for the depth image to use in framebuffers for rendering
-  VkImageViewCreateInfo depthImageViewInfo = vkinit::imageViewCreateInfo(depthFormat, depthImage.vkImage, VK_IMAGE_ASPECT_DEPTH_BIT);
-
-  VK_CHECK(vkCreateImageView(device, &depthImageViewInfo, nullptr, &depthImageView));
 }
 
 void VulkanEngine::initCommands() {
@@ -528,93 +668,71 @@ void VulkanEngine::initCommands() {
 
     VK_CHECK(vkAllocateCommandBuffers(device, &cmdAllocInfo, &frames[i].mainCommandBuffer));
 
+    VkCommandBufferAllocateInfo secondaryAllocInfo = vkinit::commandBufferAllocateInfo(frames[i].commandPool, 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    VK_CHECK(vkAllocateCommandBuffers(device, &secondaryAllocInfo, &frames[i].backgroundCommandBuffer));
+    VK_CHECK(vkAllocateCommandBuffers(device, &secondaryAllocInfo, &frames[i].imguiCommandBuffer));
+
     mainDeletionQueue.pushFunction([=]() {
       vkDestroyCommandPool(device, frames[i].commandPool, nullptr);
     });
   }
 
-  // immediate push upload command pool/buffer
-  VkCommandPoolCreateInfo uploadCommandPoolInfo = vkinit::commandPoolCreateInfo(graphicsQueueFamily);
-  VK_CHECK(vkCreateCommandPool(device, &uploadCommandPoolInfo, nullptr, &uploadContext.commandPool));
+  // the calling thread records as well, so one worker means no extra threads
+  u32 recordingThreadCount = MIN(MAX(std::thread::hardware_concurrency(), 1u), (u32)MAX_RECORDING_THREADS);
+  recordingWorkers.init(recordingThreadCount);
 
-  VkCommandBufferAllocateInfo cmdAllocInfo = vkinit::commandBufferAllocateInfo(uploadContext.commandPool, 1);
-  VK_CHECK(vkAllocateCommandBuffers(device, &cmdAllocInfo, &uploadContext.commandBuffer));
+  // thread pools are reset as a whole each frame instead of resetting individual command buffers
+  VkCommandPoolCreateInfo threadCommandPoolInfo = vkinit::commandPoolCreateInfo(graphicsQueueFamily, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+  for(u32 i = 0; i < FRAME_OVERLAP; i++) {
+    for(u32 thread = 0; thread < recordingThreadCount; thread++) {
+      VK_CHECK(vkCreateCommandPool(device, &threadCommandPoolInfo, nullptr, &frames[i].threadCommandPools[thread]));
 
-  mainDeletionQueue.pushFunction([=]() { vkDestroyCommandPool(device, uploadContext.commandPool, nullptr); });
+      VkCommandBufferAllocateInfo threadAllocInfo = vkinit::commandBufferAllocateInfo(frames[i].threadCommandPools[thread], 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+      VK_CHECK(vkAllocateCommandBuffers(device, &threadAllocInfo, &frames[i].threadCommandBuffers[thread]));
 
-}
+      mainDeletionQueue.pushFunction([=]() {
+        vkDestroyCommandPool(device, frames[i].threadCommandPools[thread], nullptr);
+      });
+    }
+  }
 
-void VulkanEngine::initDefaultRenderpass() {
-  VkAttachmentDescription colorAttachment = {};
-  colorAttachment.flags = 0;
-  colorAttachment.format = swapchainImageFormat;
-  colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-  colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-  colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-  VkAttachmentDescription depthAttachment = {};
-  depthAttachment.flags = 0;
-  depthAttachment.format = depthFormat;
-  depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-  depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-  depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-  VkAttachmentDescription attachmentDescriptions[] = {colorAttachment, depthAttachment};
-
-  // Renderpasses hold VkAttachmentDescriptions but subpasses hold VkAttachmentReferences to those descriptions,
-  // this allows two subpasses to simply reference the same attachment instead of holding the entire description
-  VkAttachmentReference colorAttachmentRef = {};
-  //attachment number will index into the pAttachments array in the parent renderpass
-  colorAttachmentRef.attachment = 0;
-  colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-  VkAttachmentReference depthAttachmentRef = {};
-  depthAttachmentRef.attachment = 1;
-  depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-  //we are going to create 1 subpass, which is the minimum you can do
-  VkSubpassDescription subpass = {};
-  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-  subpass.colorAttachmentCount = 1;
-  subpass.pColorAttachments = &colorAttachmentRef;
-  subpass.pDepthStencilAttachment = &depthAttachmentRef;
-
-  VkRenderPassCreateInfo renderPassInfo = {};
-  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-  renderPassInfo.attachmentCount = 2;
-  renderPassInfo.pAttachments = attachmentDescriptions;
-  renderPassInfo.subpassCount = 1;
-  renderPassInfo.pSubpasses = &subpass;
-
-  VK_CHECK(vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass));
 }
 
-void VulkanEngine::initFramebuffers() {
-  //create the framebuffers for the swapchain images. This will connect the render-pass to the images for rendering
-  VkFramebufferCreateInfo fbInfo = {};
-  fbInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-  fbInfo.pNext = nullptr;
-  fbInfo.renderPass = renderPass;
-  fbInfo.attachmentCount = 2;
-  fbInfo.width = windowExtent.width;
-  fbInfo.height = windowExtent.height;
-  fbInfo.layers = 1;
-
-  const u64 swapchainImageCount = swapchainImages.size();
-  framebuffers = std::vector<VkFramebuffer>(swapchainImageCount);
-  for(u32 i = 0; i < swapchainImageCount; i++) {
-    VkImageView attachments[] = {swapchainImageViews[i], depthImageView};
-    fbInfo.pAttachments = attachments;
-    VK_CHECK(vkCreateFramebuffer(device, &fbInfo, nullptr, &framebuffers[i]));
-  }
+void VulkanEngine::initRenderGraph() {
+  RenderGraphResource swapchainTarget = renderGraph.importImage("swapchain", swapchainImageFormat, windowExtent, swapchainImages.data(), swapchainImageViews.data(),
+                                                                (u32)swapchainImages.size(), VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+  RenderGraphResource depth = renderGraph.createImage("depth", depthFormat, windowExtent);
+  // stand for whichever frame's buffers are in use, buffers are only ever ordered by global memory barriers
+  RenderGraphResource drawCommands = renderGraph.importBuffer("draw commands");
+  RenderGraphResource instances = renderGraph.importBuffer("instances");
+
+  cullPass = renderGraph.addPass("cull", RenderGraphPassType::Compute, [this](VkCommandBuffer cmd, const VkCommandBufferInheritanceInfo*) {
+    if(gpuCulling) { recordCullDispatch(cmd, cullFrustum, renderables.count()); }
+  });
+  renderGraph.use(cullPass, drawCommands, RenderGraphAccess::ComputeStorageWrite);
+  renderGraph.use(cullPass, instances, RenderGraphAccess::ComputeStorageWrite);
+
+  backgroundPass = renderGraph.addPass("background", RenderGraphPassType::Raster, [this](VkCommandBuffer cmd, const VkCommandBufferInheritanceInfo*) {
+    vkCmdExecuteCommands(cmd, 1, &getCurrentFrame().backgroundCommandBuffer);
+  });
+  renderGraph.use(backgroundPass, swapchainTarget, RenderGraphAccess::ColorAttachment, &colorClearValue);
+  renderGraph.use(backgroundPass, depth, RenderGraphAccess::DepthAttachment, &depthClearValue);
+
+  objectsPass = renderGraph.addPass("objects", RenderGraphPassType::Raster, [this](VkCommandBuffer cmd, const VkCommandBufferInheritanceInfo*) {
+    if(objectCommandBufferCount > 0) { vkCmdExecuteCommands(cmd, objectCommandBufferCount, objectCommandBuffers); }
+  });
+  renderGraph.use(objectsPass, swapchainTarget, RenderGraphAccess::ColorAttachment);
+  renderGraph.use(objectsPass, depth, RenderGraphAccess::DepthAttachment);
+  renderGraph.use(objectsPass, drawCommands, RenderGraphAccess::IndirectCommandRead);
+  renderGraph.use(objectsPass, instances, RenderGraphAccess::VertexStorageRead);
+
+  imguiPass = renderGraph.addPass("imgui", RenderGraphPassType::Raster, [this](VkCommandBuffer cmd, const VkCommandBufferInheritanceInfo*) {
+    vkCmdExecuteCommands(cmd, 1, &getCurrentFrame().imguiCommandBuffer);
+  });
+  renderGraph.use(imguiPass, swapchainTarget, RenderGraphAccess::ColorAttachment);
+
+  renderGraph.compile();
+  renderPass = renderGraph.renderPass(objectsPass);
 }
 
 void VulkanEngine::initSyncStructures() {
@@ -631,34 +749,14 @@ void VulkanEngine::initSyncStructures() {
       vkDestroySemaphore(device, frames[i].presentSemaphore, nullptr);
     });
   }
-
-  // immediate command buffer submit fence
-  VkFenceCreateInfo uploadFenceCreateInfo = vkinit::fenceCreateInfo();
-  VK_CHECK(vkCreateFence(device, &uploadFenceCreateInfo, nullptr, &uploadContext.uploadFence));
-  mainDeletionQueue.pushFunction([=]() {
-    vkDestroyFence(device, uploadContext.uploadFence, nullptr);
-  });
 }
 
 void VulkanEngine::initDescriptors() {
-  // reserve 10 uniform buffer pointers/handles in the descriptor pool
-  VkDescriptorPoolSize descriptorPoolSizes[] = {
-          {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         10},
-          {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 10},
-          {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         10},
-          {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 10},
-  };
-
-  VkDescriptorPoolCreateInfo descriptorPoolInfo = {};
-  descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-  descriptorPoolInfo.flags = 0;
-  // holds the maximum number of descriptor sets
-  descriptorPoolInfo.maxSets = 10;
-  // holds the maximum number of descriptors of each type
-  descriptorPoolInfo.poolSizeCount = ArrayCount(descriptorPoolSizes);
-  descriptorPoolInfo.pPoolSizes = descriptorPoolSizes;
-
-  vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool);
+  // pools are added as sets are allocated, so nothing here has to be reserved up front
+  descriptorAllocator.init(device);
+  for(u32 i = 0; i < FRAME_OVERLAP; i++) {
+    frames[i].transientDescriptors.init(device);
+  }
 
   // global descriptor set
   VkDescriptorSetLayoutBinding cameraBufferBinding = vkinit::descriptorSetLayoutBinding(
@@ -670,17 +768,9 @@ void VulkanEngine::initDescriptors() {
           VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
           1);
 
-  VkDescriptorSetLayoutBinding globalBindings[] = {cameraBufferBinding, sceneBinding};
-
   // Collection of bindings within our descriptor set
-  VkDescriptorSetLayoutCreateInfo descSetCreateInfo = {};
-  descSetCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-  descSetCreateInfo.pNext = nullptr;
-  descSetCreateInfo.flags = 0;
-  descSetCreateInfo.bindingCount = ArrayCount(globalBindings);
-  descSetCreateInfo.pBindings = globalBindings;
-
-  vkCreateDescriptorSetLayout(device, &descSetCreateInfo, nullptr, &globalDescSetLayout);
+  DescriptorSetLayoutData globalSetData = {0, {cameraBufferBinding, sceneBinding}};
+  globalDescSetLayout = descSetLayoutCache.getLayout(globalSetData);
 
   // object descriptor set
   VkDescriptorSetLayoutBinding objectBufferBinding = vkinit::descriptorSetLayoutBinding(
@@ -688,34 +778,38 @@ void VulkanEngine::initDescriptors() {
           VK_SHADER_STAGE_VERTEX_BIT,
           0);
 
-  VkDescriptorSetLayoutBinding objectBindings[] = {objectBufferBinding};
-
-  descSetCreateInfo.bindingCount = ArrayCount(objectBindings);
-  descSetCreateInfo.pBindings = objectBindings;
-
-  vkCreateDescriptorSetLayout(device, &descSetCreateInfo, nullptr, &objectDescSetLayout);
-
-  VkDescriptorSetAllocateInfo globalDescSetAllocInfo = {};
-  globalDescSetAllocInfo.pNext = nullptr;
-  globalDescSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-  globalDescSetAllocInfo.descriptorPool = descriptorPool;
-  globalDescSetAllocInfo.descriptorSetCount = 1;
-  globalDescSetAllocInfo.pSetLayouts = &globalDescSetLayout;
+  VkDescriptorSetLayoutBinding instanceBufferBinding = vkinit::descriptorSetLayoutBinding(
+          VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+          VK_SHADER_STAGE_VERTEX_BIT,
+          1);
 
-  VkDescriptorSetAllocateInfo objectDescSetAllocInfo = {};
-  objectDescSetAllocInfo.pNext = nullptr;
-  objectDescSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-  objectDescSetAllocInfo.descriptorPool = descriptorPool;
-  objectDescSetAllocInfo.descriptorSetCount = 1;
-  objectDescSetAllocInfo.pSetLayouts = &objectDescSetLayout;
+  DescriptorSetLayoutData objectSetData = {1, {objectBufferBinding, instanceBufferBinding}};
+  objectDescSetLayout = descSetLayoutCache.getLayout(objectSetData);
+
+  // cull descriptor set, the compute pass reads objects and writes draw commands and instances
+  DescriptorSetLayoutData cullSetData = {0, {
+          vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0), // objects
+          vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1), // draw commands
+          vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2), // instances
+  }};
+  cullDescSetLayout = descSetLayoutCache.getLayout(cullSetData);
+
+  // compaction descriptor set, reads the culled draw commands and writes each run's visible ones and their count
+  DescriptorSetLayoutData compactDrawsSetData = {0, {
+          vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0), // draw commands
+          vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1), // draw runs
+          vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2), // draw counts
+          vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3), // compacted draw commands
+  }};
+  compactDrawsDescSetLayout = descSetLayoutCache.getLayout(compactDrawsSetData);
 
   u64 paddedGPUCameraDataSize = vkutil::padUniformBufferSize(gpuProperties, sizeof(GPUCameraData));
   u64 paddedGPUSceneDataSize = vkutil::padUniformBufferSize(gpuProperties, sizeof(GPUSceneData));
   u64 globalBufferSize = FRAME_OVERLAP * (paddedGPUCameraDataSize + paddedGPUSceneDataSize);
   globalBuffer.cameraOffset = 0;
   globalBuffer.sceneOffset = FRAME_OVERLAP * paddedGPUCameraDataSize;
-  globalBuffer.buffer = vkutil::createBuffer(vmaAllocator, globalBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, 0);
-  vkAllocateDescriptorSets(device, &globalDescSetAllocInfo, &globalDescriptorSet);
+  globalBuffer.buffer = vkutil::createBuffer(vmaAllocator, globalBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, 0, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+  globalDescriptorSet = descriptorAllocator.allocate(globalDescSetLayout);
 
   // info about the buffer the descriptor will point at
   VkDescriptorBufferInfo cameraDescBufferInfo;
@@ -736,32 +830,48 @@ void VulkanEngine::initDescriptors() {
   vkUpdateDescriptorSets(device, ArrayCount(descSetWrites), descSetWrites, 0/*descriptorCopyCount*/, nullptr/*pDescriptorCopies*/);
 
   const u64 objectBufferSize = sizeof(GPUObjectData) * MAX_OBJECTS;
+  const u64 instanceBufferSize = sizeof(u32) * MAX_OBJECTS;
+  // there is never more than one draw per object
+  const u64 drawCommandBufferSize = sizeof(VkDrawIndexedIndirectCommand) * MAX_OBJECTS;
+  const u64 drawRunBufferSize = sizeof(u32) * MAX_OBJECTS;
 
   for(u32 i = 0; i < FRAME_OVERLAP; i++) {
     FrameData& frame = frames[i];
 
-    frame.objectBuffer = vkutil::createBuffer(vmaAllocator, objectBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, 0);
-    vkAllocateDescriptorSets(device, &objectDescSetAllocInfo, &frame.objectDescriptorSet);
+    frame.objectBuffer = vkutil::createBuffer(vmaAllocator, objectBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, 0, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    // written by the CPU when culling on the CPU and by the cull shader otherwise
+    frame.instanceBuffer = vkutil::createBuffer(vmaAllocator, instanceBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, 0, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    frame.drawCommandBuffer = vkutil::createBuffer(vmaAllocator, drawCommandBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+    frame.drawCommandTemplateBuffer = vkutil::createBuffer(vmaAllocator, drawCommandBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, 0, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    frame.drawCommandReadbackBuffer = vkutil::createBuffer(vmaAllocator, drawCommandBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU, 0, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    if(drawIndirectCountSupported) {
+      frame.drawRunBuffer = vkutil::createBuffer(vmaAllocator, drawRunBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, 0, VMA_ALLOCATION_CREATE_MAPPED_BIT);
+      frame.drawCountBuffer = vkutil::createBuffer(vmaAllocator, drawRunBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+      frame.compactedDrawCommandBuffer = vkutil::createBuffer(vmaAllocator, drawCommandBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, 0);
+    }
+    frame.drawCommandsVersion = U32_MAX;
+    frame.objectDescriptorSet = descriptorAllocator.allocate(objectDescSetLayout);
 
     VkDescriptorBufferInfo objectDescBufferInfo;
     objectDescBufferInfo.buffer = frame.objectBuffer.vkBuffer;
     objectDescBufferInfo.offset = 0;
     objectDescBufferInfo.range = objectBufferSize;
 
+    VkDescriptorBufferInfo instanceDescBufferInfo;
+    instanceDescBufferInfo.buffer = frame.instanceBuffer.vkBuffer;
+    instanceDescBufferInfo.offset = 0;
+    instanceDescBufferInfo.range = instanceBufferSize;
+
     VkWriteDescriptorSet objectWrite = vkinit::writeDescriptorBuffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.objectDescriptorSet, &objectDescBufferInfo, 0);
+    VkWriteDescriptorSet instanceWrite = vkinit::writeDescriptorBuffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.objectDescriptorSet, &instanceDescBufferInfo, 1);
 
-    VkWriteDescriptorSet descSetWrites[] = {objectWrite};
+    VkWriteDescriptorSet descSetWrites[] = {objectWrite, instanceWrite};
 
     vkUpdateDescriptorSets(device, ArrayCount(descSetWrites), descSetWrites, 0/*descriptorCopyCount*/, nullptr/*pDescriptorCopies*/);
   }
 
-  // single texture descriptor set layout
-  VkDescriptorSetLayoutBinding textureBind = vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0);
-
-  descSetCreateInfo.bindingCount = 1;
-  descSetCreateInfo.pBindings = &textureBind;
-
-  vkCreateDescriptorSetLayout(device, &descSetCreateInfo, nullptr, &singleTextureSetLayout);
+  // textures have their own update after bind pool, it can't share one with the sets above
+  bindlessTextures.init(device, descSetLayoutCache);
 
   mainDeletionQueue.pushFunction([=]() {
     // free buffers
@@ -769,13 +879,23 @@ void VulkanEngine::initDescriptors() {
     for(u32 i = 0; i < FRAME_OVERLAP; i++) {
       FrameData& frame = frames[i];
       vmaDestroyBuffer(vmaAllocator, frame.objectBuffer.vkBuffer, frame.objectBuffer.vmaAllocation);
+      vmaDestroyBuffer(vmaAllocator, frame.instanceBuffer.vkBuffer, frame.instanceBuffer.vmaAllocation);
+      vmaDestroyBuffer(vmaAllocator, frame.drawCommandBuffer.vkBuffer, frame.drawCommandBuffer.vmaAllocation);
+      vmaDestroyBuffer(vmaAllocator, frame.drawCommandTemplateBuffer.vkBuffer, frame.drawCommandTemplateBuffer.vmaAllocation);
+      vmaDestroyBuffer(vmaAllocator, frame.drawCommandReadbackBuffer.vkBuffer, frame.drawCommandReadbackBuffer.vmaAllocation);
+      if(drawIndirectCountSupported) {
+        vmaDestroyBuffer(vmaAllocator, frame.drawRunBuffer.vkBuffer, frame.drawRunBuffer.vmaAllocation);
+        vmaDestroyBuffer(vmaAllocator, frame.drawCountBuffer.vkBuffer, frame.drawCountBuffer.vmaAllocation);
+        vmaDestroyBuffer(vmaAllocator, frame.compactedDrawCommandBuffer.vkBuffer, frame.compactedDrawCommandBuffer.vmaAllocation);
+      }
     }
 
-    // freeing descriptor pool frees descriptor layouts
-    vkDestroyDescriptorSetLayout(device, globalDescSetLayout, nullptr);
-    vkDestroyDescriptorSetLayout(device, objectDescSetLayout, nullptr);
-    vkDestroyDescriptorSetLayout(device, singleTextureSetLayout, nullptr);
-    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    // destroying the pools frees their descriptor sets, the set layouts belong to descSetLayoutCache
+    descriptorAllocator.destroy();
+    for(u32 i = 0; i < FRAME_OVERLAP; i++) {
+      frames[i].transientDescriptors.destroy();
+    }
+    bindlessTextures.destroy();
   });
 }
 
@@ -792,50 +912,72 @@ void VulkanEngine::createFragmentShaderPipeline() {
   ShaderMetadata shaderMetadata;
   materialManager.loadShaderMetadata(device, SHADER_DIR"hard_coded_fullscreen_quad.vert.spv", SHADER_DIR"fragment_shader_test.frag.spv", shaderMetadata);
 
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo = vkinit::pipelineLayoutCreateInfo();
-  pipelineLayoutInfo.pPushConstantRanges = &fragmentShaderPushConstantsRange;
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-
-  VK_CHECK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &fragmentShaderPipelineLayout));
+  fragmentShaderPipelineLayout = pipelineLayoutCache.getLayout(nullptr, 0, {fragmentShaderPushConstantsRange});
 
   PipelineBuilder pipelineBuilder;
   pipelineBuilder.shaderStages.push_back(vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, shaderMetadata.vertModule));
   pipelineBuilder.shaderStages.push_back(vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, shaderMetadata.fragModule));
   pipelineBuilder.vertexInputInfo = vkinit::vertexInputStateCreateInfo();
   pipelineBuilder.inputAssembly = vkinit::inputAssemblyCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
-  pipelineBuilder.viewport.x = 0.0f;
-  pipelineBuilder.viewport.y = 0.0f;
-  pipelineBuilder.viewport.width = (float)windowExtent.width;
-  pipelineBuilder.viewport.height = (float)windowExtent.height;
-  pipelineBuilder.viewport.minDepth = 0.0f;
-  pipelineBuilder.viewport.maxDepth = 1.0f;
-  pipelineBuilder.scissor.offset = {0, 0};
-  pipelineBuilder.scissor.extent = windowExtent;
   pipelineBuilder.rasterizer = vkinit::rasterizationStateCreateInfo(VK_POLYGON_MODE_FILL);
   pipelineBuilder.multisampling = vkinit::multisamplingStateCreateInfo();
   pipelineBuilder.colorBlendAttachment = vkinit::colorBlendAttachmentState();
   pipelineBuilder.depthStencil = vkinit::depthStencilCreateInfo(true, true, VK_COMPARE_OP_LESS_OR_EQUAL);
   pipelineBuilder.pipelineLayout = fragmentShaderPipelineLayout;
 
-  fragmentShaderPipeline = pipelineBuilder.buildPipeline(device, renderPass);
+  fragmentShaderPipeline = pipelineStateCache.getPipeline(pipelineBuilder, renderPass);
+}
+
+void VulkanEngine::initComputePipelines() {
+  VkShaderModule cullModule = vkutil::loadShaderModule(device, SHADER_DIR"cull_objects.comp.spv");
+
+  VkPushConstantRange cullPushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GPUCullPushConstants)};
+  cullPipelineLayout = pipelineLayoutCache.getLayout(&cullDescSetLayout, 1, {cullPushConstantRange});
+
+  VkComputePipelineCreateInfo pipelineInfo = {};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.pNext = nullptr;
+  pipelineInfo.stage = vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, cullModule);
+  pipelineInfo.layout = cullPipelineLayout;
+
+  VK_CHECK(vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &cullPipeline));
+
+  // the pipeline keeps what it needs from the module
+  vkDestroyShaderModule(device, cullModule, nullptr);
+
+  mainDeletionQueue.pushFunction([=]() {
+    vkDestroyPipeline(device, cullPipeline, nullptr);
+  });
+
+  if(drawIndirectCountSupported) {
+    VkShaderModule compactDrawsModule = vkutil::loadShaderModule(device, SHADER_DIR"compact_draws.comp.spv");
+
+    VkPushConstantRange compactDrawsPushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GPUCompactDrawsPushConstants)};
+    compactDrawsPipelineLayout = pipelineLayoutCache.getLayout(&compactDrawsDescSetLayout, 1, {compactDrawsPushConstantRange});
+
+    pipelineInfo.stage = vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, compactDrawsModule);
+    pipelineInfo.layout = compactDrawsPipelineLayout;
+    VK_CHECK(vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &compactDrawsPipeline));
+
+    vkDestroyShaderModule(device, compactDrawsModule, nullptr);
+
+    mainDeletionQueue.pushFunction([=]() {
+      vkDestroyPipeline(device, compactDrawsPipeline, nullptr);
+    });
+  }
 }
 
 void VulkanEngine::createPipeline(MaterialCreateInfo matInfo) {
   ShaderMetadata shaderMetadata;
   materialManager.loadShaderMetadata(device, matInfo.vertFileName, matInfo.fragFileName, shaderMetadata);
 
-  // TODO: Pipeline layout can be reused for several pipelines/materials
-  // TODO: Reuse of pipeline layouts will allows for push constants to be used for several pipelines
-  // build mesh pipeline layout
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo = vkinit::pipelineLayoutCreateInfo();
-  pipelineLayoutInfo.pushConstantRangeCount = 0;
-  pipelineLayoutInfo.pPushConstantRanges = nullptr;
-  VkDescriptorSetLayout descSetLayouts[] = {globalDescSetLayout, objectDescSetLayout, singleTextureSetLayout};
-  pipelineLayoutInfo.setLayoutCount = ArrayCount(descSetLayouts);
-  pipelineLayoutInfo.pSetLayouts = descSetLayouts;
-
-  VkPipelineLayout pipelineLayout;
-  VK_CHECK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout));
+  // Every material uses the engine's sets rather than layouts of its own reflected bindings, so all material
+  // layouts stay compatible and the sets bound once per command buffer serve every pipeline
+  VkDescriptorSetLayout descSetLayouts[] = {globalDescSetLayout, objectDescSetLayout, bindlessTextures.setLayout};
+  for(const DescriptorSetLayoutData& reflectedSet: shaderMetadata.descSetLayouts) {
+    Assert(reflectedSet.setIndex < ArrayCount(descSetLayouts))
+  }
+  VkPipelineLayout pipelineLayout = pipelineLayoutCache.getLayout(descSetLayouts, ArrayCount(descSetLayouts), shaderMetadata.pushConstantRanges);
 
   PipelineBuilder pipelineBuilder;
   pipelineBuilder.shaderStages.push_back(vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, shaderMetadata.vertModule));
@@ -843,15 +985,6 @@ void VulkanEngine::createPipeline(MaterialCreateInfo matInfo) {
   pipelineBuilder.vertexInputInfo = vkinit::vertexInputStateCreateInfo();
   // input assembly is the configuration for drawing triangle lists, strips, or points
   pipelineBuilder.inputAssembly = vkinit::inputAssemblyCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
-  //build viewport and scissor from the swapchain extents
-  pipelineBuilder.viewport.x = 0.0f;
-  pipelineBuilder.viewport.y = 0.0f;
-  pipelineBuilder.viewport.width = (float)windowExtent.width;
-  pipelineBuilder.viewport.height = (float)windowExtent.height;
-  pipelineBuilder.viewport.minDepth = 0.0f;
-  pipelineBuilder.viewport.maxDepth = 1.0f;
-  pipelineBuilder.scissor.offset = {0, 0};
-  pipelineBuilder.scissor.extent = windowExtent;
   pipelineBuilder.rasterizer = vkinit::rasterizationStateCreateInfo(VK_POLYGON_MODE_FILL);
   pipelineBuilder.multisampling = vkinit::multisamplingStateCreateInfo();
   pipelineBuilder.colorBlendAttachment = vkinit::colorBlendAttachmentState();
@@ -865,7 +998,8 @@ void VulkanEngine::createPipeline(MaterialCreateInfo matInfo) {
   pipelineBuilder.vertexInputInfo.pVertexBindingDescriptions = &vertexDescription.bindingDesc;
   pipelineBuilder.vertexInputInfo.vertexBindingDescriptionCount = 1;
 
-  VkPipeline pipeline = pipelineBuilder.buildPipeline(device, renderPass);
+  // materials with the same shaders and state share one pipeline
+  VkPipeline pipeline = pipelineStateCache.getPipeline(pipelineBuilder, renderPass);
 
   createMaterial(pipeline, pipelineLayout, matInfo.name);
 }
@@ -874,30 +1008,26 @@ void VulkanEngine::initScene() {
 
   // Samplers //
   VkSamplerCreateInfo samplerInfo = vkinit::samplerCreateInfo(VK_FILTER_NEAREST);
+  samplerInfo.maxLod = VK_LOD_CLAMP_NONE; // baked textures carry full mip chains
 
   VkSampler blockySampler;
   vkCreateSampler(device, &samplerInfo, nullptr, &blockySampler);
 
-  //allocate the descriptor set for single-texture to use on the material
-  VkDescriptorSetAllocateInfo allocInfo = {};
-  allocInfo.pNext = nullptr;
-  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-  allocInfo.descriptorPool = descriptorPool;
-  allocInfo.descriptorSetCount = 1;
-  allocInfo.pSetLayouts = &singleTextureSetLayout;
-
-  auto attachTexture = [&](VkSampler sampler, const char* loadedTexture, VkDescriptorSet* textureSet) -> void {
-    vkAllocateDescriptorSets(device, &allocInfo, textureSet);
-
-    //write to the descriptor set so that it points to our minecraft_diffuse texture
-    VkDescriptorImageInfo imageBufferInfo;
-    imageBufferInfo.sampler = blockySampler;
-    imageBufferInfo.imageView = loadedTextures[loadedTexture].imageView;
-    imageBufferInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  u32 blockySamplerIndex = bindlessTextures.addSampler(blockySampler);
 
-    VkWriteDescriptorSet texture = vkinit::writeDescriptorImage(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, *textureSet, &imageBufferInfo, 0);
-
-    vkUpdateDescriptorSets(device, 1, &texture, 0, nullptr);
+  // textures are already in the bindless set, objects only record which one they sample
+  // A texture that failed to load has no bindless slot, a textured object falls back to the untextured lit material
+  auto attachTexture = [&](u32 samplerIndex, BakedTextureIndex loadedTexture, RenderObject* object) -> void {
+    const Texture& texture = loadedTextures[(u32)loadedTexture];
+    if(texture.image.vkImage == VK_NULL_HANDLE) {
+      if(object->material == getMaterial(materialTextured.name)) {
+        object->materialName = materialDefaultLit.name;
+        object->material = getMaterial(object->materialName);
+      }
+      return;
+    }
+    object->textureIndex = texture.bindlessIndex;
+    object->samplerIndex = samplerIndex;
   };
 
   // Renderables //
@@ -912,15 +1042,15 @@ void VulkanEngine::initScene() {
 	mat4 mrSaturnTransform = mrSaturnTranslationMat * mrSaturnScaleMat;
   mrSaturnObject.modelMatrix = mrSaturnTransform;
   mrSaturnObject.defaultColor = vec4{155.0f / 255.0f, 115.0f / 255.0f, 96.0f / 255.0f, 1.0f};
-  attachTexture(blockySampler, bakedTextureAssetData.single_white_pixel.name, &mrSaturnObject.textureSet);
-	renderables.push_back(mrSaturnObject);
+  attachTexture(blockySamplerIndex, BakedTextureIndex::single_white_pixel, &mrSaturnObject);
+	renderables.add(mrSaturnObject);
 
   // Cubes //
 	RenderObject cubeObject;
   cubeObject.mesh = getMesh(bakedMeshAssetData.cube.name);
   cubeObject.materialName = materialDefaulColor.name;
   cubeObject.material = getMaterial(cubeObject.materialName);
-  attachTexture(blockySampler, bakedTextureAssetData.single_white_pixel.name, &cubeObject.textureSet);
+  attachTexture(blockySamplerIndex, BakedTextureIndex::single_white_pixel, &cubeObject);
 	f32 envScale = 0.2f;
 	mat4 envScaleMat = scale_mat4(vec3{envScale, envScale, envScale});
 	for (s32 x = -16; x <= 16; ++x)
@@ -931,16 +1061,30 @@ void VulkanEngine::initScene() {
 		mat4 translationMat = translate_mat4(pos);
     cubeObject.modelMatrix = translationMat * envScaleMat;
     cubeObject.defaultColor = vec4{color.r, color.g, color.b, 1.0f}; // TODO: lookup how glm accomplishes vec4{vec3, f32} construction
-		renderables.push_back(cubeObject);
+		renderables.add(cubeObject);
 	}
 
+  // Prefabs //
+  // every baked prefab, side by side along x behind the cubes
+  RenderObject prefabObject;
+  prefabObject.materialName = materialDefaultLit.name;
+  prefabObject.material = getMaterial(prefabObject.materialName);
+  prefabObject.defaultColor = vec4{1.0f, 1.0f, 1.0f, 1.0f};
+  attachTexture(blockySamplerIndex, BakedTextureIndex::single_white_pixel, &prefabObject);
+  BakedAssetData* bakedPrefabs = (BakedAssetData*)(&bakedPrefabAssetData);
+  for(u32 i = 0; i < bakedPrefabAssetCount(); i++) {
+    Prefab* prefab = getPrefab(bakedPrefabs[i].name);
+    if(prefab == nullptr) { continue; }
+    instantiatePrefab(*prefab, translate_mat4(vec3{i * 20.0f, 40.0f, 0.0f}), prefabObject);
+  }
+
   // Minecraft World
 //  RenderObject minecraftObject;
 //  minecraftObject.mesh = getMesh(bakedMeshAssetData.lost_empire.name);
 //  minecraftObject.materialName = materialTextured.name;
 //  minecraftObject.material = getMaterial(minecraftObject.materialName);
 //  minecraftObject.defaultColor = vec4{50.0f, 0.0f, 0.0f, 1.0f};
-//  attachTexture(blockySampler, bakedTextureAssetData.lost_empire_RGBA.name, &minecraftObject.textureSet);
+//  attachTexture(blockySamplerIndex, BakedTextureIndex::lost_empire_RGBA, &minecraftObject);
 //
 //  f32 minecraftScale = 1.0f;
 //  mat4 minecraftScaleMat = scale_mat4(vec3{minecraftScale, minecraftScale, minecraftScale});
@@ -949,12 +1093,7 @@ void VulkanEngine::initScene() {
 //  mat4 minecraftTransform = minecraftTranslationMat * minecraftRotationMat * minecraftScaleMat;
 //  minecraftObject.modelMatrix = minecraftTransform;
 //
-//  renderables.push_back(minecraftObject);
-
-  // TODO: sort objects by material to minimize binding pipelines
-  //std::sort(renderables.begin(), renderables.end(), [](const RenderObject& a, const RenderObject& b) {
-  //	return a.material->pipeline > b.material->pipeline;
-  //});
+//  renderables.add(minecraftObject);
 
   mainDeletionQueue.pushFunction([=]() {
     vkDestroySampler(device, blockySampler, nullptr);
@@ -968,53 +1107,152 @@ void VulkanEngine::initCamera() {
 }
 
 void VulkanEngine::loadMeshes() {
-  // Note: Currently just loading all meshes, not sustainable in long run
   BakedAssetData* bakedMeshes = (BakedAssetData*)(&bakedMeshAssetData);
   u32 meshCount = bakedMeshAssetCount();
+
+  // Identical meshes are baked to a single content addressed file, each file gets one Mesh shared by its aliases
+  std::unordered_map<std::string, Mesh*> uniqueMeshes;
+  meshStreamer.init(&assetReader, &uploadManager, &geometryArena, meshCount, FRAME_OVERLAP);
   for(u32 i = 0; i < meshCount; i++) {
-    const BakedAssetData& bakedMeshData = bakedMeshes[i];
+    auto [uniqueMeshIter, inserted] = uniqueMeshes.emplace(bakedMeshes[i].filePath, nullptr);
+    if(inserted) { uniqueMeshIter->second = meshStreamer.registerMesh(bakedMeshes[i].filePath); }
+    meshes[bakedMeshes[i].name] = uniqueMeshIter->second;
+  }
 
-    Mesh mesh{};
-    mesh.loadFromAsset(bakedMeshData.filePath);
-    mesh.uploadMesh(vmaAllocator, uploadContext);
-    meshes[bakedMeshData.name] = mesh;
+  // The arena holds every resident mesh, so its size is the residency budget. Half of what the largest device local
+  // heap has left is taken at most, VMA estimates the heap budgets from their sizes without VK_EXT_memory_budget.
+  const VkPhysicalDeviceMemoryProperties* memoryProperties;
+  vmaGetMemoryProperties(vmaAllocator, &memoryProperties);
+  VmaBudget heapBudgets[VK_MAX_MEMORY_HEAPS];
+  vmaGetBudget(vmaAllocator, heapBudgets);
+  u64 availableHeapBytes = 0;
+  for(u32 heapIndex = 0; heapIndex < memoryProperties->memoryHeapCount; heapIndex++) {
+    if(!(memoryProperties->memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) { continue; }
+    const VmaBudget& heapBudget = heapBudgets[heapIndex];
+    if(heapBudget.budget > heapBudget.usage) {
+      availableHeapBytes = MAX(availableHeapBytes, heapBudget.budget - heapBudget.usage);
+    }
+  }
+  u64 geometryBudget = MIN(MESH_RESIDENCY_BUDGET, availableHeapBytes / 2);
+  u32 vertexCapacity = (u32)(geometryBudget / (sizeof(Vertex) + GEOMETRY_ARENA_INDICES_PER_VERTEX * sizeof(u32)));
+  geometryArena.init(vmaAllocator, vertexCapacity, vertexCapacity * GEOMETRY_ARENA_INDICES_PER_VERTEX, sizeof(Vertex));
+
+  // the only mesh loaded up front, drawn in place of every mesh that is still streaming in
+  Mesh* placeholder = getMesh(bakedMeshAssetData.cube.name);
+  if(placeholder == nullptr || !meshStreamer.loadPlaceholder(placeholder)) {
+    std::cout << "Failed to load the placeholder mesh: " << bakedMeshAssetData.cube.filePath << std::endl;
+    InvalidCodePath
   }
 
+  std::cout << "Registered " << uniqueMeshes.size() << " unique meshes for " << meshCount << " baked meshes, "
+            << geometryBudget / (1024 * 1024) << " MB mesh residency budget" << std::endl;
+
   mainDeletionQueue.pushFunction([=]() {
-    u32 meshCount = bakedMeshAssetCount();
-    for(u32 i = 0; i < meshCount; i++) {
-      const BakedAssetData& bakedMeshData = bakedMeshes[i];
-      const Mesh& mesh = meshes[bakedMeshData.name];
-      vmaDestroyBuffer(vmaAllocator, mesh.vertexBuffer.vkBuffer, mesh.vertexBuffer.vmaAllocation);
-      vmaDestroyBuffer(vmaAllocator, mesh.indexBuffer.vkBuffer, mesh.indexBuffer.vmaAllocation);
-      meshes.erase(bakedMeshData.name);
-    }
+    meshStreamer.destroy();
+    geometryArena.destroy(vmaAllocator);
+    meshes.clear();
   });
 }
 
-void VulkanEngine::cleanupSwapChain() {
-  // NOTE: Pipelines depend on swap chain due to its dependencies on the window extent and the renderpass
-  vkDestroyPipeline(device, fragmentShaderPipeline, nullptr);
-  vkDestroyPipelineLayout(device, fragmentShaderPipelineLayout, nullptr);
-  for(std::pair<std::string, Material> element: materials) {
-    Material& mat = element.second;
-    vkDestroyPipeline(device, mat.pipeline, nullptr);
-    vkDestroyPipelineLayout(device, mat.pipelineLayout, nullptr);
+void VulkanEngine::loadPrefabs() {
+  BakedAssetData* bakedPrefabs = (BakedAssetData*)(&bakedPrefabAssetData);
+  u32 prefabCount = bakedPrefabAssetCount();
+  BakedAssetData* bakedMaterials = (BakedAssetData*)(&bakedMaterialAssetData);
+  u32 materialCount = bakedMaterialAssetCount();
+
+  std::vector<std::future<assets::PrefabInfo>> prefabInfos;
+  prefabInfos.resize(prefabCount);
+  for(u32 i = 0; i < prefabCount; i++) {
+    prefabInfos[i] = assetReader.readAssetFile<assets::PrefabInfo>(bakedPrefabs[i].filePath, [](bool success, assets::AssetFile& assetFile) {
+      return success ? assets::readPrefabInfo(&assetFile) : assets::PrefabInfo{};
+    });
   }
-  materials.clear();
 
-  // NOTE: Framebuffers depend on swap chain due to it holding attachments for the swap chain and depth image views
-  u64 swapchainImageCount = swapchainImageViews.size();
-  for(u32 i = 0; i < swapchainImageCount; i++) {
-    vkDestroyFramebuffer(device, framebuffers[i], nullptr);
+  for(u32 i = 0; i < prefabCount; i++) {
+    assets::PrefabInfo prefabInfo = prefabInfos[i].get();
+    u32 nodeCount = prefabInfo.nodeCount();
+
+    Prefab prefab;
+    prefab.nodeParents = std::move(prefabInfo.nodeParents);
+    prefab.nodeMatrices = std::move(prefabInfo.nodeMatrices);
+
+    // mesh names are resolved once here so instantiation never touches a hash map
+    for(u32 nodeIndex = 0; nodeIndex < nodeCount; nodeIndex++) {
+      s32 meshIndex = prefabInfo.nodeMeshes[nodeIndex];
+      if(meshIndex == PREFAB_NO_MESH) { continue; }
+
+      const std::string& meshName = prefabInfo.meshes[meshIndex].meshName;
+      Mesh* mesh = getMesh(meshName);
+      if(mesh == nullptr) {
+        std::cout << "Prefab " << bakedPrefabs[i].name << " references unknown mesh " << meshName << std::endl;
+        continue;
+      }
+      prefab.meshNodes.push_back(nodeIndex);
+      prefab.meshNodeMeshes.push_back(mesh);
+
+      // the material table is sorted by name, its position is the BakedMaterialIndex materialRecords is indexed by
+      const std::string& materialName = prefabInfo.meshes[meshIndex].materialName;
+      BakedAssetData* bakedMaterial = std::lower_bound(bakedMaterials, bakedMaterials + materialCount, materialName, [](const BakedAssetData& data, const std::string& name) {
+        return strcmp(data.name, name.c_str()) < 0;
+      });
+      bool materialFound = bakedMaterial != bakedMaterials + materialCount && materialName == bakedMaterial->name;
+      prefab.meshNodeMaterials.push_back(materialFound ? (u32)(bakedMaterial - bakedMaterials) : U32_MAX);
+    }
+
+    prefabs[bakedPrefabs[i].name] = std::move(prefab);
+  }
+}
+
+Prefab* VulkanEngine::getPrefab(const std::string& name) {
+  auto it = prefabs.find(name);
+  if(it == prefabs.end()) {
+    return nullptr;
+  } else {
+    return &(*it).second;
+  }
+}
+
+void VulkanEngine::instantiatePrefab(const Prefab& prefab, const mat4& transform, const RenderObject& objectTemplate) {
+  u32 nodeCount = (u32)prefab.nodeParents.size();
+  if(prefabWorldMatrices.size() < nodeCount) {
+    prefabWorldMatrices.resize(nodeCount);
+  }
+  assets::computeWorldMatrices(prefab.nodeParents.data(), prefab.nodeMatrices.data(), nodeCount, transform, prefabWorldMatrices.data());
+
+  u32 meshNodeCount = (u32)prefab.meshNodes.size();
+  for(u32 i = 0; i < meshNodeCount; i++) {
+    RenderObject object = objectTemplate;
+    object.mesh = prefab.meshNodeMeshes[i];
+    object.modelMatrix = prefabWorldMatrices[prefab.meshNodes[i]];
+
+    u32 materialIndex = prefab.meshNodeMaterials[i];
+    if(materialIndex != U32_MAX) {
+      const assets::MaterialRecord& record = materialRecords[materialIndex];
+      object.defaultColor = vec4{record.baseColorFactor[0], record.baseColorFactor[1], record.baseColorFactor[2], record.baseColorFactor[3]};
+      const Texture* baseColor = getMaterialTexture(materialIndex, assets::MaterialTextureSlot::BaseColor);
+      if(baseColor != nullptr) {
+        object.textureIndex = baseColor->bindlessIndex;
+        object.materialName = materialTextured.name;
+        object.material = getMaterial(object.materialName);
+      }
+    }
+    renderables.add(object);
   }
-  // NOTE: Renderpass depends on the swap chain due to the swap chain's image format
-  vkDestroyRenderPass(device, renderPass, nullptr);
+}
+
+void VulkanEngine::destroyPipelines() {
+  // materials only point at cached pipelines and layouts, the layouts are kept as they don't depend on the render pass
+  pipelineStateCache.clear();
+  materials.clear();
+}
 
-  // NOTE: Depth image view depends on the swap chain due to it's dependency on the window extent
-  vkDestroyImageView(device, depthImageView, nullptr);
-  vmaDestroyImage(vmaAllocator, depthImage.vkImage, depthImage.vmaAllocation);
+void VulkanEngine::cleanupSwapChain() {
+  // NOTE: Only what depends on the window size or the swap chain images is destroyed here. Pipelines use dynamic
+  // viewport and scissor state and the render pass only depends on the image format, so both outlive the swap chain.
+  // NOTE: The render graph's framebuffers hold the swap chain image views, and its transients are sized by the window extent
+  renderGraph.reset();
 
+  u64 swapchainImageCount = swapchainImageViews.size();
   for(u32 i = 0; i < swapchainImageCount; i++) {
     vkDestroyImageView(device, swapchainImageViews[i], nullptr);
   }
@@ -1035,15 +1273,21 @@ void VulkanEngine::recreateSwapChain() {
 
   vkDeviceWaitIdle(device);
 
+  VkFormat previousImageFormat = swapchainImageFormat;
   cleanupSwapChain();
 
   initSwapchain();
-  initDefaultRenderpass();
-  initFramebuffers();
-  initPipelines();
-
-  for(RenderObject& object: renderables) {
-    object.material = getMaterial(object.materialName);
+  initRenderGraph();
+  // Pipelines only have to be compatible with the render pass they are used in, which the rebuilt one is unless the
+  // image format changed
+  if(swapchainImageFormat != previousImageFormat) {
+    destroyPipelines();
+    initPipelines();
+
+    for(u32 i = 0; i < renderables.count(); i++) {
+      renderables.materials[i] = getMaterial(renderables.materialNames[i]);
+    }
+    renderables.version++; // draw batches point at the old materials
   }
 }
 
@@ -1070,7 +1314,7 @@ Mesh* VulkanEngine::getMesh(const std::string& name) {
   if(it == meshes.end()) {
     return nullptr;
   } else {
-    return &(*it).second;
+    return (*it).second;
   }
 }
 
@@ -1086,7 +1330,10 @@ void VulkanEngine::drawFragmentShader(VkCommandBuffer cmd) {
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
 
+  VkRect2D scissor = {{0, 0}, windowExtent};
+
   vkCmdSetViewport(cmd, 0, 1, &viewport);
+  vkCmdSetScissor(cmd, 0, 1, &scissor);
 
   FragmentShaderPushConstants pushConstants;
   pushConstants.time = (frameNumber / 60.0f);
@@ -1097,13 +1344,16 @@ void VulkanEngine::drawFragmentShader(VkCommandBuffer cmd) {
   vkCmdDraw(cmd, 6, 1, 0, 0);
 }
 
-void VulkanEngine::drawObjects(VkCommandBuffer cmd, RenderObject* firstObject, u32 objectCount) {
+u32 VulkanEngine::drawObjects(const VkCommandBufferInheritanceInfo& inheritanceInfo, RenderObjectStore& objects, VkCommandBuffer* outCommandBuffers) {
   FrameData& frame = getCurrentFrame();
+  u32 objectCount = objects.count();
 
   // camera data
   GPUCameraData cameraData;
   cameraData.view = camera.getViewMatrix();
-  cameraData.projection = perspective(radians(70.f), 1700.f / 900.f, 0.1f, 200.0f);
+  const f32 nearPlane = 0.1f;
+  const f32 farPlane = 200.0f;
+  cameraData.projection = perspective(radians(70.f), 1700.f / 900.f, nearPlane, farPlane);
   cameraData.viewproj = cameraData.projection * cameraData.view;
   // scene data
   GPUSceneData sceneData;
@@ -1115,35 +1365,24 @@ void VulkanEngine::drawObjects(VkCommandBuffer cmd, RenderObject* firstObject, u
   // copy data to scene buffer
   u64 sceneDataOffset = (u32)vkutil::padUniformBufferSize(gpuProperties, sizeof(GPUSceneData)) * frameIndex;
   u64 cameraDataOffset = (u32)vkutil::padUniformBufferSize(gpuProperties, sizeof(GPUCameraData)) * frameIndex;
-  char* globalDataBufferPtr;
-  vmaMapMemory(vmaAllocator, globalBuffer.buffer.vmaAllocation, (void**)&globalDataBufferPtr);
+  // the global buffer is persistently mapped, only this frame's slices are written
+  char* globalDataBufferPtr = (char*)globalBuffer.buffer.mappedData;
   {
     // copy camera data
-    char* cameraPtr = (globalDataBufferPtr + globalBuffer.cameraOffset);
-    cameraPtr += cameraDataOffset;
-    memcpy(cameraPtr, &cameraData, sizeof(GPUCameraData));
+    u64 cameraDataStart = globalBuffer.cameraOffset + cameraDataOffset;
+    memcpy(globalDataBufferPtr + cameraDataStart, &cameraData, sizeof(GPUCameraData));
+    vmaFlushAllocation(vmaAllocator, globalBuffer.buffer.vmaAllocation, cameraDataStart, sizeof(GPUCameraData));
 
     // copy scene data
-    char* scenePtr = (globalDataBufferPtr + globalBuffer.sceneOffset);
-    scenePtr += sceneDataOffset;
-    memcpy(scenePtr, &sceneData, sizeof(GPUSceneData));
-    globalDataBufferPtr = nullptr;
+    u64 sceneDataStart = globalBuffer.sceneOffset + sceneDataOffset;
+    memcpy(globalDataBufferPtr + sceneDataStart, &sceneData, sizeof(GPUSceneData));
+    vmaFlushAllocation(vmaAllocator, globalBuffer.buffer.vmaAllocation, sceneDataStart, sizeof(GPUSceneData));
   }
-  vmaUnmapMemory(vmaAllocator, globalBuffer.buffer.vmaAllocation);
 
   // copy data to object buffer
   local_access Timer ssboUploadTimer;
   StartTimer(ssboUploadTimer);
-  GPUObjectData* objectData;
-  vmaMapMemory(vmaAllocator, frame.objectBuffer.vmaAllocation, (void**)&objectData);
-  // Note: if my data was organized differently, possibly SoA or AoSoA instead of simply AoS, I could use memcpy for large chunks of data instead of iterating through a loop
-  for(u32 i = 0; i < objectCount; i++) {
-    RenderObject& object = firstObject[i];
-    objectData[i].modelMatrix = object.modelMatrix;
-    objectData[i].defaultColor = object.defaultColor;
-  }
-  objectData = nullptr;
-  vmaUnmapMemory(vmaAllocator, frame.objectBuffer.vmaAllocation);
+  updateObjectBuffers(frame, frameIndex, objects);
   f64 ssboUploadTimeMs = StopTimer(ssboUploadTimer);
   quickDebugText("Uploading SSBO data: %5.5f ms", ssboUploadTimeMs);
 
@@ -1154,77 +1393,427 @@ void VulkanEngine::drawObjects(VkCommandBuffer cmd, RenderObject* firstObject, u
   viewport.height = -viewport.y;
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
+  VkRect2D scissor = {{0, 0}, windowExtent};
 
-  vkCmdSetViewport(cmd, 0, 1, &viewport);
+  Frustum frustum = frustumFromViewProj(cameraData.viewproj);
+  cullFrustum = frustum;
+
+  quickDebugCheckbox("GPU culling", &gpuCulling);
+  if(gpuCulling) {
+    // Which objects the GPU finds visible isn't known until the frame's culling is read back in draw(), which marks
+    // the meshes used then. Until then every referenced mesh is only loaded, without keeping it from being evicted.
+    for(Mesh* mesh: referencedMeshes) {
+      meshStreamer.reference(mesh);
+    }
+
+    local_access Timer indirectCmdBufferFillTimer;
+    StartTimer(indirectCmdBufferFillTimer);
+
+    // one draw per batch regardless of how many objects are visible, not worth splitting across threads
+    VK_CHECK(vkResetCommandPool(device, frame.threadCommandPools[0], 0));
+    VkCommandBuffer drawCmd = frame.threadCommandBuffers[0];
+    VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &inheritanceInfo);
+    VK_CHECK(vkBeginCommandBuffer(drawCmd, &beginInfo));
+    vkCmdSetViewport(drawCmd, 0, 1, &viewport);
+    vkCmdSetScissor(drawCmd, 0, 1, &scissor);
+    recordIndirectDraws(drawCmd, (u32)cameraDataOffset, (u32)sceneDataOffset);
+    VK_CHECK(vkEndCommandBuffer(drawCmd));
+    outCommandBuffers[0] = drawCmd;
+
+    f64 indirectCmdBufferFillMs = StopTimer(indirectCmdBufferFillTimer);
+    quickDebugText("Filling command buffer for indirect draws: %5.5f ms (%d draws)", indirectCmdBufferFillMs, (u32)drawBatches.size());
+    return 1;
+  }
+
+  // frustum culling, only the visible objects are drawn
+  local_access Timer cullingTimer;
+  StartTimer(cullingTimer);
+  cullingSpheres.resize(objectCount);
+  for(u32 i = 0; i < objectCount; i++) {
+    cullingSpheres.set(i, objects.gpuObjects[i].modelMatrix, objects.gpuObjects[i].boundingSphere);
+  }
+  visibleObjects.resize(objectCount);
+  u32 visibleCount = cullSpheres(frustum, cullingSpheres, visibleObjects.data());
+  f64 cullingTimeMs = StopTimer(cullingTimer);
+  quickDebugText("Frustum culling: %5.5f ms (%d of %d objects visible)", cullingTimeMs, visibleCount, objectCount);
+
+  // sorted by state first and front to back within the same state, regardless of the order objects were added in
+  local_access Timer drawSortTimer;
+  StartTimer(drawSortTimer);
+  drawSortItems.resize(visibleCount);
+  f32 depthScale = 1.0f / (farPlane - nearPlane);
+  for(u32 i = 0; i < visibleCount; i++) {
+    u32 objectIndex = visibleObjects[i];
+    vec3 sphereCenter = {cullingSpheres.centerX[objectIndex], cullingSpheres.centerY[objectIndex], cullingSpheres.centerZ[objectIndex]};
+    f32 depth = (dot(sphereCenter - camera.pos, camera.forward) - nearPlane) * depthScale;
+    drawSortItems[i] = {objectSortKeys[objectIndex] | drawSortDepthKey(depth), objectIndex};
+  }
+  radixSortDrawItems(recordingWorkers, drawSortItems, drawSortScratch);
+  for(u32 i = 0; i < visibleCount; i++) {
+    visibleObjects[i] = drawSortItems[i].objectIndex;
+  }
+  f64 drawSortTimeMs = StopTimer(drawSortTimer);
+  quickDebugText("Sorting draws: %5.5f ms", drawSortTimeMs);
+
+  // Sorting put every object sharing a mesh and material next to each other, however they are spread
+  // through the scene, so each run becomes one instanced draw
+  visibleBatches.clear();
+  for(u32 i = 0; i < visibleCount; i++) {
+    u32 objectIndex = visibleObjects[i];
+    meshStreamer.request(objects.meshes[objectIndex], frameNumber);
+    Mesh* mesh = meshStreamer.drawable(objects.meshes[objectIndex]);
+    Material* material = objects.materials[objectIndex];
+    if(visibleBatches.empty() ||
+       visibleBatches.back().mesh != mesh ||
+       visibleBatches.back().material->pipeline != material->pipeline) {
+      visibleBatches.push_back({mesh, material, i, 0});
+    }
+    visibleBatches.back().objectCount++;
+  }
+  u32 batchCount = (u32)visibleBatches.size();
+
+  // the visible list is used as is for the instance to object mapping
+  memcpy(frame.instanceBuffer.mappedData, visibleObjects.data(), visibleCount * sizeof(u32));
+  vmaFlushAllocation(vmaAllocator, frame.instanceBuffer.vmaAllocation, 0, visibleCount * sizeof(u32));
 
   local_access Timer objectCmdBufferFillTimer;
   StartTimer(objectCmdBufferFillTimer);
-  Mesh* lastMesh = nullptr;
-  Material* lastMaterial = nullptr;
-  for(u32 i = 0; i < objectCount; i++) {
-    RenderObject& object = firstObject[i];
-
-    //only bind the pipeline if it doesn't match with the already bound one
-    Assert(object.material != nullptr)
-    if(object.material != lastMaterial) {
-      vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, object.material->pipeline);
-      lastMaterial = object.material;
-
-      // Note: It is only necessary to rebind descriptor sets if the desciptor layouts change between pipelines
-      // Or if the dynamic uniform buffer offset needs to be updated
-      u32 dynamicUniformOffsets[] = {(u32)cameraDataOffset, (u32)sceneDataOffset};
-
-      if(object.textureSet == VK_NULL_HANDLE) {
-        VkDescriptorSet descSets[] = {globalDescriptorSet, frame.objectDescriptorSet};
-        // vkCmdBindDescriptorSets causes the sets numbered [firstSet, firstSet+descriptorSetCount-1] to use the binding information stored in pDescriptorSets[0..descriptorSetCount-1]
-        // dynamic uniform offsets must be provided for every dynamic uniform buffer descriptor in the descriptor set(s)
-        // the dynamic offsets are ordered based firstly on the order of the descriptor set array and then on their binding index within that descriptor set
-        vkCmdBindDescriptorSets(cmd,
-                                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                object.material->pipelineLayout,
-                                0 /*first set*/,
-                                ArrayCount(descSets),
-                                descSets,
-                                ArrayCount(dynamicUniformOffsets),
-                                dynamicUniformOffsets);
-      } else {
-        VkDescriptorSet descSetsWithTex[] = {globalDescriptorSet, frame.objectDescriptorSet, object.textureSet};
-        vkCmdBindDescriptorSets(cmd,
-                                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                object.material->pipelineLayout,
-                                0 /*first set*/,
-                                ArrayCount(descSetsWithTex),
-                                descSetsWithTex,
-                                ArrayCount(dynamicUniformOffsets),
-                                dynamicUniformOffsets);
+
+  // Each thread records a contiguous range of batches into its own secondary command buffer, none of the bound state carries over between them
+  // Recording cost follows the draw count, so batches are split evenly regardless of their instance counts
+  u32 rangeCount = MAX((batchCount + MIN_DRAWS_PER_RECORDING_THREAD - 1) / MIN_DRAWS_PER_RECORDING_THREAD, 1u);
+  u32 threadCount = MIN(rangeCount, recordingWorkers.workerCount());
+  u32 batchesPerThread = (batchCount + threadCount - 1) / threadCount;
+  recordingWorkers.run(threadCount, [&](u32 thread) {
+    // the frame's fence has been waited on, so nothing recorded from this pool is still in use
+    VK_CHECK(vkResetCommandPool(device, frame.threadCommandPools[thread], 0));
+
+    VkCommandBuffer threadCmd = frame.threadCommandBuffers[thread];
+    VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &inheritanceInfo);
+    VK_CHECK(vkBeginCommandBuffer(threadCmd, &beginInfo));
+    vkCmdSetViewport(threadCmd, 0, 1, &viewport);
+    vkCmdSetScissor(threadCmd, 0, 1, &scissor);
+    u32 begin = MIN(thread * batchesPerThread, batchCount);
+    u32 end = MIN(begin + batchesPerThread, batchCount);
+    recordObjectDraws(threadCmd, visibleBatches.data() + begin, end - begin, (u32)cameraDataOffset, (u32)sceneDataOffset);
+    VK_CHECK(vkEndCommandBuffer(threadCmd));
+  });
+
+  for(u32 thread = 0; thread < threadCount; thread++) {
+    outCommandBuffers[thread] = frame.threadCommandBuffers[thread];
+  }
+
+  f64 objectCmdBufferFillMs = StopTimer(objectCmdBufferFillTimer);
+  quickDebugText("Filling command buffers for object draws: %5.5f ms (%d draws, %d threads)", objectCmdBufferFillMs, batchCount, threadCount);
+  return threadCount;
+}
+
+void VulkanEngine::updateObjectBuffers(FrameData& frame, u32 frameIndex, RenderObjectStore& objects) {
+  u32 count = objects.count();
+  Assert(count <= MAX_OBJECTS)
+
+  if(drawBatchesVersion != objects.version) {
+    // sort key ids are handed out in order of first use
+    std::unordered_map<VkPipeline, u32> materialIds; // materials sharing a pipeline share an id
+    std::unordered_map<Mesh*, u32> meshIds;
+    std::unordered_map<Mesh*, u32> referencedMeshIndices;
+    referencedMeshes.clear();
+    objectSortKeys.resize(count);
+    drawSortItems.resize(count);
+    for(u32 i = 0; i < count; i++) {
+      Mesh* referencedMesh = objects.meshes[i];
+      if(referencedMeshIndices.try_emplace(referencedMesh, (u32)referencedMeshes.size()).second) {
+        referencedMeshes.push_back(referencedMesh);
+      }
+
+      // bounds are only known once a streamed mesh has been loaded, objects added before that were never culled
+      const RenderBounds& bounds = referencedMesh->bounds;
+      if(objects.gpuObjects[i].boundingSphere.w < 0.0f && bounds.valid) {
+        objects.gpuObjects[i].boundingSphere = Vec4(bounds.origin, bounds.radius);
+        objects.markDirty(i);
+      }
+
+      // objects whose mesh is still streaming in are batched with the placeholder they are drawn as
+      u32 materialId = materialIds.try_emplace(objects.materials[i]->pipeline, (u32)materialIds.size()).first->second;
+      u32 meshId = meshIds.try_emplace(meshStreamer.drawable(referencedMesh), (u32)meshIds.size()).first->second;
+      objectSortKeys[i] = drawSortStateKey(DrawPass::Opaque, materialId, meshId);
+      drawSortItems[i] = {objectSortKeys[i], i};
+    }
+    radixSortDrawItems(recordingWorkers, drawSortItems, drawSortScratch);
+
+    // objects sharing mesh and material are adjacent once sorted, so each batch is a single run
+    drawBatches.clear();
+    for(u32 sortedIndex = 0; sortedIndex < count; sortedIndex++) {
+      u32 i = drawSortItems[sortedIndex].objectIndex;
+      Mesh* mesh = meshStreamer.drawable(objects.meshes[i]);
+      Material* material = objects.materials[i];
+      if(drawBatches.empty() ||
+         drawBatches.back().mesh != mesh ||
+         drawBatches.back().material->pipeline != material->pipeline) {
+        drawBatches.push_back({mesh, material, sortedIndex, 0});
+      }
+      drawBatches.back().objectCount++;
+      u32 drawIndex = (u32)drawBatches.size() - 1;
+      if(objects.gpuObjects[i].drawIndex != drawIndex) {
+        objects.gpuObjects[i].drawIndex = drawIndex;
+        objects.markDirty(i);
+      }
+    }
+    drawBatchesVersion = objects.version;
+  }
+
+  // only the dirty objects are copied, with adjacent ones merged into a single copy and flush
+  std::vector<u32>& dirtyObjects = objects.dirtyObjects[frameIndex];
+  if(!dirtyObjects.empty()) {
+    std::sort(dirtyObjects.begin(), dirtyObjects.end());
+    GPUObjectData* objectData = (GPUObjectData*)frame.objectBuffer.mappedData;
+    u64 rangeStart = 0;
+    while(rangeStart < dirtyObjects.size()) {
+      u64 rangeEnd = rangeStart + 1;
+      while(rangeEnd < dirtyObjects.size() && dirtyObjects[rangeEnd] == dirtyObjects[rangeEnd - 1] + 1) {
+        rangeEnd++;
       }
+      u32 firstObject = dirtyObjects[rangeStart];
+      u64 rangeSize = (rangeEnd - rangeStart) * sizeof(GPUObjectData);
+      memcpy(objectData + firstObject, objects.gpuObjects.data() + firstObject, rangeSize);
+      vmaFlushAllocation(vmaAllocator, frame.objectBuffer.vmaAllocation, firstObject * sizeof(GPUObjectData), rangeSize);
+      rangeStart = rangeEnd;
     }
 
-    //only bind the mesh if it's a different one from last bind
-    if(object.mesh != lastMesh) {
-      //bind the mesh vertex buffer with offset 0
-      VkDeviceSize offset = 0;
-      vkCmdBindVertexBuffers(cmd, 0, 1, &object.mesh->vertexBuffer.vkBuffer, &offset);
-      vkCmdBindIndexBuffer(cmd, object.mesh->indexBuffer.vkBuffer, 0, VK_INDEX_TYPE_UINT32);
-      lastMesh = object.mesh;
+    u8 frameBit = (u8)(1 << frameIndex);
+    for(u32 objectIndex: dirtyObjects) {
+      objects.dirtyFrameMasks[objectIndex] &= ~frameBit;
     }
+    dirtyObjects.clear();
+  }
 
-    // if material AND mesh are the same, use instancing where objects will be differentiated by the SSBO object data using the instance index in the shader
-    u32 drawCount = 1;
-    u32 nextIndex = i + 1;
-    while(nextIndex < objectCount &&
-          firstObject[nextIndex].material == object.material &&
-          firstObject[nextIndex].mesh == object.mesh) {
-      nextIndex++;
-      drawCount++;
+  if(frame.drawCommandsVersion != objects.version) {
+    // a batch's instances are written to the instance buffer at the batch's own object range, so batches never overlap
+    VkDrawIndexedIndirectCommand* drawCommands = (VkDrawIndexedIndirectCommand*)frame.drawCommandTemplateBuffer.mappedData;
+    for(u32 batchIndex = 0; batchIndex < (u32)drawBatches.size(); batchIndex++) {
+      const IndirectBatch& batch = drawBatches[batchIndex];
+      drawCommands[batchIndex].indexCount = batch.mesh->indexCount;
+      drawCommands[batchIndex].instanceCount = 0;
+      drawCommands[batchIndex].firstIndex = batch.mesh->firstIndex;
+      drawCommands[batchIndex].vertexOffset = (s32)batch.mesh->vertexOffset;
+      drawCommands[batchIndex].firstInstance = batch.firstInstance;
+    }
+    vmaFlushAllocation(vmaAllocator, frame.drawCommandTemplateBuffer.vmaAllocation, 0, drawBatches.size() * sizeof(VkDrawIndexedIndirectCommand));
+
+    if(drawIndirectCountSupported) {
+      // the compaction packs each run's visible draws in front of its first batch, where the count draw reads them
+      u32* drawRuns = (u32*)frame.drawRunBuffer.mappedData;
+      u32 runFirst = 0;
+      for(u32 batchIndex = 0; batchIndex < (u32)drawBatches.size(); batchIndex++) {
+        if(drawBatches[batchIndex].material->pipeline != drawBatches[runFirst].material->pipeline) {
+          runFirst = batchIndex;
+        }
+        drawRuns[batchIndex] = runFirst;
+      }
+      vmaFlushAllocation(vmaAllocator, frame.drawRunBuffer.vmaAllocation, 0, drawBatches.size() * sizeof(u32));
     }
+    frame.drawCommandsVersion = objects.version;
+  }
+}
+
+void VulkanEngine::recordCullDispatch(VkCommandBuffer cmd, const Frustum& frustum, u32 objectCount) {
+  FrameData& frame = getCurrentFrame();
+  u32 batchCount = (u32)drawBatches.size();
+  if(batchCount == 0) {
+    return;
+  }
 
-    vkCmdDrawIndexed(cmd, (u32)object.mesh->indices.size(), drawCount, 0, 0, i);
-    i += drawCount - 1;
+  VkBufferCopy templateCopy = {};
+  templateCopy.srcOffset = 0;
+  templateCopy.dstOffset = 0;
+  templateCopy.size = batchCount * sizeof(VkDrawIndexedIndirectCommand);
+  vkCmdCopyBuffer(cmd, frame.drawCommandTemplateBuffer.vkBuffer, frame.drawCommandBuffer.vkBuffer, 1, &templateCopy);
+  if(drawIndirectCountSupported) {
+    vkCmdFillBuffer(cmd, frame.drawCountBuffer.vkBuffer, 0, batchCount * sizeof(u32), 0);
   }
 
-  f64 objectCmdBufferFillMs = StopTimer(objectCmdBufferFillTimer);
-  quickDebugText("Filling command buffer for object draws: %5.5f ms", objectCmdBufferFillMs);
+  // instance counts, and draw counts, have to be zeroed before the shaders start incrementing them
+  VkBufferMemoryBarrier resetBarriers[] = {
+          vkinit::bufferMemoryBarrier(frame.drawCommandBuffer.vkBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT),
+          vkinit::bufferMemoryBarrier(frame.drawCountBuffer.vkBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT),
+  };
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                       0, nullptr,
+                       drawIndirectCountSupported ? 2 : 1, resetBarriers,
+                       0, nullptr);
+
+  // Allocated per dispatch from the frame's transient pools, which are reset once the frame's fence has signaled,
+  // so the ranges only cover this frame's objects and batches
+  VkDescriptorSet cullDescriptorSet = frame.transientDescriptors.allocate(cullDescSetLayout);
+
+  VkDescriptorBufferInfo objectDescBufferInfo;
+  objectDescBufferInfo.buffer = frame.objectBuffer.vkBuffer;
+  objectDescBufferInfo.offset = 0;
+  objectDescBufferInfo.range = objectCount * sizeof(GPUObjectData);
+
+  VkDescriptorBufferInfo drawCommandDescBufferInfo;
+  drawCommandDescBufferInfo.buffer = frame.drawCommandBuffer.vkBuffer;
+  drawCommandDescBufferInfo.offset = 0;
+  drawCommandDescBufferInfo.range = batchCount * sizeof(VkDrawIndexedIndirectCommand);
+
+  VkDescriptorBufferInfo instanceDescBufferInfo;
+  instanceDescBufferInfo.buffer = frame.instanceBuffer.vkBuffer;
+  instanceDescBufferInfo.offset = 0;
+  instanceDescBufferInfo.range = objectCount * sizeof(u32);
+
+  VkWriteDescriptorSet cullObjectWrite = vkinit::writeDescriptorBuffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, cullDescriptorSet, &objectDescBufferInfo, 0);
+  VkWriteDescriptorSet cullDrawCommandWrite = vkinit::writeDescriptorBuffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, cullDescriptorSet, &drawCommandDescBufferInfo, 1);
+  VkWriteDescriptorSet cullInstanceWrite = vkinit::writeDescriptorBuffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, cullDescriptorSet, &instanceDescBufferInfo, 2);
+  VkWriteDescriptorSet descSetWrites[] = {cullObjectWrite, cullDrawCommandWrite, cullInstanceWrite};
+  vkUpdateDescriptorSets(device, ArrayCount(descSetWrites), descSetWrites, 0/*descriptorCopyCount*/, nullptr/*pDescriptorCopies*/);
+
+  GPUCullPushConstants pushConstants;
+  memcpy(pushConstants.frustumPlanes, frustum.planes, sizeof(frustum.planes));
+  pushConstants.objectCount = objectCount;
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &cullDescriptorSet, 0, nullptr);
+  vkCmdPushConstants(cmd, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GPUCullPushConstants), &pushConstants);
+  vkCmdDispatch(cmd, (objectCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+  // the render graph orders the draws reading the commands and instances after the dispatch
+
+  // The instance counts say which batches had anything visible, that is what keeps their meshes from being evicted
+  // and, with drawIndirectCount, which draws the compaction keeps
+  VkBufferMemoryBarrier cullBarrier = vkinit::bufferMemoryBarrier(frame.drawCommandBuffer.vkBuffer, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                       0, nullptr,
+                       1, &cullBarrier,
+                       0, nullptr);
+
+  if(drawIndirectCountSupported) {
+    VkDescriptorSet compactDrawsDescriptorSet = frame.transientDescriptors.allocate(compactDrawsDescSetLayout);
+
+    VkDescriptorBufferInfo drawRunDescBufferInfo;
+    drawRunDescBufferInfo.buffer = frame.drawRunBuffer.vkBuffer;
+    drawRunDescBufferInfo.offset = 0;
+    drawRunDescBufferInfo.range = batchCount * sizeof(u32);
+
+    VkDescriptorBufferInfo drawCountDescBufferInfo;
+    drawCountDescBufferInfo.buffer = frame.drawCountBuffer.vkBuffer;
+    drawCountDescBufferInfo.offset = 0;
+    drawCountDescBufferInfo.range = batchCount * sizeof(u32);
+
+    VkDescriptorBufferInfo compactedDrawCommandDescBufferInfo;
+    compactedDrawCommandDescBufferInfo.buffer = frame.compactedDrawCommandBuffer.vkBuffer;
+    compactedDrawCommandDescBufferInfo.offset = 0;
+    compactedDrawCommandDescBufferInfo.range = batchCount * sizeof(VkDrawIndexedIndirectCommand);
+
+    VkWriteDescriptorSet compactDrawCommandWrite = vkinit::writeDescriptorBuffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, compactDrawsDescriptorSet, &drawCommandDescBufferInfo, 0);
+    VkWriteDescriptorSet compactDrawRunWrite = vkinit::writeDescriptorBuffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, compactDrawsDescriptorSet, &drawRunDescBufferInfo, 1);
+    VkWriteDescriptorSet compactDrawCountWrite = vkinit::writeDescriptorBuffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, compactDrawsDescriptorSet, &drawCountDescBufferInfo, 2);
+    VkWriteDescriptorSet compactedDrawCommandWrite = vkinit::writeDescriptorBuffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, compactDrawsDescriptorSet, &compactedDrawCommandDescBufferInfo, 3);
+    VkWriteDescriptorSet compactDescSetWrites[] = {compactDrawCommandWrite, compactDrawRunWrite, compactDrawCountWrite, compactedDrawCommandWrite};
+    vkUpdateDescriptorSets(device, ArrayCount(compactDescSetWrites), compactDescSetWrites, 0/*descriptorCopyCount*/, nullptr/*pDescriptorCopies*/);
+
+    GPUCompactDrawsPushConstants compactPushConstants;
+    compactPushConstants.batchCount = batchCount;
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, compactDrawsPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, compactDrawsPipelineLayout, 0, 1, &compactDrawsDescriptorSet, 0, nullptr);
+    vkCmdPushConstants(cmd, compactDrawsPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GPUCompactDrawsPushConstants), &compactPushConstants);
+    vkCmdDispatch(cmd, (batchCount + COMPACT_DRAWS_WORKGROUP_SIZE - 1) / COMPACT_DRAWS_WORKGROUP_SIZE, 1, 1);
+    // like the cull dispatch, the render graph orders the count draws after this
+  }
+
+  vkCmdCopyBuffer(cmd, frame.drawCommandBuffer.vkBuffer, frame.drawCommandReadbackBuffer.vkBuffer, 1, &templateCopy);
+  VkBufferMemoryBarrier readbackBarrier = vkinit::bufferMemoryBarrier(frame.drawCommandReadbackBuffer.vkBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT);
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                       0, nullptr,
+                       1, &readbackBarrier,
+                       0, nullptr);
+
+  frame.readbackBatchMeshes.resize(batchCount);
+  for(u32 batchIndex = 0; batchIndex < batchCount; batchIndex++) {
+    frame.readbackBatchMeshes[batchIndex] = drawBatches[batchIndex].mesh;
+  }
+}
+
+void VulkanEngine::recordIndirectDraws(VkCommandBuffer cmd, u32 cameraDataOffset, u32 sceneDataOffset) {
+  FrameData& frame = getCurrentFrame();
+
+  const u32 stride = sizeof(VkDrawIndexedIndirectCommand);
+  const u32 batchCount = (u32)drawBatches.size();
+  const IndirectBatch* previousBatch = nullptr;
+  u32 runFirst = 0;
+  while(runFirst < batchCount) {
+    // a run is the consecutive batches sharing a pipeline, the sorting by material keeps them together
+    const IndirectBatch& batch = drawBatches[runFirst];
+    u32 runEnd = runFirst + 1;
+    while(runEnd < batchCount && drawBatches[runEnd].material->pipeline == batch.material->pipeline) {
+      runEnd++;
+    }
+    bindBatchState(cmd, batch, previousBatch, cameraDataOffset, sceneDataOffset);
+    previousBatch = &batch;
+
+    if(drawIndirectCountSupported) {
+      // only the run's draws with visible instances, packed to its front by the compaction, the order within it varies
+      vkCmdDrawIndexedIndirectCount(cmd, frame.compactedDrawCommandBuffer.vkBuffer, runFirst * stride,
+                                    frame.drawCountBuffer.vkBuffer, runFirst * sizeof(u32),
+                                    runEnd - runFirst, stride);
+    } else if(multiDrawIndirectSupported) {
+      // batches without a visible object are left to the GPU as draws with zero instances
+      u32 maxDrawCount = gpuProperties.limits.maxDrawIndirectCount;
+      for(u32 drawFirst = runFirst; drawFirst < runEnd; drawFirst += maxDrawCount) {
+        vkCmdDrawIndexedIndirect(cmd, frame.drawCommandBuffer.vkBuffer, drawFirst * stride, MIN(runEnd - drawFirst, maxDrawCount), stride);
+      }
+    } else {
+      for(u32 batchIndex = runFirst; batchIndex < runEnd; batchIndex++) {
+        vkCmdDrawIndexedIndirect(cmd, frame.drawCommandBuffer.vkBuffer, batchIndex * stride, 1, stride);
+      }
+    }
+    runFirst = runEnd;
+  }
+}
+
+void VulkanEngine::recordObjectDraws(VkCommandBuffer cmd, const IndirectBatch* batches, u32 batchCount, u32 cameraDataOffset, u32 sceneDataOffset) {
+  const IndirectBatch* previousBatch = nullptr;
+  for(u32 batchIndex = 0; batchIndex < batchCount; batchIndex++) {
+    const IndirectBatch& batch = batches[batchIndex];
+    bindBatchState(cmd, batch, previousBatch, cameraDataOffset, sceneDataOffset);
+    previousBatch = &batch;
+
+    // objects are differentiated by the SSBO object data the vertex shader finds through the instance index
+    vkCmdDrawIndexed(cmd, batch.mesh->indexCount, batch.objectCount, batch.mesh->firstIndex, (s32)batch.mesh->vertexOffset, batch.firstInstance);
+  }
+}
+
+void VulkanEngine::bindBatchState(VkCommandBuffer cmd, const IndirectBatch& batch, const IndirectBatch* previousBatch, u32 cameraDataOffset, u32 sceneDataOffset) {
+  FrameData& frame = getCurrentFrame();
+
+  //only bind the pipeline if it doesn't match with the already bound one
+  Assert(batch.material != nullptr)
+  bool pipelineChanged = previousBatch == nullptr || batch.material->pipeline != previousBatch->material->pipeline;
+  if(pipelineChanged) {
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, batch.material->pipeline);
+  }
+
+  // Every material's pipeline layout is created from the same set layouts, so sets stay bound across pipeline changes
+  // and the bindless texture set means no batch needs sets of its own
+  if(previousBatch == nullptr) {
+    // vkCmdBindDescriptorSets causes the sets numbered [firstSet, firstSet+descriptorSetCount-1] to use the binding information stored in pDescriptorSets[0..descriptorSetCount-1]
+    // dynamic uniform offsets must be provided for every dynamic uniform buffer descriptor in the descriptor set(s)
+    // the dynamic offsets are ordered based firstly on the order of the descriptor set array and then on their binding index within that descriptor set
+    u32 dynamicUniformOffsets[] = {cameraDataOffset, sceneDataOffset};
+    VkDescriptorSet descSets[] = {globalDescriptorSet, frame.objectDescriptorSet, bindlessTextures.descriptorSet};
+    vkCmdBindDescriptorSets(cmd,
+                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            batch.material->pipelineLayout,
+                            0 /*first set*/,
+                            ArrayCount(descSets),
+                            descSets,
+                            ArrayCount(dynamicUniformOffsets),
+                            dynamicUniformOffsets);
+
+    // every mesh lives in the geometry arena, the draws pick theirs with firstIndex and vertexOffset
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmd, 0, 1, &geometryArena.vertexBuffer.vkBuffer, &offset);
+    vkCmdBindIndexBuffer(cmd, geometryArena.indexBuffer.vkBuffer, 0, VK_INDEX_TYPE_UINT32);
+  }
 }
 
 void VulkanEngine::startImguiFrame() {
@@ -1270,35 +1859,76 @@ void VulkanEngine::loadImages() {
   // Note: Currently just loading all textures, not sustainable in long run
   BakedAssetData* bakedTextures = (BakedAssetData*)(&bakedTextureAssetData);
   u32 textureCount = bakedTextureAssetCount();
-  std::vector<AllocatedImage> allocatedImageTextures;
-  allocatedImageTextures.resize(textureCount);
-  std::vector<const char*> filePaths;
-  filePaths.resize(textureCount);
 
+  // Identical textures are baked to a single content addressed file, each file is loaded once and shared by its aliases
+  std::unordered_map<std::string, u32> uniqueTextureIndices;
+  std::vector<u32> aliasToUniqueTexture(textureCount);
+  std::vector<const char*> filePaths;
   for(u32 i = 0; i < textureCount; i++) {
-    filePaths[i] = bakedTextures[i].filePath;
+    auto [uniqueTextureIter, inserted] = uniqueTextureIndices.emplace(bakedTextures[i].filePath, (u32)filePaths.size());
+    if(inserted) { filePaths.push_back(bakedTextures[i].filePath); }
+    aliasToUniqueTexture[i] = uniqueTextureIter->second;
   }
+  u32 uniqueTextureCount = (u32)filePaths.size();
 
-  vkutil::loadImagesFromAssetFiles(vmaAllocator, uploadContext, filePaths.data(), allocatedImageTextures.data(), textureCount);
-
-  for(u32 i = 0; i < textureCount; i++) {
-    const BakedAssetData& bakedTextureData = bakedTextures[i];
-
-    Texture tex{};
+  std::vector<AllocatedImage> allocatedImageTextures;
+  allocatedImageTextures.resize(uniqueTextureCount);
+  vkutil::loadImagesFromAssetFiles(vmaAllocator, uploadManager, assetReader, filePaths.data(), allocatedImageTextures.data(), uniqueTextureCount);
+  uploadManager.flush();
+
+  std::vector<Texture> uniqueTextures;
+  uniqueTextures.resize(uniqueTextureCount);
+  for(u32 i = 0; i < uniqueTextureCount; i++) {
+    Texture& tex = uniqueTextures[i];
+    tex = {};
     tex.image = allocatedImageTextures[i];
+    if(tex.image.vkImage == VK_NULL_HANDLE) { continue; }
     VkImageViewCreateInfo imageCreateInfo = vkinit::imageViewCreateInfo(tex.image.vkFormat, tex.image.vkImage, VK_IMAGE_ASPECT_COLOR_BIT);
+    imageCreateInfo.subresourceRange.levelCount = tex.image.mipLevels;
     vkCreateImageView(device, &imageCreateInfo, nullptr, &tex.imageView);
+    tex.bindlessIndex = bindlessTextures.addTexture(tex.imageView);
+  }
 
-    loadedTextures[bakedTextureData.name] = tex;
+  loadedTextures.resize(textureCount);
+  for(u32 i = 0; i < textureCount; i++) {
+    loadedTextures[i] = uniqueTextures[aliasToUniqueTexture[i]];
   }
+  std::cout << "Loaded " << uniqueTextureCount << " unique textures for " << textureCount << " baked textures" << std::endl;
 
+  // aliases share handles, so the unique textures are destroyed rather than each entry of loadedTextures
   mainDeletionQueue.pushFunction([=]() {
-    for(u32 i = 0; i < textureCount; i++) {
-      const BakedAssetData& bakedTextureData = bakedTextures[i];
-      Texture texture = loadedTextures[bakedTextureData.name];
+    for(const Texture& texture: uniqueTextures) {
       vkDestroyImageView(device, texture.imageView, nullptr);
       vmaDestroyImage(vmaAllocator, texture.image.vkImage, texture.image.vmaAllocation);
-      loadedTextures.erase(bakedTextureData.name);
     }
+    loadedTextures.clear();
   });
 }
+
+void VulkanEngine::loadMaterials() {
+  BakedAssetData* bakedMaterials = (BakedAssetData*)(&bakedMaterialAssetData);
+  u32 materialCount = bakedMaterialAssetCount();
+
+  std::vector<std::future<assets::MaterialRecord>> records;
+  records.resize(materialCount);
+  for(u32 i = 0; i < materialCount; i++) {
+    records[i] = assetReader.readAssetFile<assets::MaterialRecord>(bakedMaterials[i].filePath, [](bool success, assets::AssetFile& assetFile) {
+      assets::MaterialRecord record = assets::defaultMaterialRecord();
+      if(success) { assets::readMaterialRecord(assetFile, &record); }
+      return record;
+    });
+  }
+
+  materialRecords.resize(materialCount);
+  for(u32 i = 0; i < materialCount; i++) {
+    materialRecords[i] = records[i].get();
+  }
+}
+
+const Texture* VulkanEngine::getMaterialTexture(u32 materialIndex, assets::MaterialTextureSlot slot) {
+  u32 textureIndex = materialRecords[materialIndex].textureIndices[(u32)slot];
+  if(textureIndex == MATERIAL_NO_TEXTURE || textureIndex >= loadedTextures.size() || loadedTextures[textureIndex].image.vkImage == VK_NULL_HANDLE) {
+    return nullptr;
+  }
+  return &loadedTextures[textureIndex];
+}
@@ -2,6 +2,8 @@
 
 const u32 FRAME_OVERLAP = 2;
 
+#define MAX_RECORDING_THREADS 8 // upper bound on threads recording object draws in parallel
+
 #define DEFAULT_WINDOW_WIDTH 1920
 #define DEFAULT_WINDOW_HEIGHT 1080
 
@@ -10,18 +12,105 @@ struct Material {
   VkPipelineLayout pipelineLayout;
 };
 
+// Description of a render object, added to a RenderObjectStore to be drawn
 struct RenderObject {
   Mesh* mesh;
   Material* material;
   const char* materialName;
-  VkDescriptorSet textureSet{VK_NULL_HANDLE}; //texture defaulted to null
+  u32 textureIndex{0}; // into the bindless texture array, only read by textured materials
+  u32 samplerIndex{0}; // into the bindless sampler array
   mat4 modelMatrix;
   vec4 defaultColor;
 };
 
+// Flattened hierarchy, parents always precede children (see prefab_asset.h)
+struct Prefab {
+  std::vector<s32> nodeParents;
+  std::vector<mat4> nodeMatrices;
+  // only nodes with a loaded mesh produce render objects
+  std::vector<u32> meshNodes;
+  std::vector<Mesh*> meshNodeMeshes;
+  std::vector<u32> meshNodeMaterials; // BakedMaterialIndex of each mesh node, U32_MAX if it has no baked material
+};
+
 struct GPUObjectData {
   mat4 modelMatrix;
   vec4 defaultColor;
+  vec4 boundingSphere; // xyz: object space center, w: radius, negative for objects that are never culled
+  u32 drawIndex; // IndirectBatch this object is drawn by
+  u32 textureIndex; // bindless texture and sampler the fragment shader samples with
+  u32 samplerIndex;
+  u32 padding; // std140 rounds the struct up to a multiple of 16 bytes
+};
+
+// Render objects split by who reads them. gpuObjects is laid out exactly like the object buffer so uploading it is
+// a single copy, everything only the CPU reads lives in the parallel cold arrays.
+struct RenderObjectStore {
+  std::vector<GPUObjectData> gpuObjects;
+
+  std::vector<Mesh*> meshes;
+  std::vector<Material*> materials;
+  std::vector<const char*> materialNames;
+
+  // Each frame in flight has its own object buffer, so a changed object stays dirty until every one of them has a copy
+  std::vector<u8> dirtyFrameMasks; // bit per frame in flight that hasn't received the object's gpuObjects entry yet
+  std::vector<u32> dirtyObjects[FRAME_OVERLAP]; // unordered, no duplicates
+
+  u32 version = 0; // bumped whenever objects are added or their mesh or material changes
+
+  u32 count() const { return (u32)gpuObjects.size(); }
+
+  void markDirty(u32 index) {
+    for(u32 frame = 0; frame < FRAME_OVERLAP; frame++) {
+      u8 frameBit = (u8)(1 << frame);
+      if(!(dirtyFrameMasks[index] & frameBit)) {
+        dirtyFrameMasks[index] |= frameBit;
+        dirtyObjects[frame].push_back(index);
+      }
+    }
+  }
+
+  void setModelMatrix(u32 index, const mat4& modelMatrix) {
+    gpuObjects[index].modelMatrix = modelMatrix;
+    markDirty(index);
+  }
+
+  u32 add(const RenderObject& object) {
+    const RenderBounds& bounds = object.mesh->bounds;
+    GPUObjectData gpuObject = {};
+    gpuObject.modelMatrix = object.modelMatrix;
+    gpuObject.defaultColor = object.defaultColor;
+    gpuObject.boundingSphere = bounds.valid ? Vec4(bounds.origin, bounds.radius) : vec4{0.0f, 0.0f, 0.0f, -1.0f};
+    gpuObject.textureIndex = object.textureIndex;
+    gpuObject.samplerIndex = object.samplerIndex;
+    gpuObjects.push_back(gpuObject);
+
+    meshes.push_back(object.mesh);
+    materials.push_back(object.material);
+    materialNames.push_back(object.materialName);
+    dirtyFrameMasks.push_back(0);
+    markDirty(count() - 1);
+    version++;
+    return count() - 1;
+  }
+};
+
+// Renderables sharing a mesh and material, drawn by a single instanced draw
+// Their object indices fill [firstInstance, firstInstance + objectCount) of the instance buffer
+struct IndirectBatch {
+  Mesh* mesh;
+  Material* material;
+  u32 firstInstance; // start of the batch's range in the instance buffer
+  u32 objectCount;
+};
+
+struct GPUCullPushConstants {
+  vec4 frustumPlanes[6];
+  u32 objectCount;
+};
+
+struct GPUCompactDrawsPushConstants {
+  u32 batchCount;
 };
 
 struct GPUCameraData {
@@ -43,11 +132,32 @@ struct FrameData {
   VkFence renderFence;
 
   VkCommandPool commandPool;
-  VkCommandBuffer mainCommandBuffer;
+  VkCommandBuffer mainCommandBuffer; // the render graph records into it and executes the secondary command buffers
+  VkCommandBuffer backgroundCommandBuffer; // secondary
+  VkCommandBuffer imguiCommandBuffer; // secondary
+
+  // each recording thread has its own pool, as pools can't be used from two threads at once
+  VkCommandPool threadCommandPools[MAX_RECORDING_THREADS];
+  VkCommandBuffer threadCommandBuffers[MAX_RECORDING_THREADS]; // secondary
 
   // shader storage buffer
   AllocatedBuffer objectBuffer;
+  AllocatedBuffer instanceBuffer; // object index of each drawn instance, vertex shaders read objectBuffer through it
   VkDescriptorSet objectDescriptorSet;
+  u32 drawCommandsVersion; // renderables.version that drawCommandTemplateBuffer was last written for
+
+  // GPU culling
+  AllocatedBuffer drawCommandBuffer; // VkDrawIndexedIndirectCommand per IndirectBatch, instance counts are filled in by the cull shader
+  AllocatedBuffer drawCommandTemplateBuffer; // the same commands with no instances, copied over drawCommandBuffer before culling
+  AllocatedBuffer drawCommandReadbackBuffer; // drawCommandBuffer copied back after culling, read once the frame's fence has signaled
+  std::vector<Mesh*> readbackBatchMeshes; // mesh of each batch in drawCommandReadbackBuffer, empty when nothing was culled
+  // only used with drawIndirectCount, a run is the consecutive batches sharing a pipeline
+  AllocatedBuffer drawRunBuffer; // u32 per batch, the first batch of its run, written along with drawCommandTemplateBuffer
+  AllocatedBuffer drawCountBuffer; // u32 per batch, the number of compacted commands of the run starting at that batch
+  AllocatedBuffer compactedDrawCommandBuffer; // commands of batches with visible instances, each run's from its first batch's slot on
+
+  // sets that only live for one frame, like the cull dispatch's, taken back all at once when the frame's fence has signaled
+  DescriptorAllocator transientDescriptors;
 };
 
 class VulkanEngine {
@@ -78,6 +188,9 @@ public:
   VkDevice device; // Vulkan device for commands
   VkSurfaceKHR surface; // Vulkan window surface
   VkPhysicalDeviceProperties gpuProperties;
+  bool multiDrawIndirectSupported;
+  bool drawIndirectCountSupported; // multiDrawIndirect included
+  VkPipelineCache pipelineCache; // shared by all pipeline creation, persisted to disk between runs
   VkSwapchainKHR swapchain;
   VkFormat swapchainImageFormat;
   std::vector<VkImage> swapchainImages;
@@ -86,8 +199,10 @@ public:
   VkQueue graphicsQueue; //queue we will submit to
   uint32_t graphicsQueueFamily; //family of that queue
 
-  VkRenderPass renderPass;
-  std::vector<VkFramebuffer> framebuffers;
+  // Rebuilt along with the swap chain, see initRenderGraph()
+  RenderGraph renderGraph;
+  RenderGraphPass cullPass, backgroundPass, objectsPass, imguiPass;
+  VkRenderPass renderPass; // the objects pass's, every pipeline and ImGui are created against it
 
   FrameData frames[FRAME_OVERLAP];
 
@@ -95,28 +210,56 @@ public:
 
   VmaAllocator vmaAllocator;
 
-  VkImageView depthImageView;
-  AllocatedImage depthImage;
   VkFormat depthFormat;
 
   //default array of renderable objects
-  std::vector<RenderObject> renderables;
+  RenderObjectStore renderables;
+  CullingSpheres cullingSpheres; // scratch space for drawObjects(), one per renderable
+  std::vector<u32> visibleObjects; // indices into renderables that survived culling this frame
+  std::vector<IndirectBatch> drawBatches;
+  std::vector<Mesh*> referencedMeshes; // every mesh a renderable uses, each once, built along with drawBatches
+  std::vector<u64> objectSortKeys; // state fields of each renderable's draw sort key, built along with drawBatches
+  u32 drawBatchesVersion{U32_MAX}; // renderables.version drawBatches were built for
+  std::vector<DrawSortItem> drawSortItems; // scratch space for sorting draws
+  std::vector<IndirectBatch> visibleBatches; // one per unique state among this frame's visible objects, when culling on the CPU
+  std::vector<DrawSortItem> drawSortScratch;
+  bool gpuCulling{true}; // cull and build draws in a compute pass instead of on the CPU
+  Frustum cullFrustum; // this frame's, for the cull pass
+  VkCommandBuffer objectCommandBuffers[MAX_RECORDING_THREADS]; // this frame's secondaries for the objects pass
+  u32 objectCommandBufferCount{0};
 
   MaterialManager materialManager;
+  DescriptorSetLayoutCache descSetLayoutCache;
+  PipelineLayoutCache pipelineLayoutCache;
+  PipelineStateCache pipelineStateCache; // cleared along with the render pass, see destroyPipelines()
+  assets::AsyncAssetReader assetReader;
+  WorkerPool recordingWorkers;
 
   std::unordered_map<std::string, Material> materials;
-  std::unordered_map<std::string, Mesh> meshes;
-  std::unordered_map<std::string, Texture> loadedTextures;
+  GeometryArena geometryArena; // vertices and indices of every resident mesh, sized by the mesh residency budget
+  MeshStreamer meshStreamer; // one Mesh per unique baked mesh file, loaded when first drawn
+  std::unordered_map<std::string, Mesh*> meshes; // aliases of identical meshes point at the same Mesh
+  std::unordered_map<std::string, Prefab> prefabs;
+  std::vector<mat4> prefabWorldMatrices; // scratch space for instantiatePrefab()
+  std::vector<Texture> loadedTextures; // indexed by BakedTextureIndex, textures that failed to load have null handles
+  std::vector<assets::MaterialRecord> materialRecords; // indexed by BakedMaterialIndex
 
   VkPipeline fragmentShaderPipeline;
   VkPipelineLayout fragmentShaderPipelineLayout;
 
+  VkPipeline cullPipeline;
+  VkPipelineLayout cullPipelineLayout;
+  VkPipeline compactDrawsPipeline;
+  VkPipelineLayout compactDrawsPipelineLayout;
+
   Camera camera;
 
+  // owned by descSetLayoutCache, like every pipeline layout is owned by pipelineLayoutCache
   VkDescriptorSetLayout globalDescSetLayout;
   VkDescriptorSetLayout objectDescSetLayout;
-  VkDescriptorSetLayout singleTextureSetLayout;
-  VkDescriptorPool descriptorPool;
+  VkDescriptorSetLayout cullDescSetLayout;
+  VkDescriptorSetLayout compactDrawsDescSetLayout;
+  DescriptorAllocator descriptorAllocator; // sets that live as long as the engine
 
   VkDescriptorSet globalDescriptorSet;
   // a single dynamic uniform buffer used for all frames
@@ -140,7 +283,9 @@ public:
           materialTextured
   };
 
-  UploadContext uploadContext;
+  UploadManager uploadManager;
+  u64 startupUploadValue = 0; // covers the textures and the placeholder mesh, streamed meshes are only drawn once their own upload is complete
+  BindlessTextures bindlessTextures; // every loaded texture and sampler, bound as descriptor set 2
 
   struct {
     bool showGeneralDebugText;
@@ -153,19 +298,20 @@ public:
 private:
 
   void initSDL();
+  void initAssetIO();
 
   void initImgui();
 
   void initVulkan();
   void initSwapchain();
   void initCommands();
-  void initDefaultRenderpass();
-  void initFramebuffers();
+  void initRenderGraph(); // declares the frame's passes against the current swap chain and compiles them
   void initSyncStructures();
   void initDescriptors();
   void createPipeline(MaterialCreateInfo matInfo);
   void initPipelines();
   void createFragmentShaderPipeline();
+  void initComputePipelines(); // compute pipelines don't depend on the swap chain and are only created once
 
   void processInput();
 
@@ -174,18 +320,39 @@ private:
   void initScene();
   void initCamera();
 
-  void cleanupSwapChain();
+  void cleanupSwapChain(); // only what depends on the swap chain images or window size
   void recreateSwapChain();
+  void destroyPipelines();
 
   void loadImages();
+  void loadMaterials();
+  // nullptr if the material leaves the slot empty or its texture failed to load
+  const Texture* getMaterialTexture(u32 materialIndex, assets::MaterialTextureSlot slot);
   void loadMeshes();
   Mesh* getMesh(const std::string& name); //returns nullptr if it can't be found
 
+  void loadPrefabs();
+  Prefab* getPrefab(const std::string& name); //returns nullptr if it can't be found
+  // Appends a render object for every mesh node, objectTemplate supplies everything but the mesh and model matrix
+  // Nodes with a baked material take their color and base color texture from its record instead
+  void instantiatePrefab(const Prefab& prefab, const mat4& transform, const RenderObject& objectTemplate);
+
   Material* createMaterial(VkPipeline pipeline, VkPipelineLayout layout, const char* name); //create material and add it to the map
   Material* getMaterial(const char* name); //returns nullptr if it can't be found
 
   void drawFragmentShader(VkCommandBuffer cmd);
-  void drawObjects(VkCommandBuffer cmd, RenderObject* first, u32 count);
+  // Records into one secondary command buffer per recording thread, returns how many were written to outCommandBuffers
+  // With gpuCulling the draws depend on the dispatch the cull pass records later, from cullFrustum
+  u32 drawObjects(const VkCommandBufferInheritanceInfo& inheritanceInfo, RenderObjectStore& objects, VkCommandBuffer* outCommandBuffers);
+  // Copies the objects that changed since this frame's buffers were last written, and the draw commands if batches changed
+  void updateObjectBuffers(FrameData& frame, u32 frameIndex, RenderObjectStore& objects);
+  void recordCullDispatch(VkCommandBuffer cmd, const Frustum& frustum, u32 objectCount);
+  void recordIndirectDraws(VkCommandBuffer cmd, u32 cameraDataOffset, u32 sceneDataOffset);
+  // One instanced draw per batch, the instances are read from the instance buffer at each batch's firstInstance
+  void recordObjectDraws(VkCommandBuffer cmd, const IndirectBatch* batches, u32 batchCount, u32 cameraDataOffset, u32 sceneDataOffset);
+  // Binds the pipeline of batch if it differs from previousBatch's
+  // previousBatch is null when nothing is bound yet, the descriptor sets and the geometry arena's buffers are bound then too
+  void bindBatchState(VkCommandBuffer cmd, const IndirectBatch& batch, const IndirectBatch* previousBatch, u32 cameraDataOffset, u32 sceneDataOffset);
 
   void startImguiFrame();
   void renderImgui(VkCommandBuffer cmd);
@@ -196,4 +363,5 @@ private:
   // Not for anything but messily pushing info or adjusting values
   void quickDebugFloat(const char* label, float* v, float v_min, float v_max, const char* format = "%.3f", ImGuiSliderFlags flags = 0) const;
   void quickDebugText(const char* fmt, ...) const;
+  void quickDebugCheckbox(const char* label, bool* v) const;
 };
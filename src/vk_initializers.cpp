@@ -177,15 +177,29 @@ VkRenderPassBeginInfo vkinit::renderPassBeginInfo(VkRenderPass renderPass, VkExt
   return info;
 }
 
-VkCommandBufferBeginInfo vkinit::commandBufferBeginInfo(VkCommandBufferUsageFlags usageFlags) {
+VkCommandBufferBeginInfo vkinit::commandBufferBeginInfo(VkCommandBufferUsageFlags usageFlags, const VkCommandBufferInheritanceInfo* inheritanceInfo) {
   VkCommandBufferBeginInfo cmdBeginInfo;
   cmdBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
   cmdBeginInfo.pNext = nullptr;
-  cmdBeginInfo.pInheritanceInfo = nullptr;
+  cmdBeginInfo.pInheritanceInfo = inheritanceInfo; // only read for secondary command buffers
   cmdBeginInfo.flags = usageFlags;
   return cmdBeginInfo;
 }
 
+// Secondary command buffers that execute within a render pass must name the render pass and subpass they will be executed in
+VkCommandBufferInheritanceInfo vkinit::commandBufferInheritanceInfo(VkRenderPass renderPass, u32 subpass, VkFramebuffer framebuffer) {
+  VkCommandBufferInheritanceInfo info = {};
+  info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  info.pNext = nullptr;
+  info.renderPass = renderPass;
+  info.subpass = subpass;
+  info.framebuffer = framebuffer; // optional, but may allow the driver to optimize
+  info.occlusionQueryEnable = VK_FALSE;
+  info.queryFlags = 0;
+  info.pipelineStatistics = 0;
+  return info;
+}
+
 VkSubmitInfo vkinit::submitInfo(VkCommandBuffer* cmd) {
   VkSubmitInfo info = {};
   info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -271,3 +285,17 @@ VkSamplerCreateInfo vkinit::samplerCreateInfo(VkFilter filters, VkSamplerAddress
 
   return info;
 }
+
+VkBufferMemoryBarrier vkinit::bufferMemoryBarrier(VkBuffer buffer, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask) {
+  VkBufferMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.pNext = nullptr;
+  barrier.srcAccessMask = srcAccessMask;
+  barrier.dstAccessMask = dstAccessMask;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED; // no ownership transfer
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = buffer;
+  barrier.offset = 0;
+  barrier.size = VK_WHOLE_SIZE;
+  return barrier;
+}
@@ -17,7 +17,8 @@ namespace vkinit {
   VkImageViewCreateInfo imageViewCreateInfo(VkFormat format, VkImage image, VkImageAspectFlags aspectFlags);
   VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo(bool bDepthTest, bool bDepthWrite, VkCompareOp compareOp);
   VkRenderPassBeginInfo renderPassBeginInfo(VkRenderPass renderPass, VkExtent2D windowExtent, VkFramebuffer framebuffer);
-  VkCommandBufferBeginInfo commandBufferBeginInfo(VkCommandBufferUsageFlags usageFlags = 0);
+  VkCommandBufferBeginInfo commandBufferBeginInfo(VkCommandBufferUsageFlags usageFlags = 0, const VkCommandBufferInheritanceInfo* inheritanceInfo = nullptr);
+  VkCommandBufferInheritanceInfo commandBufferInheritanceInfo(VkRenderPass renderPass, u32 subpass, VkFramebuffer framebuffer);
   VkSubmitInfo submitInfo(VkCommandBuffer* cmd);
   VkDescriptorSetLayoutBinding descriptorSetLayoutBinding(VkDescriptorType descriptorType, VkShaderStageFlags pipelineStageFlags, u32 bindingIndex);
   VkWriteDescriptorSet writeDescriptorBuffer(VkDescriptorType descriptorType, VkDescriptorSet descriptorSet, VkDescriptorBufferInfo* bufferInfo, u32 bindingIndex);
@@ -25,6 +26,7 @@ namespace vkinit {
   VkSemaphoreCreateInfo semaphoreCreateInfo();
   VkWriteDescriptorSet writeDescriptorImage(VkDescriptorType type, VkDescriptorSet dstSet, VkDescriptorImageInfo* imageInfo, u32 binding);
   VkSamplerCreateInfo samplerCreateInfo(VkFilter filters, VkSamplerAddressMode samplerAddressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT);
+  VkBufferMemoryBarrier bufferMemoryBarrier(VkBuffer buffer, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask);
 
 }
 
@@ -45,17 +45,75 @@ VertexInputDescription Vertex::getVertexDescriptions() {
 
 bool Mesh::loadFromAsset(const char* fileName) {
   assets::AssetFile assetFile{};
-  assets::loadAssetFile(fileName, &assetFile);
+  if(!assets::loadAssetFile(fileName, &assetFile)) {
+    std::cout << "Failed to load mesh: " << fileName << std::endl;
+    return false;
+  }
+  return loadFromAssetFile(assetFile);
+}
 
-  assets::MeshInfo meshInfo{};
-  assets::readMeshInfo(assetFile, &meshInfo);
+internal_access void convertAssetVertex(const assets::Vertex_PNCV_f32& assetVertex, Vertex& newVertex) {
+  newVertex.position = {
+          assetVertex.position[0],
+          assetVertex.position[1],
+          assetVertex.position[2]
+  };
+
+  newVertex.normal = {
+          assetVertex.normal[0],
+          assetVertex.normal[1],
+          assetVertex.normal[2]
+  };
+
+  newVertex.color = {
+          assetVertex.color[0],
+          assetVertex.color[1],
+          assetVertex.color[2]
+  };
+
+  newVertex.uv = {
+          assetVertex.uv[0],
+          assetVertex.uv[1]
+  };
+}
 
-  std::vector<char> tmpVertexBuffer;
-  tmpVertexBuffer.resize(meshInfo.vertexBufferSize);
+internal_access void convertAssetVertex(const assets::Vertex_P32N8C8V16& assetVertex, Vertex& newVertex) {
+  newVertex.position = {
+          assetVertex.position[0],
+          assetVertex.position[1],
+          assetVertex.position[2]
+  };
+
+  newVertex.normal = {
+          (f32)assetVertex.normal[0],
+          (f32)assetVertex.normal[1],
+          (f32)assetVertex.normal[2]
+  };
+
+  newVertex.color = {
+          (f32)assetVertex.color[0],
+          (f32)assetVertex.color[1],
+          (f32)assetVertex.color[2]
+  };
+
+  newVertex.uv = {
+          assetVertex.uv[0],
+          assetVertex.uv[1]
+  };
+}
 
-  indices.resize(meshInfo.indexBufferSize / sizeof(u32));
+bool Mesh::loadFromAssetFile(const assets::AssetFile& assetFile) {
+  assets::MeshInfo meshInfo{};
+  assets::readMeshInfo(assetFile, &meshInfo);
 
-  assets::unpackMesh(meshInfo, assetFile.binaryBlob.data(), assetFile.binaryBlob.size(), tmpVertexBuffer.data(), (char*)indices.data());
+  u64 assetVertexSize;
+  if(meshInfo.vertexFormat == assets::VertexFormat::PNCV_F32) {
+    assetVertexSize = sizeof(assets::Vertex_PNCV_f32);
+  } else if(meshInfo.vertexFormat == assets::VertexFormat::P32N8C8V16) {
+    assetVertexSize = sizeof(assets::Vertex_P32N8C8V16);
+  } else {
+    return false;
+  }
 
   bounds.extents.x = meshInfo.bounds.extents[0];
   bounds.extents.y = meshInfo.bounds.extents[1];
@@ -69,142 +127,52 @@ bool Mesh::loadFromAsset(const char* fileName) {
   bounds.valid = true;
 
   vertices.clear();
+  vertices.resize(meshInfo.vertexBufferSize / assetVertexSize);
+  indices.resize(meshInfo.indexBufferSize / sizeof(u32));
 
-  if(meshInfo.vertexFormat == assets::VertexFormat::PNCV_F32) {
-    assets::Vertex_PNCV_f32* unpackedVertices = (assets::Vertex_PNCV_f32*)tmpVertexBuffer.data();
-    u64 vertexCount = meshInfo.vertexBufferSize / sizeof(assets::Vertex_PNCV_f32);
-    vertices.resize(vertexCount);
-
-    for (u32 i = 0; i < vertexCount; i++) {
-      const assets::Vertex_PNCV_f32& assetVertex = unpackedVertices[i];
-      Vertex& newVertex = vertices[i];
-
-      newVertex.position = {
-              unpackedVertices[i].position[0],
-              unpackedVertices[i].position[1],
-              unpackedVertices[i].position[2]
-      };
-
-      newVertex.normal = {
-              unpackedVertices[i].normal[0],
-              unpackedVertices[i].normal[1],
-              unpackedVertices[i].normal[2]
-      };
-
-      newVertex.color = {
-              unpackedVertices[i].color[0],
-              unpackedVertices[i].color[1],
-              unpackedVertices[i].color[2]
-      };
-
-      newVertex.uv = {
-              unpackedVertices[i].uv[0],
-              unpackedVertices[i].uv[1]
-      };
-    }
-  } else if(meshInfo.vertexFormat == assets::VertexFormat::P32N8C8V16) {
-    assets::Vertex_P32N8C8V16* unpackedVertices = (assets::Vertex_P32N8C8V16*)tmpVertexBuffer.data();
-    vertices.resize(meshInfo.vertexBufferSize / sizeof(assets::Vertex_P32N8C8V16));
-
-    for (int i = 0; i < vertices.size(); i++) {
-      const assets::Vertex_P32N8C8V16& assetVertex = unpackedVertices[i];
-      Vertex& newVertex = vertices[i];
-
-      newVertex.position = {
-              unpackedVertices[i].position[0],
-              unpackedVertices[i].position[1],
-              unpackedVertices[i].position[2]
-      };
-
-      newVertex.normal = {
-              (f32)unpackedVertices[i].normal[0],
-              (f32)unpackedVertices[i].normal[1],
-              (f32)unpackedVertices[i].normal[2]
-      };
-
-      newVertex.color = {
-              (f32)unpackedVertices[i].color[0],
-              (f32)unpackedVertices[i].color[1],
-              (f32)unpackedVertices[i].color[2]
-      };
-
-      newVertex.uv = {
-              unpackedVertices[i].uv[0],
-              unpackedVertices[i].uv[1]
-      };
+  // Vertices are converted straight out of the decode window, so the unpacked asset vertex buffer never exists in full.
+  // A vertex split across two windows is assembled in pendingVertex.
+  union {
+    assets::Vertex_PNCV_f32 pncvF32;
+    assets::Vertex_P32N8C8V16 p32n8c8v16;
+  } pendingVertex;
+
+  bool unpacked = assets::unpackMeshStreaming(meshInfo, assetFile.binaryBlob.data(), assetFile.binaryBlob.size(), [&](u64 offset, const char* data, u64 size) {
+    while(size > 0 && offset < meshInfo.vertexBufferSize) {
+      u64 vertexIndex = offset / assetVertexSize;
+      u64 vertexByte = offset % assetVertexSize;
+      u64 copySize = MIN(size, assetVertexSize - vertexByte);
+      memcpy((char*)&pendingVertex + vertexByte, data, copySize);
+      if(vertexByte + copySize == assetVertexSize) {
+        if(meshInfo.vertexFormat == assets::VertexFormat::PNCV_F32) {
+          convertAssetVertex(pendingVertex.pncvF32, vertices[vertexIndex]);
+        } else {
+          convertAssetVertex(pendingVertex.p32n8c8v16, vertices[vertexIndex]);
+        }
+      }
+      offset += copySize;
+      data += copySize;
+      size -= copySize;
     }
-  }
+    // the rest of the window is indices, if anything is left; offset is still inside the vertices otherwise
+    if(size == 0) { return true; }
+    memcpy((char*)indices.data() + (offset - meshInfo.vertexBufferSize), data, size);
+    return true;
+  });
 
-  return false;
+  vertexCount = (u32)vertices.size();
+  indexCount = (u32)indices.size();
+  return unpacked && !vertices.empty();
 }
 
-void Mesh::uploadMesh(VmaAllocator vmaAllocator, UploadContext& uploadContext) {
-  u64 vertexBufferSize = vertices.size() * sizeof(Vertex);
-  u64 indexBufferSize = indices.size() * sizeof(u32);
-
-  // vertex buffer
-  VkBufferCreateInfo stagingBufferCreateInfo = {};
-  stagingBufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-  stagingBufferCreateInfo.pNext = NULL;
-  stagingBufferCreateInfo.size = vertexBufferSize + indexBufferSize;
-  stagingBufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-
-  VmaAllocationCreateInfo vmaAllocInfo = {};
-  vmaAllocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
-
-  AllocatedBuffer stagingBuffer;
-  VK_CHECK(vmaCreateBuffer(vmaAllocator,
-                           &stagingBufferCreateInfo,
-                           &vmaAllocInfo,
-                           &stagingBuffer.vkBuffer,
-                           &stagingBuffer.vmaAllocation,
-                           nullptr));
-
-  {
-    char* data;
-    vmaMapMemory(vmaAllocator, stagingBuffer.vmaAllocation, (void**)(&data));
-      memcpy(data, vertices.data(), vertexBufferSize);
-      memcpy(data + vertexBufferSize, indices.data(), indexBufferSize);
-    vmaUnmapMemory(vmaAllocator, stagingBuffer.vmaAllocation);
+bool Mesh::uploadMesh(UploadManager& uploadManager, GeometryArena& geometryArena) {
+  if(!geometryArena.allocate(vertexCount, indexCount, &vertexOffset, &firstIndex)) {
+    return false;
   }
 
-  VkBufferCreateInfo vertexBufferCreateInfo = {};
-  vertexBufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-  vertexBufferCreateInfo.pNext = nullptr;
-  vertexBufferCreateInfo.size = vertexBufferSize;
-  vertexBufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-
-  VkBufferCreateInfo indexBufferCreateInfo = vertexBufferCreateInfo;
-  indexBufferCreateInfo.size = indexBufferSize;
-  indexBufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-
-  VmaAllocationCreateInfo vmaStagingAllocInfo = {};
-  vmaStagingAllocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-
-  VK_CHECK(vmaCreateBuffer(vmaAllocator, &vertexBufferCreateInfo, &vmaStagingAllocInfo,
-                           &vertexBuffer.vkBuffer,
-                           &vertexBuffer.vmaAllocation,
-                           nullptr));
-
-  VK_CHECK(vmaCreateBuffer(vmaAllocator, &indexBufferCreateInfo, &vmaStagingAllocInfo,
-                           &indexBuffer.vkBuffer,
-                           &indexBuffer.vmaAllocation,
-                           nullptr));
-
-  vkutil::immediateSubmit(uploadContext, [=](VkCommandBuffer cmd) -> void {
-    VkBufferCopy vertexCopy;
-    vertexCopy.dstOffset = 0;
-    vertexCopy.srcOffset = 0;
-    vertexCopy.size = vertexBufferSize;
-
-    VkBufferCopy indexCopy;
-    indexCopy.dstOffset = 0;
-    indexCopy.srcOffset = vertexBufferSize;
-    indexCopy.size = indexBufferSize;
-
-    vkCmdCopyBuffer(cmd, stagingBuffer.vkBuffer, vertexBuffer.vkBuffer, 1, &vertexCopy);
-    vkCmdCopyBuffer(cmd, stagingBuffer.vkBuffer, indexBuffer.vkBuffer, 1, &indexCopy);
-  });
-
-  vmaDestroyBuffer(vmaAllocator, stagingBuffer.vkBuffer, stagingBuffer.vmaAllocation);
-}
\ No newline at end of file
+  uploadManager.uploadBuffer(geometryArena.vertexBuffer.vkBuffer, (u64)vertexOffset * sizeof(Vertex), vertices.data(), vertices.size() * sizeof(Vertex),
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+  uploadManager.uploadBuffer(geometryArena.indexBuffer.vkBuffer, (u64)firstIndex * sizeof(u32), indices.data(), indices.size() * sizeof(u32),
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+  return true;
+}
@@ -21,13 +21,32 @@ struct RenderBounds {
   bool valid;
 };
 
+enum class MeshResidency : u32 {
+  Unloaded = 0,
+  Queued, // requested, waiting for a free load slot
+  Loading, // being read and decoded on an asset reader worker
+  Decoded, // vertices and indices are in memory, waiting for room in the geometry arena
+  Uploading, // copies submitted, resident once uploadValue completes
+  Resident,
+  Failed,
+};
+
 struct Mesh {
-  std::vector<Vertex> vertices;
+  std::vector<Vertex> vertices; // only held between decoding and uploading when streamed
   std::vector<u32> indices;
-  AllocatedBuffer vertexBuffer;
-  AllocatedBuffer indexBuffer;
-  RenderBounds bounds;
+  u32 vertexCount;
+  u32 indexCount;
+  u32 vertexOffset; // in vertices, into the GeometryArena's vertex buffer
+  u32 firstIndex; // into the GeometryArena's index buffer
+  RenderBounds bounds; // valid once the mesh has been loaded, kept after eviction
+
+  // streaming state, see MeshStreamer
+  const char* filePath;
+  MeshResidency residency;
+  u64 uploadValue;
+  u32 lastUsedFrame;
 
   bool loadFromAsset(const char* fileName);
-  void uploadMesh(VmaAllocator vmaAllocator, UploadContext& uploadContext);
+  bool loadFromAssetFile(const assets::AssetFile& assetFile); // CPU only, safe to call from an I/O worker thread
+  bool uploadMesh(UploadManager& uploadManager, GeometryArena& geometryArena); // false when the arena is full, the upload is left for the caller to flush
 };
\ No newline at end of file
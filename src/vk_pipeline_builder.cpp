@@ -1,11 +1,12 @@
-VkPipeline PipelineBuilder::buildPipeline(VkDevice device, VkRenderPass pass) {
+VkPipeline PipelineBuilder::buildPipeline(VkDevice device, VkRenderPass pass, VkPipelineCache pipelineCache) const {
+  // viewport and scissor are dynamic, so pipelines don't depend on the window size and survive swap chain recreation
   VkPipelineViewportStateCreateInfo viewportState = {};
   viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
   viewportState.pNext = nullptr;
   viewportState.viewportCount = 1;
-  viewportState.pViewports = &viewport;
+  viewportState.pViewports = nullptr;
   viewportState.scissorCount = 1;
-  viewportState.pScissors = &scissor;
+  viewportState.pScissors = nullptr;
 
   VkPipelineColorBlendStateCreateInfo colorBlending = {};
   colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -16,11 +17,11 @@ VkPipeline PipelineBuilder::buildPipeline(VkDevice device, VkRenderPass pass) {
   colorBlending.pAttachments = &colorBlendAttachment;
 
   VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
-  VkDynamicState negativeViewPortDynamicState = VK_DYNAMIC_STATE_VIEWPORT;
+  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
   dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
   dynamicStateCreateInfo.pNext = nullptr;
-  dynamicStateCreateInfo.pDynamicStates = &negativeViewPortDynamicState;
-  dynamicStateCreateInfo.dynamicStateCount = 1;
+  dynamicStateCreateInfo.pDynamicStates = dynamicStates;
+  dynamicStateCreateInfo.dynamicStateCount = ArrayCount(dynamicStates);
   dynamicStateCreateInfo.flags = 0;
 
   VkGraphicsPipelineCreateInfo pipelineInfo = {};
@@ -43,7 +44,7 @@ VkPipeline PipelineBuilder::buildPipeline(VkDevice device, VkRenderPass pass) {
 
   //it's easy to error out on create graphics pipeline, so we handle it a bit better than the common VK_CHECK case
   VkPipeline newPipeline;
-  if(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS) {
+  if(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS) {
     std::cout << "failed to create pipeline\n";
     return VK_NULL_HANDLE; // failed to create graphics pipeline
   }
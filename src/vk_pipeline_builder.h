@@ -3,13 +3,11 @@ public:
   std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
   VkPipelineVertexInputStateCreateInfo vertexInputInfo;
   VkPipelineInputAssemblyStateCreateInfo inputAssembly;
-  VkViewport viewport;
-  VkRect2D scissor;
   VkPipelineRasterizationStateCreateInfo rasterizer;
   VkPipelineColorBlendAttachmentState colorBlendAttachment;
   VkPipelineMultisampleStateCreateInfo multisampling;
   VkPipelineLayout pipelineLayout;
   VkPipelineDepthStencilStateCreateInfo depthStencil;
 
-  VkPipeline buildPipeline(VkDevice device, VkRenderPass pass);
+  VkPipeline buildPipeline(VkDevice device, VkRenderPass pass, VkPipelineCache pipelineCache) const;
 };
\ No newline at end of file
@@ -4,6 +4,10 @@
 #include <chrono>
 #include <functional>
 #include <unordered_map>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #define NOMINMAX
 #include <windows.h>
@@ -33,30 +37,52 @@ using namespace noop;
 #include "util.h"
 #include "cstring_ring_buffer.h"
 #include "camera.h"
+#include "worker_pool.h"
+
+#include "asset_loader.h"
+#include "asset_io.h"
+#include "texture_asset.h"
+#include "mesh_asset.h"
+#include "material_asset.h"
+#include "prefab_asset.h"
+
 #include "vk_util.h"
 #include "vk_initializers.h"
+#include "descriptor_allocator.h"
+#include "upload_manager.h"
 #include "vk_textures.h"
+#include "geometry_arena.h"
 #include "vk_mesh.h"
+#include "mesh_streamer.h"
+#include "frustum_culling.h"
+#include "draw_sort.h"
 #include "materials.h"
 #include "vk_pipeline_builder.h"
+#include "vk_caches.h"
+#include "bindless_textures.h"
+#include "render_graph.h"
 #include "vk_engine.h"
 
-#include "asset_loader.h"
-#include "texture_asset.h"
-#include "mesh_asset.h"
-#include "material_asset.h"
-#include "prefab_asset.h"
-
 #include "baked_assets.h"
 
 #include "camera.cpp"
 #include "util.cpp"
+#include "worker_pool.cpp"
 #include "windows_util.cpp"
 #include "vk_util.cpp"
 #include "vk_initializers.cpp"
+#include "descriptor_allocator.cpp"
+#include "upload_manager.cpp"
 #include "vk_textures.cpp"
+#include "bindless_textures.cpp"
+#include "geometry_arena.cpp"
 #include "vk_mesh.cpp"
+#include "mesh_streamer.cpp"
+#include "frustum_culling.cpp"
+#include "draw_sort.cpp"
 #include "vk_pipeline_builder.cpp"
+#include "vk_caches.cpp"
+#include "render_graph.cpp"
 #include "imgui_util.cpp"
 #include "materials.cpp"
 #include "vk_engine.cpp"
\ No newline at end of file
@@ -15,12 +15,14 @@ void vkutil::loadImageFromAssetFile(VmaAllocator& vmaAllocator, const UploadCont
   assets::TextureInfo textureInfo{};
   readTextureInfo(assetFile, &textureInfo);
 
-  //allocate temporary buffer for holding texture data to upload
-  AllocatedBuffer stagingBuffer = vkutil::createBuffer(vmaAllocator, textureInfo.textureSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+  //allocate temporary buffer for holding texture data to upload, only the full resolution mip is loaded
+  u64 mipSize = assets::textureMipSize(textureInfo, 0);
+  AllocatedBuffer stagingBuffer = vkutil::createBuffer(vmaAllocator, mipSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
 
   void* data;
   vmaMapMemory(vmaAllocator, stagingBuffer.vmaAllocation, &data);
-    assets::unpackTexture(textureInfo, assetFile.binaryBlob.data(), assetFile.binaryBlob.size(), (char*)data);
+    assets::unpackTextureMip(textureInfo, 0, assetFile.binaryBlob.data(), assetFile.binaryBlob.size(), (char*)data);
+    vmaFlushAllocation(vmaAllocator, stagingBuffer.vmaAllocation, 0, mipSize);
   vmaUnmapMemory(vmaAllocator, stagingBuffer.vmaAllocation);
 
   VkExtent3D imageExtent;
@@ -30,6 +32,7 @@ void vkutil::loadImageFromAssetFile(VmaAllocator& vmaAllocator, const UploadCont
 
   AllocatedImage newImage;
   newImage.vkFormat = getVkFormat(textureInfo);
+  newImage.mipLevels = 1;
   VkImageCreateInfo imgCreateInfo = vkinit::imageCreateInfo(newImage.vkFormat, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageExtent);
 
   VmaAllocationCreateInfo imgAllocCreateInfo = {};
@@ -100,131 +103,84 @@ void vkutil::loadImageFromAssetFile(VmaAllocator& vmaAllocator, const UploadCont
   outImage = newImage;
 }
 
-// TODO: Any sort of error handling?
-void vkutil::loadImagesFromAssetFiles(VmaAllocator& vmaAllocator, const UploadContext& uploadContext, const char** files, AllocatedImage* outImages, u32 imageCount) {
-  std::vector<assets::AssetFile> assetFiles;
-  assetFiles.resize(imageCount);
-  std::vector<assets::TextureInfo> textureInfos;
-  textureInfos.resize(imageCount);
-  std::vector<VkExtent3D> imageExtents;
-  imageExtents.resize(imageCount);
+struct DecodedTexture {
+  bool success;
+  assets::TextureInfo textureInfo;
+  std::vector<char> pixels;
+};
+
+internal_access DecodedTexture decodeTexture(bool success, assets::AssetFile& assetFile) {
+  DecodedTexture decoded{};
+  decoded.success = success;
+  if(success) {
+    readTextureInfo(assetFile, &decoded.textureInfo);
+    decoded.pixels.resize(decoded.textureInfo.textureSize);
+    assets::unpackTexture(decoded.textureInfo, assetFile.binaryBlob.data(), assetFile.binaryBlob.size(), decoded.pixels.data());
+  }
+  return decoded;
+}
+
+// Reads and decompression happen on the asset reader's worker threads while the calling thread records the uploads of
+// finished textures. At most MAX_TEXTURE_DECODES_IN_FLIGHT textures are read or held decoded at once, the next read starts
+// as each upload is recorded. The uploads are left for the caller to flush. Images that fail to load are left as VK_NULL_HANDLE.
+void vkutil::loadImagesFromAssetFiles(VmaAllocator& vmaAllocator, UploadManager& uploadManager, assets::AsyncAssetReader& assetReader, const char** files, AllocatedImage* outImages, u32 imageCount) {
+  std::vector<std::future<DecodedTexture>> decodedTextures;
+  decodedTextures.resize(imageCount);
+  u32 startedCount = MIN(imageCount, MAX_TEXTURE_DECODES_IN_FLIGHT);
+  for(u32 i = 0; i < startedCount; i++) {
+    decodedTextures[i] = assetReader.readAssetFile<DecodedTexture>(files[i], decodeTexture);
+  }
 
   VmaAllocationCreateInfo imgAllocCreateInfo = {};
   imgAllocCreateInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
 
-  u64 stagingBufferSize = 0;
+  VkBufferImageCopy copyRegion = {};
+  // If either are 0, buffer memory is considered to be tightly packed according to the imageExtent
+  copyRegion.bufferRowLength = 0;
+  copyRegion.bufferImageHeight = 0;
+  copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  copyRegion.imageSubresource.baseArrayLayer = 0;
+  copyRegion.imageSubresource.layerCount = 1;
+  copyRegion.imageOffset = {0, 0, 0};
+  std::vector<VkBufferImageCopy> mipCopies;
+
   for(u32 i = 0; i < imageCount; i++) {
-    assets::AssetFile& assetFile = assetFiles[i];
-    assets::TextureInfo& textureInfo = textureInfos[i];
-    VkExtent3D& imageExtent = imageExtents[i];
+    AllocatedImage& allocImage = outImages[i];
+    allocImage = {};
 
-    loadAssetFile(files[i], &assetFile);
-    readTextureInfo(assetFile, &textureInfo);
+    // waits only on this texture, later textures continue to read and decompress in the background
+    DecodedTexture decoded = decodedTextures[i].get();
+    if(startedCount < imageCount) {
+      decodedTextures[startedCount] = assetReader.readAssetFile<DecodedTexture>(files[startedCount], decodeTexture);
+      startedCount++;
+    }
+    if(!decoded.success) {
+      std::cout << "Failed to load texture: " << files[i] << std::endl;
+      continue;
+    }
+    // textures larger than the staging ring are staged by the upload manager through a buffer of their own
+    const assets::TextureInfo& textureInfo = decoded.textureInfo;
+
+    VkExtent3D imageExtent;
     imageExtent.width = textureInfo.width;
     imageExtent.height = textureInfo.height;
     imageExtent.depth = 1;
 
-    AllocatedImage& allocImage = outImages[i];
-    allocImage.vkFormat = getVkFormat(textureInfo);
-
     //allocate and create the image
+    allocImage.vkFormat = getVkFormat(textureInfo);
+    allocImage.mipLevels = textureInfo.mipCount;
     VkImageCreateInfo imgCreateInfo = vkinit::imageCreateInfo(allocImage.vkFormat, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageExtent);
+    imgCreateInfo.mipLevels = allocImage.mipLevels;
     vmaCreateImage(vmaAllocator, &imgCreateInfo, &imgAllocCreateInfo, &allocImage.vkImage, &allocImage.vmaAllocation, nullptr);
 
-    stagingBufferSize += textureInfos[i].textureSize;
-  }
-
-  AllocatedBuffer stagingVMABuffer = vkutil::createBuffer(vmaAllocator, stagingBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
-
-  void* data;
-  vmaMapMemory(vmaAllocator, stagingVMABuffer.vmaAllocation, &data);
-  {
-    u64 stagingBufferPtrIter = 0;
-    for(u32 i = 0; i < imageCount; i++) {
-      const assets::TextureInfo& texInfo = textureInfos[i];
-      const assets::AssetFile& assetFile = assetFiles[i];
-      assets::unpackTexture(texInfo, assetFile.binaryBlob.data(), assetFile.binaryBlob.size(), ((char*)data) + stagingBufferPtrIter);
-      stagingBufferPtrIter += texInfo.textureSize;
+    // every mip is stored back to back in the decoded pixels
+    mipCopies.clear();
+    for(u32 mip = 0; mip < allocImage.mipLevels; mip++) {
+      copyRegion.bufferOffset = assets::textureMipOffset(textureInfo, mip);
+      copyRegion.imageSubresource.mipLevel = mip;
+      copyRegion.imageExtent = {assets::textureMipWidth(textureInfo, mip), assets::textureMipHeight(textureInfo, mip), 1};
+      mipCopies.push_back(copyRegion);
     }
+    uploadManager.uploadImage(allocImage.vkImage, allocImage.mipLevels, decoded.pixels.data(), textureInfo.textureSize, mipCopies.data(), (u32)mipCopies.size(), VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
   }
-  vmaUnmapMemory(vmaAllocator, stagingVMABuffer.vmaAllocation);
-
-  vkutil::immediateSubmit(uploadContext, [imageCount, &stagingVMABuffer, &outImages, &imageExtents, &textureInfos](VkCommandBuffer cmd) {
-    // which aspects of the image will be accessed?
-    VkImageSubresourceRange range;
-    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT; // color data
-    range.baseMipLevel = 0; // mip level
-    range.levelCount = 1;
-    range.baseArrayLayer = 0; // image array index
-    range.layerCount = 1;
-
-    VkImageMemoryBarrier imageBarrier_toTransfer = {};
-    imageBarrier_toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    imageBarrier_toTransfer.pNext = nullptr;
-    imageBarrier_toTransfer.srcAccessMask = 0;
-    imageBarrier_toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    imageBarrier_toTransfer.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED; // image is in undefined layout
-    imageBarrier_toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL; // to be transformed to transfer destination layout
-    imageBarrier_toTransfer.srcQueueFamilyIndex = 0;
-    imageBarrier_toTransfer.dstQueueFamilyIndex = 0;
-    imageBarrier_toTransfer.subresourceRange = range;
-
-    VkBufferImageCopy copyRegion = {};
-    // If either are 0, buffer memory is considered to be tightly packed according to the imageExtent
-    copyRegion.bufferRowLength = 0;
-    copyRegion.bufferImageHeight = 0;
-    copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    copyRegion.imageSubresource.mipLevel = 0;
-    copyRegion.imageSubresource.baseArrayLayer = 0;
-    copyRegion.imageSubresource.layerCount = 1;
-    copyRegion.imageOffset = {0, 0, 0};
-
-    VkImageMemoryBarrier imageBarrier_toReadable = imageBarrier_toTransfer;
-    imageBarrier_toReadable.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    imageBarrier_toReadable.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    imageBarrier_toReadable.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    imageBarrier_toReadable.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-    u64 stagingBufferOffset = 0;
-    for(u32 i = 0; i < imageCount; i++) {
-      AllocatedImage& allocImage = outImages[i];
-      VkExtent3D& imageExtent = imageExtents[i];
-      assets::TextureInfo& textureInfo = textureInfos[i];
-
-      imageBarrier_toTransfer.image = allocImage.vkImage;
-
-      // vkCmdPipelineBarrier defines memory dependencies between commands submitted before and after it
-      vkCmdPipelineBarrier(cmd,
-                           VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                           VK_PIPELINE_STAGE_TRANSFER_BIT,
-                           0, // dependency flags
-                           0, nullptr, // memory barrier count and array
-                           0, nullptr, // buffer memory barrier count and array
-                           1, &imageBarrier_toTransfer); // image memory barrier count and array
-
-      copyRegion.bufferOffset = stagingBufferOffset;
-      copyRegion.imageExtent = imageExtent;
-
-      //copy the buffer into the image
-      vkCmdCopyBufferToImage(cmd, stagingVMABuffer.vkBuffer, allocImage.vkImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
-
-      // barrier the image into the shader readable layout
-      imageBarrier_toReadable.image = allocImage.vkImage;
-      vkCmdPipelineBarrier(cmd,
-                           VK_PIPELINE_STAGE_TRANSFER_BIT,
-                           VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                           0,
-                           0,
-                           nullptr,
-                           0,
-                           nullptr,
-                           1,
-                           &imageBarrier_toReadable);
-
-      stagingBufferOffset += textureInfo.textureSize;
-    }
-
-  });
-
-  vmaDestroyBuffer(vmaAllocator, stagingVMABuffer.vkBuffer, stagingVMABuffer.vmaAllocation);
-}
\ No newline at end of file
+}
@@ -1,6 +1,8 @@
 #pragma once
 
+#define MAX_TEXTURE_DECODES_IN_FLIGHT 8 // decoded textures are held until their upload is recorded, this bounds them
+
 namespace vkutil {
   void loadImageFromAssetFile(VmaAllocator& vmaAllocator, const UploadContext& uploadContext, const char* file, AllocatedImage& outImage);
-  void loadImagesFromAssetFiles(VmaAllocator& vmaAllocator, const UploadContext& uploadContext, const char** files, AllocatedImage* outImages, u32 imageCount);
+  void loadImagesFromAssetFiles(VmaAllocator& vmaAllocator, UploadManager& uploadManager, assets::AsyncAssetReader& assetReader, const char** files, AllocatedImage* outImages, u32 imageCount);
 }
@@ -14,17 +14,20 @@
 struct AllocatedBuffer {
   VkBuffer vkBuffer;
   VmaAllocation vmaAllocation;
+  void* mappedData = nullptr; // stays mapped for the buffer's lifetime when created with VMA_ALLOCATION_CREATE_MAPPED_BIT
 };
 
 struct AllocatedImage {
   VkImage vkImage;
   VmaAllocation vmaAllocation;
   VkFormat vkFormat;
+  u32 mipLevels;
 };
 
 struct Texture {
   AllocatedImage image;
   VkImageView imageView;
+  u32 bindlessIndex; // into BindlessTextures' texture array
 };
 
 struct UploadContext {
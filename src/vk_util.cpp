@@ -11,7 +11,9 @@
 // - VMA_MEMORY_USAGE_CPU_ONLY: Useful for temporary staging buffers
 // VkMemoryPropertyFlags:
 // - VK_MEMORY_PROPERTY_HOST_CACHED_BIT: Useful if the CPU may read need to read from the buffer (ex: decompressing with LZ4 directly in buffer)
-AllocatedBuffer vkutil::createBuffer(VmaAllocator& vmaAllocator, u64 allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memUsage, VkMemoryPropertyFlags preferredMemoryFlags) {
+// VmaAllocationCreateFlags:
+// - VMA_ALLOCATION_CREATE_MAPPED_BIT: Useful for buffers written by the CPU every frame, mappedData is valid until the buffer is destroyed
+AllocatedBuffer vkutil::createBuffer(VmaAllocator& vmaAllocator, u64 allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memUsage, VkMemoryPropertyFlags preferredMemoryFlags, VmaAllocationCreateFlags allocFlags) {
   //allocate vertex buffer
   VkBufferCreateInfo bufferInfo = {};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -23,14 +25,17 @@ AllocatedBuffer vkutil::createBuffer(VmaAllocator& vmaAllocator, u64 allocSize,
   VmaAllocationCreateInfo vmaallocInfo = {};
   vmaallocInfo.usage = memUsage;
   vmaallocInfo.preferredFlags = preferredMemoryFlags;
+  vmaallocInfo.flags = allocFlags;
 
   AllocatedBuffer newBuffer;
+  VmaAllocationInfo allocationInfo;
 
   //allocate the buffer
   VK_CHECK(vmaCreateBuffer(vmaAllocator, &bufferInfo, &vmaallocInfo,
                            &newBuffer.vkBuffer,
                            &newBuffer.vmaAllocation,
-                           nullptr));
+                           &allocationInfo));
+  newBuffer.mappedData = allocationInfo.pMappedData;
 
   return newBuffer;
 }
@@ -77,10 +82,13 @@ u64 vkutil::padUniformBufferSize(const VkPhysicalDeviceProperties& gpuProperties
 
 void vkutil::loadShaderBuffer(const char* filePath, std::vector<char>& outBuffer) {
   readFile(filePath, outBuffer);
+  alignShaderBuffer(outBuffer);
+}
 
+void vkutil::alignShaderBuffer(std::vector<char>& buffer) {
   // TODO: Is this necessary or will it always just be a multiple of 4?
-  u64 alignedSize = ((outBuffer.size() + (4 - 1)) / 4) * 4;
-  outBuffer.resize(alignedSize); // add extra bytes if necessary
+  u64 alignedSize = ((buffer.size() + (4 - 1)) / 4) * 4;
+  buffer.resize(alignedSize); // add extra bytes if necessary
 }
 
 VkShaderModule vkutil::loadShaderModule(VkDevice device, const char* filePath) {
@@ -111,6 +119,87 @@ VkShaderModule vkutil::loadShaderModule(VkDevice device, std::vector<char>& file
   return shaderModule;
 }
 
+#define PIPELINE_CACHE_FILE_MAGIC 0x43505356 // "VSPC"
+
+// Written ahead of the driver's cache data. A cache is only usable by the device and driver version that produced it,
+// which the driver's own header doesn't fully capture, it has no driver version.
+struct PipelineCacheFileHeader {
+  u32 magic;
+  u32 dataSize;
+  u32 vendorID;
+  u32 deviceID;
+  u32 driverVersion;
+  u8 pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+// Layout of VK_PIPELINE_CACHE_HEADER_VERSION_ONE, the start of the data returned by vkGetPipelineCacheData
+struct DriverPipelineCacheHeader {
+  u32 headerSize;
+  u32 headerVersion;
+  u32 vendorID;
+  u32 deviceID;
+  u8 pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+internal_access PipelineCacheFileHeader pipelineCacheFileHeader(const VkPhysicalDeviceProperties& gpuProperties, u32 dataSize) {
+  PipelineCacheFileHeader header = {};
+  header.magic = PIPELINE_CACHE_FILE_MAGIC;
+  header.dataSize = dataSize;
+  header.vendorID = gpuProperties.vendorID;
+  header.deviceID = gpuProperties.deviceID;
+  header.driverVersion = gpuProperties.driverVersion;
+  memcpy(header.pipelineCacheUUID, gpuProperties.pipelineCacheUUID, VK_UUID_SIZE);
+  return header;
+}
+
+VkPipelineCache vkutil::loadPipelineCache(VkDevice device, const VkPhysicalDeviceProperties& gpuProperties, const char* filePath) {
+  std::vector<char> fileBytes;
+  const char* initialData = nullptr;
+  u64 initialDataSize = 0;
+  if(readFile(filePath, fileBytes) && fileBytes.size() >= sizeof(PipelineCacheFileHeader) + sizeof(DriverPipelineCacheHeader)) {
+    PipelineCacheFileHeader fileHeader;
+    DriverPipelineCacheHeader driverHeader;
+    memcpy(&fileHeader, fileBytes.data(), sizeof(fileHeader));
+    memcpy(&driverHeader, fileBytes.data() + sizeof(fileHeader), sizeof(driverHeader));
+
+    PipelineCacheFileHeader expectedHeader = pipelineCacheFileHeader(gpuProperties, (u32)(fileBytes.size() - sizeof(fileHeader)));
+    bool matchesDevice = memcmp(&fileHeader, &expectedHeader, sizeof(fileHeader)) == 0 &&
+                         driverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+                         driverHeader.vendorID == gpuProperties.vendorID &&
+                         driverHeader.deviceID == gpuProperties.deviceID &&
+                         memcmp(driverHeader.pipelineCacheUUID, gpuProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    if(matchesDevice) {
+      initialData = fileBytes.data() + sizeof(fileHeader);
+      initialDataSize = fileHeader.dataSize;
+    } else {
+      std::cout << "Pipeline cache " << filePath << " is from another device or driver, starting empty" << std::endl;
+    }
+  }
+
+  VkPipelineCacheCreateInfo createInfo = {};
+  createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  createInfo.pNext = nullptr;
+  createInfo.flags = 0;
+  createInfo.initialDataSize = initialDataSize;
+  createInfo.pInitialData = initialData;
+
+  VkPipelineCache pipelineCache;
+  VK_CHECK(vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache));
+  return pipelineCache;
+}
+
+void vkutil::savePipelineCache(VkDevice device, const VkPhysicalDeviceProperties& gpuProperties, VkPipelineCache pipelineCache, const char* filePath) {
+  size_t dataSize = 0;
+  VK_CHECK(vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr));
+
+  std::vector<char> fileBytes(sizeof(PipelineCacheFileHeader) + dataSize);
+  VK_CHECK(vkGetPipelineCacheData(device, pipelineCache, &dataSize, fileBytes.data() + sizeof(PipelineCacheFileHeader)));
+
+  PipelineCacheFileHeader header = pipelineCacheFileHeader(gpuProperties, (u32)dataSize);
+  memcpy(fileBytes.data(), &header, sizeof(header));
+  writeFile(filePath, fileBytes.data(), sizeof(header) + dataSize);
+}
+
 static u32 vkutil::formatSize(VkFormat format) {
   u32 result = 0;
   switch (format) {
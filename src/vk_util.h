@@ -2,12 +2,16 @@
 
 namespace vkutil {
 
-  AllocatedBuffer createBuffer(VmaAllocator& vmaAllocator, u64 allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memUsage, VkMemoryPropertyFlags preferredMemoryFlags);
+  AllocatedBuffer createBuffer(VmaAllocator& vmaAllocator, u64 allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memUsage, VkMemoryPropertyFlags preferredMemoryFlags, VmaAllocationCreateFlags allocFlags = 0);
   void immediateSubmit(const UploadContext& uploadContext, std::function<void(VkCommandBuffer cmd)>&& function);
   u64 padUniformBufferSize(const VkPhysicalDeviceProperties& gpuProperties, u64 originalSize);
   void loadShaderBuffer(const char* filePath, std::vector<char>& outBuffer);
+  void alignShaderBuffer(std::vector<char>& buffer);
   VkShaderModule loadShaderModule(VkDevice device, const char* filePath);
   VkShaderModule loadShaderModule(VkDevice device, std::vector<char>& fileBuffer);
+  // Seeded from the file when it was saved for the same device and driver version, empty otherwise
+  VkPipelineCache loadPipelineCache(VkDevice device, const VkPhysicalDeviceProperties& gpuProperties, const char* filePath);
+  void savePipelineCache(VkDevice device, const VkPhysicalDeviceProperties& gpuProperties, VkPipelineCache pipelineCache, const char* filePath);
 
   // Returns the size in bytes of the provided VkFormat.
   // As this is only intended for vertex attribute formats, not all VkFormats are supported.
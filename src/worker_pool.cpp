@@ -0,0 +1,62 @@
+void WorkerPool::init(u32 workerCount) {
+  quit = false;
+  for(u32 i = 1; i < workerCount; i++) {
+    threads.emplace_back(&WorkerPool::workerLoop, this, i);
+  }
+}
+
+void WorkerPool::shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    quit = true;
+  }
+  workAvailable.notify_all();
+  for(std::thread& thread: threads) {
+    thread.join();
+  }
+  threads.clear();
+}
+
+void WorkerPool::run(u32 count, const std::function<void(u32 workerIndex)>& fn) {
+  count = MIN(count, workerCount());
+  if(count == 0) { return; }
+
+  if(count > 1) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      job = &fn;
+      jobWorkerCount = count;
+      jobsRemaining = count - 1;
+      generation++;
+    }
+    workAvailable.notify_all();
+  }
+
+  fn(0);
+
+  if(count > 1) {
+    std::unique_lock<std::mutex> lock(mutex);
+    workDone.wait(lock, [this]() { return jobsRemaining == 0; });
+    job = nullptr;
+  }
+}
+
+void WorkerPool::workerLoop(u32 workerIndex) {
+  u64 seenGeneration = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  while(true) {
+    workAvailable.wait(lock, [&]() { return quit || generation != seenGeneration; });
+    if(quit) { return; }
+    seenGeneration = generation;
+    if(workerIndex >= jobWorkerCount) { continue; }
+
+    const std::function<void(u32 workerIndex)>* fn = job;
+    lock.unlock();
+    (*fn)(workerIndex);
+    lock.lock();
+
+    if(--jobsRemaining == 0) {
+      workDone.notify_one();
+    }
+  }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+// A fixed set of threads that all run the same function, for splitting per frame CPU work such as command recording.
+// The calling thread takes part as worker 0, so a pool of one worker runs everything inline.
+class WorkerPool {
+public:
+  void init(u32 workerCount);
+  void shutdown();
+
+  u32 workerCount() const { return (u32)threads.size() + 1; }
+  // Calls fn(workerIndex) once for each workerIndex below count and returns when every call has finished
+  // count is clamped to workerCount()
+  void run(u32 count, const std::function<void(u32 workerIndex)>& fn);
+
+private:
+  void workerLoop(u32 workerIndex);
+
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable workAvailable;
+  std::condition_variable workDone;
+  const std::function<void(u32 workerIndex)>* job = nullptr;
+  u32 jobWorkerCount = 0;
+  u32 jobsRemaining = 0;
+  u64 generation = 0; // incremented for every run() so sleeping workers can tell new work apart from old
+  bool quit = false;
+};